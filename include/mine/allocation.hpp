@@ -0,0 +1,49 @@
+#ifndef MINE_ALLOCATION_HPP
+#define MINE_ALLOCATION_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace mine {
+struct allocation_stats {
+    long long count = 0;
+    long long bytes = 0;
+};
+
+// every global operator new is counted, per thread and into the innermost allocation_scope open on that thread
+allocation_stats thread_allocations();
+
+// counts into the same totals, for libraries that take an allocator of their own
+void* counted_allocate(size_t size);
+void counted_free(void* pointer);
+
+// attributes the allocations made on this thread while it is alive to into, instead of to any enclosing scope
+class allocation_scope {
+    allocation_stats* previous;
+public:
+    explicit allocation_scope(allocation_stats& into);
+    ~allocation_scope();
+    allocation_scope(const allocation_scope&) = delete;
+    allocation_scope& operator=(const allocation_scope&) = delete;
+};
+
+// one block handed out front to back and emptied by reset() at the start of every frame, for whatever lives
+// only a frame. a frame that outgrows the block spills into separate allocations, and the next reset grows
+// the block to fit, so a steady frame never reaches the heap
+class frame_arena {
+    std::vector<char> block;
+    size_t used;
+    size_t spilled;
+    std::vector<std::unique_ptr<char[]>> spills;
+public:
+    explicit frame_arena(size_t capacity);
+
+    void reset();
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    // printf into the arena; the text lives until the next reset
+    const char* format(const char* pattern, ...);
+};
+}
+
+#endif
@@ -24,8 +24,16 @@ public:
     void set_screen(float screen_width, float screen_height);
     void set_data(float radius, float theta, float phi);
     void set_center(const std::array<int, 4>& bounds);
+    // centers on the middle of min x, y, z, max x, y, z; an empty box (min > max) leaves the center alone
+    void set_center(const std::array<float, 6>& box);
     void zoom(bool in, bool out);
+    // slides the center along the ground, forward toward where the camera looks and right across it,
+    // both in units of the distance to the center
+    void pan(float forward, float right);
     void update_angles(float theta, float phi);
+    float get_radius() const;
+    // world space ray through a window pixel, unprojected from the near to the far plane
+    void ray(float mouse_x, float mouse_y, glm::vec3& origin, glm::vec3& direction) const;
 private:
     void update_position();
 };
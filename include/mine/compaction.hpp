@@ -0,0 +1,26 @@
+#ifndef MINE_COMPACTION_HPP
+#define MINE_COMPACTION_HPP
+
+#include <array>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include <mine/enums.hpp>
+
+namespace mine {
+// flags the cells of a rows x columns grid worth drawing: all four corners finite and, when jump > 0, no edge
+// whose change in height differs from the changes on the edges before and after it by more than jump and by more
+// than those changes themselves, which is how a pole or a branch cut shows up between samples while a steep
+// surface does not. one flag per cell, row-major, columns - 1 per row; returns how many cells were kept
+int flag_cells(const vertex* grid, int rows, int columns, float jump, std::vector<unsigned char>& valid);
+
+// appends the two triangles of every drawn cell of the grids laid out back to back from first_vertex, one grid of
+// rows x columns vertices per entry of the masks; a cell is drawn when both of its grid's masks keep it, an empty
+// mask keeping every cell. ranges receives each grid's first index and index count. the rows of all the grids are
+// split into one band per thread: every band counts its cells, an exclusive scan of the counts gives each band its
+// offset, and the bands then write their triangles side by side in grid order
+void compact_cells(const std::vector<std::vector<unsigned char>>& visible, const std::vector<std::vector<unsigned char>>& valid, int rows, int columns, GLuint first_vertex, std::vector<GLuint>& indices, std::vector<std::array<GLuint, 2>>& ranges);
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef MINE_CONTOUR_HPP
+#define MINE_CONTOUR_HPP
+
+#include <vector>
+
+#include <mine/enums.hpp>
+
+namespace mine {
+class contour {
+    std::vector<float> levels;
+    std::vector<std::vector<vertex>> partials;
+public:
+    std::vector<vertex> segments{};
+
+    contour();
+
+    void set_levels(int count, float low, float high);
+    void clear();
+    // skips the cells valid leaves out, an empty mask keeping all of them
+    void extract(const vertex* grid, int rows, int columns, const std::vector<unsigned char>& valid = {});
+private:
+    void extract_rows(const vertex* grid, const std::vector<unsigned char>& valid, int first, int last, int columns, std::vector<vertex>& out) const;
+};
+}
+
+#endif
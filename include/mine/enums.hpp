@@ -9,6 +9,7 @@ namespace mine {
 constexpr int X_RECTS = 144;
 constexpr int Z_RECTS = 144;
 
+// presets for new functions, taken in turn; the function count itself has no limit
 constexpr std::array<std::array<int, 4>, 8> INITIAL_BOUNDS{{
     { -2,  2, -2, 2 },
     { -2,  2, -2, 2 },
@@ -31,13 +32,27 @@ constexpr std::array<char[256], 8> INITIAL_FUNCTIONS{{
     "3"
 }};
 
-constexpr std::array<const char[12], 16> ids = {
-    "##Function1", "Submit####1", "##Function2", "Submit####2",
-    "##Function3", "Submit####3", "##Function4", "Submit####4",
-    "##Function5", "Submit####5", "##Function6", "Submit####6",
-    "##Function7", "Submit####7", "##Function8", "Submit####8"
+enum kinds {
+    HEIGHT,
+    SURFACE,
+    CURVE,
+    POINTS,
+    COMPLEX
 };
 
+constexpr std::array<const char*, 5> KIND_NAMES{{
+    "z = f(x, y)",
+    "r(u, v) = x; y; z",
+    "r(t) = x; y; z",
+    "x, y, z data file",
+    "w = f(z), z = x + iy"
+}};
+
+// kinds sampled over parameters rather than over a stretch of the ground, so their domain is not in world units
+constexpr bool parametric(int kind) {
+    return kind == SURFACE || kind == CURVE;
+}
+
 enum index {
     NEG_X_BOUND,
     POS_X_BOUND,
@@ -51,14 +66,23 @@ enum index {
     POS_Y_AXIS = 5
 };
 
+// 20 bytes: the color is GL_UNSIGNED_BYTE rgba and the normal GL_INT_2_10_10_10_REV, both normalized
 struct vertex {
     GLfloat x;
     GLfloat y;
     GLfloat z;
-    GLfloat r;
-    GLfloat g;
-    GLfloat b;
+    GLuint color;
+    GLuint normal;
 };
+static_assert(sizeof(vertex) == 5 * sizeof(GLuint), "the shaders index vertices five words apart");
+
+// packs r, g, b in [0, 1] into an opaque vertex color; anything outside, NaN included, is clamped
+constexpr GLuint pack_color(float r, float g, float b) {
+    auto channel = [](float c) {
+        return (GLuint)((c > 0.0f ? (c < 1.0f ? c : 1.0f) : 0.0f) * 255.0f + 0.5f);
+    };
+    return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (255u << 24);
+}
 
 constexpr std::array<int, 6> INITIAL_AXES{{ -5, 5, -5, 5, -5, 5 }};
 constexpr int INIT_BASE_VERTICE_COUNT = 30 + 2 * (
@@ -68,6 +92,8 @@ constexpr int INIT_BASE_VERTICE_COUNT = 30 + 2 * (
     INITIAL_AXES[NEG_Z_AXIS]
 );
 
+constexpr int FUNCTION_VERTICE_COUNT = (X_RECTS + 1) * (Z_RECTS + 1);
+
 enum bools {
     SCREEN,
     SCENE,
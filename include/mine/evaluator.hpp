@@ -0,0 +1,47 @@
+#ifndef MINE_EVALUATOR_HPP
+#define MINE_EVALUATOR_HPP
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include <mine/enums.hpp>
+#include <mine/expression.hpp>
+#include <mine/reduction.hpp>
+
+namespace mine {
+// what a height field patch must touch to be worth evaluating: the visible y range and, unless clip is null,
+// the frustum of a column-major view-projection matrix
+struct culling {
+    double low;
+    double high;
+    const float* clip;
+};
+
+// same palette as compute.glsl so CPU and GPU evaluated surfaces look identical; shade darkens it
+void height_color(float z, float index, vertex& out, float shade = 1.0f);
+
+// bounds every patch of cells with interval arithmetic, splitting only patches that straddle the range or the
+// frustum; fills one flag per cell (row-major, columns - 1 per row) and returns how many cells survived
+int cull_cells(const expression& function, const std::array<int, 4>& bounds, int rows, int columns, const culling& view, std::vector<unsigned char>& visible);
+
+// evaluates a height field over bounds into a rows x columns grid with one dual-number pass,
+// taking the normals from the exact gradient instead of differencing neighbours; with a cell mask,
+// only the corners of visible cells are evaluated and the rest are left as NaN. heights, when given, receives
+// the range of what was evaluated, reduced in the same pass. once cancelled is set the remaining rows are
+// skipped and false is returned
+bool evaluate_height_field(const expression& function, const std::array<int, 4>& bounds, float index, vertex* grid, int rows, int columns, const std::vector<unsigned char>* visible = nullptr, height_range* heights = nullptr, const std::atomic<bool>* cancelled = nullptr);
+
+// evaluates only rows [block[0], block[1]) by columns [block[2], block[3]) of the grid evaluate_height_field
+// fills, for when the rest of it is still current
+void evaluate_height_block(const expression& function, const std::array<int, 4>& bounds, float index, vertex* grid, int rows, int columns, const std::array<int, 4>& block);
+
+// domain coloring of a complex expression in z = x + iy over bounds: the phase of f(z) is the hue and log|f|,
+// clamped to +-LOG_MODULUS_LIMIT, the height, or with relief off the brightness of a flat sheet. height and
+// color come out of the same pass over each batch, with normals differenced from the heights afterwards.
+// cancelled works as for evaluate_height_field
+constexpr float LOG_MODULUS_LIMIT = 8.0f;
+bool evaluate_complex_field(const expression& function, const std::array<int, 4>& bounds, vertex* grid, int rows, int columns, bool relief, height_range* heights = nullptr, const std::atomic<bool>* cancelled = nullptr);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef MINE_EXPRESSION_HPP
+#define MINE_EXPRESSION_HPP
+
+#include <string>
+#include <vector>
+
+namespace mine {
+constexpr int BATCH = 64;
+
+enum opcode {
+    CONSTANT,
+    VARIABLE_X,
+    VARIABLE_Y,
+    VARIABLE_Z,
+    IMAGINARY,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    NEG,
+    POW,
+    MIN,
+    MAX,
+    MOD,
+    SIN,
+    COS,
+    TAN,
+    ASIN,
+    ACOS,
+    ATAN,
+    SINH,
+    COSH,
+    TANH,
+    EXP,
+    LOG,
+    SQRT,
+    ABS
+};
+
+struct interval {
+    double lo;
+    double hi;
+};
+
+struct node {
+    int op;
+    int a;
+    int b;
+    double value;
+};
+
+// a parsed plot expression stored as a tape: every node's operands come before it and the last node is the result.
+// parsing also optimizes the tape, and the nodes that only depend on x are sorted to the front so a row can skip them.
+// a complex expression also knows z = x + iy and i, has no min, max or mod, and only runs through evaluate_complex
+class expression {
+    std::vector<node> nodes;
+    std::string source;
+    std::string error;
+    size_t position;
+    int parsed;
+    int invariant;
+    bool complex;
+public:
+    expression();
+
+    bool parse(const std::string& source, bool complex = false);
+    bool is_complex() const;
+    bool empty() const;
+    int size() const;
+    int parsed_size() const;
+    const std::string& get_source() const;
+    const std::string& get_error() const;
+
+    double evaluate(double x, double y) const;
+    void evaluate(const double* x, const double* y, double* f, int count) const;
+    void evaluate_row(double x, const double* y, double* f, int count) const;
+    void evaluate_dual(const double* x, const double* y, double* f, double* dfdx, double* dfdy, int count) const;
+    void evaluate_dual_row(double x, const double* y, double* f, double* dfdx, double* dfdy, int count) const;
+    interval evaluate_interval(interval x, interval y) const;
+    void evaluate_complex(const double* x, const double* y, double* re, double* im, int count) const;
+    void evaluate_complex_row(double x, const double* y, double* re, double* im, int count) const;
+
+    // appends one "float <prefix><n> = ...;" line per op to statements and returns the GLSL for the result
+    std::string glsl(const std::string& prefix, std::string& statements) const;
+private:
+    int parse_sum();
+    int parse_product();
+    int parse_unary();
+    int parse_primary();
+    int push(int op, int a, int b, double value);
+    void optimize();
+    void evaluate_batch(const double* x, const double* y, double* f, int count, bool row) const;
+    void evaluate_dual_batch(const double* x, const double* y, double* f, double* dfdx, double* dfdy, int count, bool row) const;
+    void evaluate_complex_batch(const double* x, const double* y, double* re, double* im, int count, bool row) const;
+    void skip_spaces();
+    bool fail(const std::string& message);
+};
+}
+
+#endif
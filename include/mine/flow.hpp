@@ -0,0 +1,52 @@
+#ifndef MINE_FLOW_HPP
+#define MINE_FLOW_HPP
+
+#include <array>
+#include <vector>
+
+#include <mine/enums.hpp>
+#include <mine/expression.hpp>
+
+namespace mine {
+enum integrators {
+    RK4,
+    RK45
+};
+
+// the ODE y' = f(x, y) over a function's bounds, drawn on the floor: a slope field, and trajectories traced
+// both ways from every seed until they leave the bounds. seeds advance BATCH lanes at a time per thread, in
+// structure-of-arrays lanes that the expression tape evaluates together; RK45 keeps one step size per lane
+class flow {
+    std::vector<vertex> field;
+    std::vector<vertex> grid;
+    std::vector<vertex> seeded;
+    std::vector<std::vector<vertex>> partials;
+public:
+    int method;
+    // the RK4 step, and the largest RK45 step, as a share of the domain's width
+    double step;
+    double tolerance;
+    int samples;
+    int seeds;
+    // steps taken by the last trace and by the last trace_seeds
+    long long steps;
+    long long seed_steps;
+
+    flow();
+
+    // the slope field and the seeds spread over the domain
+    void trace(const expression& function, const std::array<int, 4>& bounds);
+    // only the given seeds, so dragging one re-integrates a single trajectory
+    void trace_seeds(const expression& function, const std::array<int, 4>& bounds, const std::vector<std::array<double, 2>>& points);
+    void clear();
+    // the slope field and the spread seeds' trajectories
+    void lines(std::vector<vertex>& out) const;
+    // the trajectories of the seeds given to trace_seeds
+    void seed_lines(std::vector<vertex>& out) const;
+private:
+    // returns the steps taken
+    long long integrate(const expression& function, const std::array<int, 4>& bounds, const std::vector<std::array<double, 2>>& points, const std::array<float, 3>& color, std::vector<vertex>& out);
+};
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef MINE_FRAMEBUFFER_HPP
+#define MINE_FRAMEBUFFER_HPP
+
+#include <array>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace mine {
+// an offscreen render target of any size; with samples > 1 it draws into a multisampled FBO and resolves
+// into a single-sampled one for readback. reads go through two pixel buffers so a frame can be copied out
+// while the next one renders
+class framebuffer {
+    GLuint multisample_fbo;
+    GLuint color_buffer;
+    GLuint depth_buffer;
+    GLuint resolve_fbo;
+    GLuint resolve_buffer;
+    std::array<GLuint, 2> pixel_buffers;
+    std::array<GLsync, 2> fences;
+    int width;
+    int height;
+    int samples;
+    int issued;
+    int collected;
+public:
+    framebuffer();
+
+    bool set_size(int width, int height, int samples);
+    void destroy();
+    void bind() const;
+    void unbind() const;
+    // resolves and stretches the frame onto the default framebuffer, leaving it bound at screen size
+    void present(int screen_width, int screen_height) const;
+    // queues a readback of the frame just drawn; false while both pixel buffers are still waiting to be collected
+    bool read();
+    // waits for the oldest queued readback and copies it out top row first as RGBA; false if nothing is queued
+    bool collect(std::vector<unsigned char>& pixels);
+    int get_width() const;
+    int get_height() const;
+    int get_samples() const;
+};
+}
+
+#endif
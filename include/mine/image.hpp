@@ -0,0 +1,13 @@
+#ifndef MINE_IMAGE_HPP
+#define MINE_IMAGE_HPP
+
+#include <string>
+#include <vector>
+
+namespace mine {
+// writes top-row-first RGBA pixels as a PNG with stored (uncompressed) deflate blocks,
+// trading file size for a writer that keeps up with offscreen frame rates and needs no zlib
+bool write_png(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels);
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef MINE_INDIRECT_HPP
+#define MINE_INDIRECT_HPP
+
+#include <array>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace mine {
+// laid out as glMultiDrawElementsIndirect reads it
+struct draw_command {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+// std430 layout of one function's entry in the parameter buffer, which the vertex shader indexes with
+// gl_DrawID and the cull pass reads the bounding box from; an empty box (low > high) is never drawn.
+// range is the low and high height of the colormap, whose third value turns it on
+struct draw_parameters {
+    std::array<float, 4> low;
+    std::array<float, 4> high;
+    std::array<float, 4> tint;
+    std::array<float, 4> range;
+};
+
+// every function's triangles as one indirect draw. upload() writes the commands as the plot lays them out,
+// cull() has a compute pass rewrite them with instance_count 0 for boxes outside the view, and draw()
+// submits them all in a single call however many functions there are
+class draw_list {
+    GLuint parameter_buffer;
+    GLuint source_buffer;
+    GLuint command_buffer;
+    GLuint cull_program;
+    GLint view_location;
+    GLint count_location;
+    int capacity;
+    int count;
+public:
+    std::vector<draw_command> commands;
+    std::vector<draw_parameters> parameters;
+
+    draw_list();
+
+    void create();
+    void destroy();
+    void upload();
+    // the cull pass, whose uniform locations are looked up here once; 0 draws the commands as uploaded
+    void set_program(GLuint program);
+    // leaves no program bound
+    void cull(const float* view) const;
+    void draw() const;
+};
+}
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef MINE_MAPPING_HPP
+#define MINE_MAPPING_HPP
+
+#include <string>
+
+namespace mine {
+// a read-only view of a whole file through mmap or MapViewOfFile; the bytes stay valid until close()
+class mapped_file {
+    const char* data;
+    size_t size;
+#ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+#endif
+public:
+    mapped_file();
+    ~mapped_file();
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    // sequential tells the kernel the file will be streamed once front to back, so it reads ahead further
+    bool open(const std::string& path, bool sequential = false);
+    void close();
+    const char* get_data() const;
+    size_t get_size() const;
+};
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef MINE_NORMALS_HPP
+#define MINE_NORMALS_HPP
+
+#include <glad/glad.h>
+
+#include <mine/enums.hpp>
+
+namespace mine {
+// packs a unit vector into GL_INT_2_10_10_10_REV with w = 1 marking the vertex as lit
+GLuint pack_normal(float x, float y, float z);
+
+// central-difference normals over a rows x columns grid, one-sided on the border
+void compute_normals(vertex* grid, int rows, int columns);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef MINE_PARALLEL_HPP
+#define MINE_PARALLEL_HPP
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace mine {
+inline int thread_count() {
+    unsigned int count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : (int)count;
+}
+
+// splits [begin, end) into one contiguous chunk per hardware thread and runs body(first, last, thread) on each
+template <typename F>
+void parallel_for(int begin, int end, F&& body) {
+    int threads = std::min(thread_count(), end - begin);
+    if (threads <= 1) {
+        body(begin, end, 0);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    int chunk = (end - begin + threads - 1) / threads;
+    for (int t = 0; t < threads; ++t) {
+        int first = begin + t * chunk;
+        int last = std::min(end, first + chunk);
+        if (first >= last) {
+            break;
+        }
+        workers.emplace_back([&body, first, last, t]() { body(first, last, t); });
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef MINE_PICKING_HPP
+#define MINE_PICKING_HPP
+
+#include <array>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <mine/enums.hpp>
+
+namespace mine {
+struct hit {
+    float t;
+    float x;
+    float y;
+    float z;
+    int function;
+};
+
+// min/max boxes over 2 x 2 blocks of grid cells, halved per level up to a single root box.
+// a ray walks it front to back and only tests the triangles of blocks whose boxes it enters
+class pyramid {
+    struct level {
+        int rows;
+        int columns;
+        std::vector<std::array<float, 6>> boxes;
+    };
+
+    std::vector<level> levels;
+    // the cells flag_cells kept, empty for all of them; the rest are neither boxed nor hit
+    std::vector<unsigned char> valid;
+    int rows;
+    int columns;
+public:
+    pyramid();
+
+    // every evaluation in the plot rewrites or moves the whole grid, so the pyramid is always rebuilt whole;
+    // a grid of the same size refits the boxes it already holds rather than allocating them again
+    void build(const vertex* grid, int rows, int columns, const std::vector<unsigned char>& valid = {});
+    // min x, y, z then max x, y, z of the whole grid; empty (min > max) before build or when nothing is finite
+    std::array<float, 6> get_box() const;
+    // keeps the nearest hit with t < out.t, so several pyramids can be queried into one result
+    bool intersect(const vertex* grid, const glm::vec3& origin, const glm::vec3& direction, hit& out) const;
+private:
+    // boxes the blocks of every level from the grid's vertices
+    void refit(const vertex* grid);
+};
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <array>
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 
@@ -19,22 +20,29 @@ protected:
 };
 
 class compute_pipeline : public pipeline {
-	std::array<std::string, 8> functions;
+	std::vector<std::string> functions;
+	std::vector<int> kinds;
 public:
 	compute_pipeline();
+	// functions never set read as an empty height field
 	const char* get_function(int index) const;
-	bool set_program(const std::string& compute_source_location, const std::string& function, int index);
+	int get_kind(int index) const;
+	void set_function(const std::string& function, int kind, int index);
+	bool set_program(const std::string& compute_source_location);
+	bool set_program(const std::string& compute_source_location, const std::string& function, int kind, int index);
 private:
-	std::string load_shader(const std::string& source_location, const std::string& function);
+	std::string load_shader(const std::string& source_location, const std::string& function, int kind);
 	GLuint create_program(const std::string& compute_source);
 };
 
 class graphics_pipeline : public pipeline {
 	GLint view_matrix_location;
+	GLint camera_position_location;
 public:
 	graphics_pipeline();
 	GLint get_view_matrix_location() const;
-	void set_program(const std::string& vertex_source_location, const std::string& fragment_source_location, const std::string& view_matrix_name);
+	GLint get_camera_position_location() const;
+	void set_program(const std::string& vertex_source_location, const std::string& fragment_source_location, const std::string& view_matrix_name, const std::string& camera_position_name);
 private:
 	std::string load_shader(const std::string& source_location);
 	GLuint create_program(const std::string& vertex_source, const std::string& fragment_source);
@@ -2,6 +2,7 @@
 #define MINE_PLOT_HPP
 
 #include <array>
+#include <cstddef>
 #include <vector>
 
 #include <glad/glad.h>
@@ -13,20 +14,71 @@ class plot {
 public:
     std::vector<vertex> vertices{};
     std::vector<GLuint> indices{};
-    std::vector<std::array<vertex, (X_RECTS + 1) * (Z_RECTS + 1)>> functions{};
-    std::array<std::array<int, 4>, 8> bounds{INITIAL_BOUNDS};
+    std::vector<vertex> overlay{};
+    // lines after the overlay that change on their own, so replacing them moves nothing else
+    std::vector<vertex> trajectories{};
+    // each function's grid lives only in vertices; the GPU generates its sample positions from bounds
+    std::vector<std::vector<unsigned char>> visible{};
+    // cells flag_cells kept, per function; empty keeps every cell
+    std::vector<std::vector<unsigned char>> valid{};
+    // first index and index count of each function's triangles
+    std::vector<std::array<GLuint, 2>> ranges{};
+    // loaded data points per function, kept between the grids and the overlay and drawn as GL_POINTS
+    std::vector<std::vector<vertex>> clouds{};
+    // one entry per function, like the vectors above
+    std::vector<std::array<int, 4>> bounds{};
+    // the u and v ranges of a parametric function, or the t range and two unused values; unlike bounds they are
+    // not world coordinates, so they are neither whole numbers nor clamped to the axes
+    std::vector<std::array<float, 4>> parameters{};
+    std::vector<int> kinds{};
     std::array<int, 6> axes{INITIAL_AXES};
     int base_vertice_count = INIT_BASE_VERTICE_COUNT;
+    int line_count = INIT_BASE_VERTICE_COUNT;
+    int first_point = 0;
+    int point_count = 0;
+    // the overlay and then the trajectories come last and are drawn as GL_LINES straight from the vertex buffer;
+    // overlay_count covers both
+    int first_overlay = 0;
+    int first_trajectory = 0;
+    int overlay_count = 0;
 
     plot();
 
+    size_t function_count() const;
     void add_function();
     void remove_function();
     void set_vertices();
+    void set_overlay(const std::vector<vertex>& lines);
+    void set_trajectories(const std::vector<vertex>& lines);
+    // the masks are only stored; refresh_indices rebuilds the indices once however many of them changed
+    void set_visible(int i, const std::vector<unsigned char>& cells);
+    void set_valid(int i, const std::vector<unsigned char>& cells);
+    void refresh_indices();
+    void set_cloud(int i, const std::vector<vertex>& points);
     void update_axes(std::array<int, 6>& axes);
+    // moves only the height axis, leaving every evaluated grid in place
+    void update_height_axis(int low, int high);
+    // clamps and stores the bounds, leaving the grid as it is for the evaluation that follows to lay out
+    void set_bounds(int i, std::array<int, 4>& bounds);
     void update_bounds(int i, std::array<int, 4>& bounds);
+    // like set_bounds, but when the new bounds are the old ones moved by whole samples, the samples both share
+    // are moved to where they now lie, and shift receives the move in rows and columns.
+    // the rows and columns it exposes hold stale samples until they are evaluated again
+    bool shift_bounds(int i, std::array<int, 4>& bounds, std::array<int, 2>& shift);
+    // the smallest moves along x and z that shift_bounds accepts for function i
+    std::array<int, 2> pan_steps(int i) const;
 private:
+    bool stale = false;
+
+    std::vector<vertex> base_vertices() const;
+    size_t overlay_size() const;
+    // lays function k's samples out flat over its bounds
+    void fill_grid(size_t k);
     void update_vertices();
+    void update_spans();
+    void update_clouds();
+    void update_overlay();
+    void update_indices();
 };
 }
 
@@ -0,0 +1,28 @@
+#ifndef MINE_POINTS_HPP
+#define MINE_POINTS_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <mine/enums.hpp>
+
+namespace mine {
+struct point_set {
+    size_t count;
+    size_t binned;
+    // an even sample of at most the requested size, for drawing as a point cloud
+    std::vector<vertex> cloud;
+    // one flag per grid cell, set when all four corners received points
+    std::vector<unsigned char> visible;
+};
+
+// streams a file of (x, y, z) points once, split across threads through a memory mapping. text files hold
+// one point per line with the numbers separated by commas, semicolons or whitespace, and lines that do not
+// start with three numbers (headers, comments) are skipped; .bin files are raw float32 triples. points inside
+// bounds are averaged into the nearest vertex of the rows x columns grid, so memory stays at the grid and
+// the sample however large the file is
+bool load_points(const std::string& path, const std::array<int, 4>& bounds, float index, vertex* grid, int rows, int columns, size_t sample_size, point_set& out);
+}
+
+#endif
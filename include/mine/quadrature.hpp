@@ -0,0 +1,37 @@
+#ifndef MINE_QUADRATURE_HPP
+#define MINE_QUADRATURE_HPP
+
+#include <array>
+
+#include <mine/expression.hpp>
+
+namespace mine {
+enum quadrature_rules {
+    SIMPSON,
+    GAUSS_LEGENDRE,
+    ADAPTIVE
+};
+
+// the integral of a height field over its bounds rectangle with an estimate of the absolute error
+struct integral {
+    double value;
+    double error;
+    long long evaluations;
+    int regions;
+    bool converged;
+};
+
+// composite Simpson on panels x panels (rounded up to a multiple of 4); the error is the Richardson estimate
+// against the rule on every other point, which costs no extra evaluations
+integral integrate_simpson(const expression& function, const std::array<int, 4>& bounds, int panels);
+
+// tensor Gauss-Legendre of the given order on cells x cells; the error is the difference from one order lower
+integral integrate_gauss(const expression& function, const std::array<int, 4>& bounds, int cells, int order);
+
+// tensor Gauss-Kronrod 7-15 cubature; a queue keeps the regions ordered by error, and each round the worst
+// regions are split into quadrants and their children evaluated across threads until the error is below
+// tolerance (absolute, or relative to the value when that is larger) or max_regions is reached
+integral integrate_adaptive(const expression& function, const std::array<int, 4>& bounds, double tolerance, int max_regions);
+}
+
+#endif
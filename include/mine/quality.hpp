@@ -0,0 +1,40 @@
+#ifndef MINE_QUALITY_HPP
+#define MINE_QUALITY_HPP
+
+#include <array>
+
+#include <glad/glad.h>
+
+namespace mine {
+// times the scene pass with GL_TIME_ELAPSED queries and trades render scale and MSAA samples against a
+// frame-time target: samples are dropped before resolution, and resolution comes back before samples
+class quality {
+    std::array<GLuint, 4> queries;
+    int issued;
+    int collected;
+    bool timing;
+    double average;
+    int settle;
+    int calm;
+public:
+    bool automatic;
+    float target;
+    float scale;
+    int samples;
+    int max_samples;
+
+    quality();
+
+    void create();
+    void destroy();
+    void begin();
+    void end();
+    // folds in finished timings and returns true when scale or samples changed
+    bool update();
+    // folds in one frame time in milliseconds, as update does for each finished query
+    bool add_frame(double milliseconds);
+    double get_frame_time() const;
+};
+}
+
+#endif
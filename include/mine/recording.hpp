@@ -0,0 +1,65 @@
+#ifndef MINE_RECORDING_HPP
+#define MINE_RECORDING_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mine {
+enum record_kinds {
+    RECORD_ANGLES,
+    RECORD_ZOOM,
+    RECORD_DATA,
+    RECORD_SCREEN,
+    RECORD_FUNCTION,
+    RECORD_PUSH,
+    RECORD_POP,
+    RECORD_AXES,
+    RECORD_PAN
+};
+
+// one camera call or GUI edit. only the fields its kind uses reach the file:
+// ANGLES  values = theta, phi          ZOOM   integers = in, out
+// DATA    values = radius, theta, phi  SCREEN values = width, height
+// FUNCTION integers = index, kind, bounds[4], values = parameters[4], functions = source
+// PUSH    integers = kind, bounds[4], values = parameters[4], functions = source
+// POP     nothing                      AXES   integers = axes[6], functions = every source
+// PAN     values = forward, right
+struct record {
+    uint32_t frame;
+    uint32_t time;
+    int kind;
+    std::array<float, 4> values;
+    std::array<int, 6> integers;
+    std::vector<std::string> functions;
+};
+
+// a session's camera calls and edits stamped with the frame they landed in and microseconds since the start,
+// so a replay can apply them on the same frames no matter how long each frame takes
+class recording {
+    std::vector<record> records;
+    size_t cursor;
+    uint32_t frame;
+    uint32_t elapsed;
+    std::chrono::steady_clock::time_point start;
+public:
+    bool active;
+
+    recording();
+
+    void begin();
+    // stamps and keeps r while recording is active
+    void add(record r);
+    void next_frame();
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+    // hands out the records stamped with frame in the order they were made; false once there are no more
+    bool next(uint32_t frame, record& out);
+    uint32_t get_frames() const;
+    double get_seconds() const;
+};
+}
+
+#endif
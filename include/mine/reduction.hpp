@@ -0,0 +1,26 @@
+#ifndef MINE_REDUCTION_HPP
+#define MINE_REDUCTION_HPP
+
+#include <limits>
+
+#include <mine/enums.hpp>
+
+namespace mine {
+// the finite heights of a grid span [low, high]; NaN and infinite heights are only counted. with no finite
+// height low > high
+struct height_range {
+    float low = std::numeric_limits<float>::infinity();
+    float high = -std::numeric_limits<float>::infinity();
+    int non_finite = 0;
+};
+
+// folds count heights into range, four at a time where SSE2 is available
+void accumulate(height_range& range, const float* heights, int count);
+void merge(height_range& into, const height_range& other);
+
+// the range of the y of count vertices, split across threads; for grids nothing was evaluated into, such as
+// binned data or stored meshes, since evaluation fuses the same reduction into its own pass
+height_range reduce_heights(const vertex* grid, int count);
+}
+
+#endif
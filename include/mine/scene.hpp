@@ -0,0 +1,46 @@
+#ifndef MINE_SCENE_HPP
+#define MINE_SCENE_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <mine/enums.hpp>
+#include <mine/mapping.hpp>
+
+namespace mine {
+struct scene_function {
+    int kind;
+    std::array<int, 4> bounds;
+    std::array<float, 4> parameters;
+    std::string source;
+    std::vector<unsigned char> visible;
+};
+
+// a versioned scene file: axes, camera and every function, optionally followed by the evaluated vertices
+// exactly as plot::vertices lays out its axes and function grids. open() maps the file instead of reading
+// it, so the vertices point straight into the page cache and stay valid until close()
+class scene {
+    mapped_file file;
+public:
+    std::array<int, 6> axes;
+    // radius, theta, phi, then the center the camera orbits
+    std::array<float, 6> view;
+    std::vector<scene_function> functions;
+    int base_vertice_count;
+    const vertex* vertices;
+    size_t vertex_count;
+
+    scene();
+    ~scene();
+    scene(const scene&) = delete;
+    scene& operator=(const scene&) = delete;
+
+    // vertices may be null to store only what is needed to evaluate the scene again
+    bool save(const std::string& path, const vertex* vertices, size_t vertex_count) const;
+    bool open(const std::string& path);
+    void close();
+};
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef MINE_SOLVER_HPP
+#define MINE_SOLVER_HPP
+
+#include <array>
+#include <vector>
+
+#include <mine/enums.hpp>
+#include <mine/expression.hpp>
+
+namespace mine {
+enum point_kinds {
+    MINIMUM,
+    MAXIMUM,
+    SADDLE,
+    DEGENERATE,
+    ZERO
+};
+
+struct critical_point {
+    double x;
+    double y;
+    double f;
+    int kind;
+};
+
+// seeds Levenberg-Marquardt iterations from every cell of a function's domain, BATCH lanes at a time per thread,
+// then merges the converged lanes through a spatial hash
+class solver {
+    std::vector<std::vector<critical_point>> partials;
+public:
+    std::vector<critical_point> points{};
+
+    solver();
+
+    void find_critical_points(const expression& function, const std::array<int, 4>& bounds, int seeds);
+    void find_zeros(const expression& function, const std::array<int, 4>& bounds, int seeds);
+    void clear();
+    void markers(std::vector<vertex>& lines, float size) const;
+private:
+    void solve(const expression& function, const std::array<int, 4>& bounds, int seeds, bool zeros);
+    void merge(double radius);
+};
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef MINE_TERRAIN_HPP
+#define MINE_TERRAIN_HPP
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <mine/enums.hpp>
+
+namespace mine {
+// writes the tile pyramid of a raw float32 raster (row-major, width x height) stretched over
+// extent = { min x, min z, max x, max z }. the raster is mapped, not read, and tiles are written one at a time,
+// so rasters larger than memory can be converted
+bool build_tiles(const std::string& raster_path, int width, int height, const std::array<float, 4>& extent, const std::string& path);
+
+// a height field too large for memory, drawn as a clipmap: nested square rings of a fixed vertex count around
+// the camera center, each twice as coarse as the one inside it. the tiles under the rings are read on a
+// background thread into a fixed number of cache slots with least recently used eviction; until a tile
+// arrives its area is drawn from the nearest coarser tile that is resident, and the coarsest level is always
+// resident. the mesh has its own fixed-size buffers and is drawn with the graphics pipeline as it is bound
+class terrain {
+    struct tile {
+        uint64_t key;
+        std::vector<float> heights;
+    };
+    // the tiles under one ring at a level, two by two from tile (x, y); null where a tile is not resident
+    struct window {
+        long long x;
+        long long y;
+        std::array<const std::vector<float>*, 4> tiles;
+    };
+
+    std::string path;
+    int width;
+    int height;
+    int tile_size;
+    int levels;
+    std::array<float, 4> extent;
+    std::vector<std::array<int, 2>> tile_counts;
+    std::vector<uint64_t> level_offsets;
+
+    size_t budget;
+    std::list<tile> cache;
+    std::unordered_map<uint64_t, std::list<tile>::iterator> lookup;
+    tile root;
+
+    std::thread loader;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable arrived;
+    std::deque<uint64_t> requests;
+    std::vector<tile> loaded;
+    uint64_t reading;
+    bool stopping;
+
+    int finest;
+    std::vector<std::array<long long, 2>> origins;
+    // one per level, filled for each ring before it is sampled
+    std::vector<window> windows;
+    std::vector<vertex> vertices;
+    std::vector<GLuint> indices;
+    GLuint vao;
+    GLuint vbo;
+    GLuint ibo;
+    GLsizei index_count;
+public:
+    terrain();
+    ~terrain();
+    terrain(const terrain&) = delete;
+    terrain& operator=(const terrain&) = delete;
+
+    // cache_tiles is the RAM budget in tiles; it is raised to what one clipmap needs
+    bool open(const std::string& path, size_t cache_tiles);
+    void close();
+    bool is_open() const;
+    // moves the rings to center, picking the finest level from the camera distance, queues the tiles they
+    // need and takes in the ones that arrived; with wait it returns only once every needed tile is resident.
+    // returns true when the mesh changed
+    bool update(const glm::vec3& center, float distance, bool wait = false);
+    void draw() const;
+private:
+    void run();
+    uint64_t tile_offset(uint64_t key) const;
+    const std::vector<float>* find(uint64_t key);
+    // looks up the tiles under a ring starting at sample first of level, at that level and every coarser one
+    void resolve(int level, const std::array<long long, 2>& first);
+    float sample(int level, long long u, long long v) const;
+    void build_mesh();
+};
+}
+
+#endif
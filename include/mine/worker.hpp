@@ -0,0 +1,132 @@
+#ifndef MINE_WORKER_HPP
+#define MINE_WORKER_HPP
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <mine/enums.hpp>
+#include <mine/evaluator.hpp>
+#include <mine/expression.hpp>
+#include <mine/reduction.hpp>
+
+namespace mine {
+// a fixed capacity ring for exactly one pushing and one popping thread; neither side ever locks, each only
+// publishes its own counter once the slot it touched is finished with
+template <typename T, size_t N>
+class ring_queue {
+    std::array<T, N> slots{};
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+public:
+    bool push(T&& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        slots[t % N] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(slots[h % N]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+struct evaluation_job {
+    int index;
+    uint64_t version;
+    // HEIGHT, or COMPLEX colored with relief
+    int kind;
+    bool relief;
+    expression function;
+    std::array<int, 4> bounds;
+    double low;
+    double high;
+    bool cull;
+    bool clip;
+    std::array<float, 16> view;
+    // the back buffer the grid is written into, so the one being drawn is never half written
+    std::vector<vertex> grid;
+    std::shared_ptr<std::atomic<bool>> cancelled;
+};
+
+struct evaluation_result {
+    int index;
+    uint64_t version;
+    int kind;
+    expression function;
+    std::vector<vertex> grid;
+    std::vector<unsigned char> visible;
+    height_range heights;
+    bool completed;
+};
+
+// evaluates CPU height fields and complex functions on a thread of its own. every submit is a new version of its function and
+// cancels the older ones still queued or running, so retyping only ever costs the newest edit; finished
+// grids come back through a second ring and are taken in by the render thread with collect()
+class evaluation_worker {
+    static constexpr size_t CAPACITY = 64;
+
+    ring_queue<evaluation_job, CAPACITY> jobs;
+    ring_queue<evaluation_result, CAPACITY> results;
+    // the render thread's side: newest version and its cancel flag per function, plus recycled back buffers
+    std::vector<uint64_t> versions;
+    std::vector<std::shared_ptr<std::atomic<bool>>> flags;
+    std::vector<std::vector<vertex>> spare;
+    size_t outstanding;
+    int rows;
+    int columns;
+
+    std::thread thread;
+    // only parks the idle worker; jobs and results never pass through it
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<bool> stopping;
+public:
+    evaluation_worker();
+    ~evaluation_worker();
+    evaluation_worker(const evaluation_worker&) = delete;
+    evaluation_worker& operator=(const evaluation_worker&) = delete;
+
+    void start(int rows, int columns);
+    void stop();
+    bool running() const;
+    // false when the queue is full, in which case nothing was cancelled and the caller evaluates in place;
+    // view, when given, culls the grid's cells like cull_cells
+    bool submit(int index, const expression& function, const std::array<int, 4>& bounds, const culling* view);
+    // the same for a complex function, colored like evaluate_complex_field
+    bool submit_complex(int index, const expression& function, const std::array<int, 4>& bounds, bool relief);
+    // makes whatever is in flight for index stale, for when its grid is replaced some other way
+    void cancel(int index);
+    // true while the newest evaluation submitted for index has not come back through collect()
+    bool pending(int index) const;
+    // the next finished evaluation that is still the newest for its function; its grid goes back through recycle()
+    bool collect(evaluation_result& result);
+    void recycle(std::vector<vertex>&& grid);
+    // true while any submitted job has not come back through collect(), stale ones included
+    bool busy() const;
+private:
+    bool push(evaluation_job&& job);
+    void run();
+};
+}
+
+#endif
@@ -2,29 +2,59 @@
 
 layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
 
-layout(std430, binding = 0) buffer input_data {
-    float data[];
-};
-
+// five words per vertex: x, y, z, the packed color and the packed normal
 layout(std430, binding = 1) buffer output_data {
-    float result[];
+    uint result[];
 };
 
 uniform float i;
+uniform int kind;
+uniform int rows;
+uniform int columns;
+// min x, max x, min y, max y of the domain the rows x columns samples span
+uniform vec4 bounds;
+
+const int CURVE = 2;
+const float pi = 3.1415926535;
+const float tube_radius = 0.05;
+
+vec3 f(float x, float y) {
+    float u = x;
+    float v = y;
+    float t = x;
+    return 
+}
+
+vec3 tube(float t, uint column) {
+    float h = 0.001;
+    vec3 center = f(t, 0.0);
+    vec3 tangent = f(t + h, 0.0) - f(t - h, 0.0);
+    if (length(tangent) < 1e-6) {
+        tangent = vec3(1.0, 0.0, 0.0);
+    }
+    tangent = normalize(tangent);
+    vec3 up = abs(tangent.z) < 0.99 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 normal = normalize(cross(tangent, up));
+    vec3 binormal = cross(tangent, normal);
+    float angle = 2.0 * pi * float(column) / float(columns - 1);
+    return center + tube_radius * (cos(angle) * normal + sin(angle) * binormal);
+}
 
 void main() {
     uint idx = gl_GlobalInvocationID.x;
-    float x = data[idx * 6];
-    float y = data[idx * 6 + 2];
-    float z = 
+    uint row = idx / uint(columns);
+    uint column = idx % uint(columns);
+    float x = bounds.x + float(row) * ((bounds.y - bounds.x) / float(rows - 1));
+    float y = bounds.z + float(column) * ((bounds.w - bounds.z) / float(columns - 1));
+    vec3 p = kind == CURVE ? tube(x, column) : f(x, y);
+    float z = p.z;
     float r = abs(sin(z / 2.0 + i)) / 1.2;
-    float g = abs(sin(z / 2.0 + 3.1415926535 / 3 + 6.0 * i)) / 1.2;
-    float b = abs(sin(z / 2.0 + (2 * 3.1415926535) / 3) + i / 15.0) / 1.2;
-
-    result[idx * 6] = x;
-    result[idx * 6 + 1] = z;
-    result[idx * 6 + 2] = y;
-    result[idx * 6 + 3] = r;
-    result[idx * 6 + 4] = g;
-    result[idx * 6 + 5] = b;
+    float g = abs(sin(z / 2.0 + pi / 3.0 + 6.0 * i)) / 1.2;
+    float b = abs(sin(z / 2.0 + 2.0 * pi / 3.0) + i / 15.0) / 1.2;
+
+    result[idx * 5] = floatBitsToUint(p.x);
+    result[idx * 5 + 1] = floatBitsToUint(z);
+    result[idx * 5 + 2] = floatBitsToUint(p.y);
+    result[idx * 5 + 3] = packUnorm4x8(vec4(r, g, b, 1.0));
+    result[idx * 5 + 4] = 0u;
 }
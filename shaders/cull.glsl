@@ -0,0 +1,63 @@
+#version 460 core
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+struct draw_command {
+    uint count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+
+struct draw_parameters {
+    vec4 low;
+    vec4 high;
+    vec4 tint;
+    vec4 range;
+};
+
+layout(std430, binding = 4) readonly buffer parameter_data {
+    draw_parameters parameters[];
+};
+
+layout(std430, binding = 5) readonly buffer source_data {
+    draw_command sources[];
+};
+
+layout(std430, binding = 6) writeonly buffer command_data {
+    draw_command commands[];
+};
+
+uniform mat4 u_view_matrix;
+uniform int u_count;
+
+// a box is outside when all eight corners lie beyond the same clip plane
+bool outside(vec3 low, vec3 high) {
+    if (any(greaterThan(low, high))) {
+        return true;
+    }
+
+    bvec3 beyond_low = bvec3(true);
+    bvec3 beyond_high = bvec3(true);
+    for (int c = 0; c < 8; ++c) {
+        vec3 corner = vec3((c & 1) != 0 ? high.x : low.x, (c & 2) != 0 ? high.y : low.y, (c & 4) != 0 ? high.z : low.z);
+        vec4 clip = u_view_matrix * vec4(corner, 1.0);
+        beyond_low = bvec3(beyond_low.x && clip.x < -clip.w, beyond_low.y && clip.y < -clip.w, beyond_low.z && clip.z < -clip.w);
+        beyond_high = bvec3(beyond_high.x && clip.x > clip.w, beyond_high.y && clip.y > clip.w, beyond_high.z && clip.z > clip.w);
+    }
+    return any(beyond_low) || any(beyond_high);
+}
+
+void main() {
+    int k = int(gl_GlobalInvocationID.x);
+    if (k >= u_count) {
+        return;
+    }
+
+    draw_command command = sources[k];
+    if (outside(parameters[k].low.xyz, parameters[k].high.xyz)) {
+        command.instance_count = 0u;
+    }
+    commands[k] = command;
+}
@@ -0,0 +1,68 @@
+#version 460 core
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+layout(std430, binding = 1) readonly buffer output_data {
+    uint result[];
+};
+
+// one byte per cell, four to a uint, so the buffer reads back as the cell mask itself
+layout(std430, binding = 8) buffer flag_data {
+    uint flags[];
+};
+
+uniform int rows;
+uniform int columns;
+// jump_limit in main.cpp picks it for the kind, as it does for flag_cells; 0 skips the jump test
+uniform float jump;
+
+vec3 position(int i, int j) {
+    int idx = i * columns + j;
+    return vec3(
+        uintBitsToFloat(result[idx * 5]),
+        uintBitsToFloat(result[idx * 5 + 1]),
+        uintBitsToFloat(result[idx * 5 + 2])
+    );
+}
+
+bool finite(vec3 p) {
+    return !any(isnan(p)) && !any(isinf(p));
+}
+
+// the change from a neighbour outside the grid or one that is not finite predicts nothing
+float predicted(int i, int j, float from) {
+    if (i < 0 || i >= rows || j < 0 || j >= columns) {
+        return 0.0;
+    }
+    float y = position(i, j).y;
+    return isnan(y) || isinf(y) ? 0.0 : y - from;
+}
+
+// the edge from (i, j) to (i + di, j + dj) against the edges either side of it, as in mine::flag_cells
+bool breaks(int i, int j, int di, int dj) {
+    float a = position(i, j).y;
+    float b = position(i + di, j + dj).y;
+    float change = b - a;
+    float previous = -predicted(i - di, j - dj, a);
+    float next = predicted(i + 2 * di, j + 2 * dj, b);
+    return abs(change - previous) > max(jump, abs(previous)) && abs(change - next) > max(jump, abs(next));
+}
+
+// the same test as mine::flag_cells: four finite corners and no edge breaking with its neighbours by more than jump
+void main() {
+    int cell = int(gl_GlobalInvocationID.x);
+    int cells = columns - 1;
+    if (cell >= (rows - 1) * cells) {
+        return;
+    }
+
+    int i = cell / cells;
+    int j = cell % cells;
+    if (!finite(position(i, j)) || !finite(position(i, j + 1)) || !finite(position(i + 1, j)) || !finite(position(i + 1, j + 1))) {
+        return;
+    }
+    if (jump > 0.0 && (breaks(i, j, 0, 1) || breaks(i + 1, j, 0, 1) || breaks(i, j, 1, 0) || breaks(i, j + 1, 1, 0))) {
+        return;
+    }
+    atomicOr(flags[cell / 4], 1u << (8 * (cell % 4)));
+}
@@ -1,9 +1,25 @@
 #version 460 core
 
 in vec4 v_colors;
+in vec3 v_position;
+in vec4 v_normal;
+
+uniform vec3 u_camera_position;
 
 out vec4 color;
 
 void main() {
-    color = v_colors;
+    if (v_normal.w < 0.5 || length(v_normal.xyz) < 0.001) {
+        color = v_colors;
+        return;
+    }
+
+    // headlight Blinn-Phong: the light sits at the camera, so the half vector is the view vector
+    vec3 l = normalize(u_camera_position - v_position);
+    vec3 n = normalize(v_normal.xyz);
+    n = dot(n, l) < 0.0 ? -n : n;
+    float diffuse = max(dot(n, l), 0.0);
+    float specular = pow(diffuse, 48.0);
+
+    color = vec4(v_colors.rgb * (0.3 + 0.7 * diffuse) + 0.2 * specular, v_colors.a);
 }
\ No newline at end of file
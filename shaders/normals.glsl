@@ -0,0 +1,39 @@
+#version 460 core
+
+layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;
+
+layout(std430, binding = 1) buffer output_data {
+    uint result[];
+};
+
+uniform int rows;
+uniform int columns;
+
+vec3 position(int i, int j) {
+    int idx = i * columns + j;
+    return vec3(
+        uintBitsToFloat(result[idx * 5]),
+        uintBitsToFloat(result[idx * 5 + 1]),
+        uintBitsToFloat(result[idx * 5 + 2])
+    );
+}
+
+void main() {
+    int idx = int(gl_GlobalInvocationID.x);
+    if (idx >= rows * columns) {
+        return;
+    }
+
+    int i = idx / columns;
+    int j = idx % columns;
+    vec3 u = position(min(i + 1, rows - 1), j) - position(max(i - 1, 0), j);
+    vec3 v = position(i, min(j + 1, columns - 1)) - position(i, max(j - 1, 0));
+    vec3 n = cross(v, u);
+
+    uint packed = 0u;
+    if (length(n) > 1e-10) {
+        ivec3 q = ivec3(round(normalize(n) * 511.0));
+        packed = uint(q.x & 1023) | (uint(q.y & 1023) << 10) | (uint(q.z & 1023) << 20) | (1u << 30);
+    }
+    result[idx * 5 + 4] = packed;
+}
@@ -0,0 +1,60 @@
+#version 460 core
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+layout(std430, binding = 1) readonly buffer output_data {
+    uint result[];
+};
+
+layout(std430, binding = 7) buffer range_data {
+    uint low;
+    uint high;
+    uint non_finite;
+};
+
+uniform int count;
+
+shared uint lows[256];
+shared uint highs[256];
+shared uint invalid[256];
+
+// flips the bits of a float so that unsigned order is float order, letting atomicMin and atomicMax compare heights
+uint ordered(float f) {
+    uint u = floatBitsToUint(f);
+    return (u & 0x80000000u) != 0u ? ~u : u | 0x80000000u;
+}
+
+void main() {
+    uint local = gl_LocalInvocationID.x;
+    int idx = int(gl_GlobalInvocationID.x);
+
+    lows[local] = 0xFFFFFFFFu;
+    highs[local] = 0u;
+    invalid[local] = 0u;
+    if (idx < count) {
+        float y = uintBitsToFloat(result[idx * 5 + 1]);
+        if (isnan(y) || isinf(y)) {
+            invalid[local] = 1u;
+        } else {
+            lows[local] = ordered(y);
+            highs[local] = ordered(y);
+        }
+    }
+    barrier();
+
+    // a tree over the workgroup, then one atomic per workgroup instead of one per vertex
+    for (uint stride = 128u; stride > 0u; stride >>= 1) {
+        if (local < stride) {
+            lows[local] = min(lows[local], lows[local + stride]);
+            highs[local] = max(highs[local], highs[local + stride]);
+            invalid[local] += invalid[local + stride];
+        }
+        barrier();
+    }
+
+    if (local == 0u) {
+        atomicMin(low, lows[0]);
+        atomicMax(high, highs[0]);
+        atomicAdd(non_finite, invalid[0]);
+    }
+}
@@ -1,16 +1,52 @@
 #version 460 core
 
 layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 colors;
+layout(location = 1) in vec4 colors;
+layout(location = 2) in vec4 normal;
+
+struct draw_parameters {
+   vec4 low;
+   vec4 high;
+   vec4 tint;
+   vec4 range;
+};
+
+layout(std430, binding = 4) readonly buffer parameter_data {
+   draw_parameters parameters[];
+};
 
 uniform mat4 u_view_matrix;
+// set for the indirect surface draw, where gl_DrawID is the function index; the lines have no entry
+uniform bool u_surfaces;
 
 out vec4 v_colors;
+out vec3 v_position;
+out vec4 v_normal;
+
+// a polynomial fit of the viridis colormap over t in [0, 1]
+vec3 colormap(float t) {
+   const vec3 c0 = vec3(0.2777273272234177, 0.005407344544966578, 0.3340998053353061);
+   const vec3 c1 = vec3(0.1050930431085774, 1.404613529898575, 1.384590162594685);
+   const vec3 c2 = vec3(-0.3308618287255563, 0.214847559468213, 0.09509516302823659);
+   const vec3 c3 = vec3(-4.634230498983486, -5.799100973351585, -19.33244095627987);
+   const vec3 c4 = vec3(6.228269936347081, 14.17993336680509, 56.69055260068105);
+   const vec3 c5 = vec3(4.776384997670288, -13.74514537774601, -65.35303263337234);
+   const vec3 c6 = vec3(-5.435455855934631, 4.645852612178535, 26.3124352495832);
+   return c0 + t * (c1 + t * (c2 + t * (c3 + t * (c4 + t * (c5 + t * c6)))));
+}
 
 void main() {
    vec4 view_position = u_view_matrix * vec4(position, 1.0f);
    
    gl_Position = view_position;
 
-   v_colors = vec4(colors, 1.0f);
+   vec3 color = colors.rgb;
+   // range = low, high, then whether to color by height at all
+   if (u_surfaces && parameters[gl_DrawID].range.z != 0.0f) {
+      vec4 range = parameters[gl_DrawID].range;
+      color = colormap(clamp((position.y - range.x) / max(range.y - range.x, 1e-6f), 0.0f, 1.0f));
+   }
+   v_colors = vec4(color, 1.0f) * (u_surfaces ? parameters[gl_DrawID].tint : vec4(1.0f));
+   v_position = position;
+   v_normal = normal;
 }
\ No newline at end of file
@@ -1,6 +1,16 @@
+#include <algorithm>
 #include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <glad/glad.h>
@@ -9,11 +19,35 @@
 #include <imgui/imgui_impl_opengl3.h>
 #define SDL_MAIN_HANDLED
 #include <SDL2/SDL.h>
+#ifdef MINE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
+#include <mine/allocation.hpp>
 #include <mine/camera.hpp>
+#include <mine/compaction.hpp>
+#include <mine/contour.hpp>
 #include <mine/enums.hpp>
+#include <mine/evaluator.hpp>
+#include <mine/expression.hpp>
+#include <mine/flow.hpp>
+#include <mine/framebuffer.hpp>
+#include <mine/image.hpp>
+#include <mine/indirect.hpp>
+#include <mine/normals.hpp>
+#include <mine/picking.hpp>
 #include <mine/pipeline.hpp>
 #include <mine/plot.hpp>
+#include <mine/points.hpp>
+#include <mine/quadrature.hpp>
+#include <mine/quality.hpp>
+#include <mine/recording.hpp>
+#include <mine/reduction.hpp>
+#include <mine/scene.hpp>
+#include <mine/solver.hpp>
+#include <mine/terrain.hpp>
+#include <mine/worker.hpp>
 
 constexpr int INITIAL_SCREEN_WIDTH = 960;
 constexpr int INITIAL_SCREEN_HEIGHT = 720;
@@ -22,8 +56,37 @@ constexpr float INITIAL_RADIUS = 13.1f;
 constexpr float INITIAL_THETA = 45.0f;
 constexpr float INITIAL_PHI = 65.0f;
 
+// points kept from each data file for the cloud; every point still counts toward the binned surface
+constexpr size_t CLOUD_POINTS = 1 << 20;
+// terrain tiles kept in memory, about 17 MB
+constexpr size_t TERRAIN_TILES = 256;
+// how far one arrow key press moves the center, as a share of the camera distance
+constexpr float PAN_STEP = 0.1f;
+// functions laid out per page of the GUI
+constexpr int FUNCTIONS_SHOWN = 8;
+// bytes the frame arena starts with; it grows once if a frame needs more
+constexpr size_t FRAME_ARENA = 1 << 14;
+// frames without input or changes before --check-allocations expects a frame to allocate nothing
+constexpr int QUIET_FRAMES = 120;
+// frames a moving camera goes between offscreen re-culls; counted in frames so replays cull on the same ones
+constexpr int CULL_FRAMES = 8;
+// evaluations a Gauss-Legendre integral may take, about what Simpson does at its 4096 panels; it runs in the frame
+constexpr long long GAUSS_EVALUATIONS = 1 << 24;
+
+// allocations the last frame made on the render thread, in total and within the GUI and scene passes
+struct frame_allocations {
+    mine::allocation_stats total;
+    mine::allocation_stats gui;
+    mine::allocation_stats scene;
+};
+
 SDL_Window *g_window{};
 SDL_DisplayMode g_display_mode{};
+#ifdef MINE_EGL
+EGLDisplay g_egl_display = EGL_NO_DISPLAY;
+EGLContext g_egl_context = EGL_NO_CONTEXT;
+EGLSurface g_egl_surface = EGL_NO_SURFACE;
+#endif
 
 GLuint g_VAO{};
 GLuint g_VBO{};
@@ -31,14 +94,121 @@ GLuint g_IBO{};
 
 mine::graphics_pipeline g_graphics_pipeline{};
 mine::compute_pipeline g_compute_pipeline{};
+mine::compute_pipeline g_normal_pipeline{};
+mine::compute_pipeline g_cull_pipeline{};
+mine::compute_pipeline g_range_pipeline{};
+mine::compute_pipeline g_flag_pipeline{};
+GLint g_surfaces_location = -1;
+mine::draw_list g_draws{};
+int g_highlighted = -1;
 mine::plot g_plot{};
 mine::camera g_camera{};
+mine::contour g_contour{};
+mine::solver g_solver{};
+mine::flow g_flow{};
+// the function whose slope field is drawn, or -1; the dragged seeds are traced on top of it
+int g_flow_index = -1;
+std::vector<std::array<double, 2>> g_flow_seeds{};
+bool g_seed_dragging = false;
+std::vector<mine::pyramid> g_pyramids{};
+// the height range of each function, reduced while it was evaluated
+std::vector<mine::height_range> g_heights{};
+mine::hit g_hit{};
+bool g_picked = false;
+mine::framebuffer g_scene{};
+mine::quality g_quality{};
+mine::recording g_recording{};
+mine::terrain g_terrain{};
+// CPU height fields are evaluated here while the window is up; headless renders and replays evaluate in place
+mine::evaluation_worker g_worker{};
+// GUI labels and anything else that only lives one frame
+mine::frame_arena g_frame{FRAME_ARENA};
+frame_allocations g_allocations{};
+bool g_check_allocations = false;
+int g_allocation_failures = 0;
+// events polled since the last frame, which make the frame not a steady one
+int g_events = 0;
+bool g_scene_ready = false;
 
 bool g_running = true;
+bool g_headless = false;
+// set while a recording plays back, so nothing in a frame depends on how fast the last one ran
+bool g_replaying = false;
+// set when the plot changed behind the GUI's back, so its text fields are refilled from the plot
+bool g_gui_stale = false;
+bool g_gpu_normals = true;
+bool g_cpu_evaluation = false;
+bool g_cull_range = false;
+bool g_cull_offscreen = false;
+// panning a CPU height field by whole samples keeps the samples the old and new bounds share
+bool g_incremental_pan = false;
+bool g_fit_heights = false;
+bool g_colormap = false;
+// the least jump between samples that, when the slope either side does not predict it, leaves a cell undrawn; 0 keeps them all
+float g_jump_limit = 10.0f;
+// complex functions show log|f| as height, or lie flat with it as brightness
+bool g_complex_relief = true;
 
 std::bitset<4> g_change{"1000"};
+std::vector<std::array<int, 2>> g_op_counts{};
+// per data file function, how many points it loaded and how long that took, shown under its path
+std::vector<std::string> g_load_notes{};
+// what the last scene opened and how long it took, shown under the scene controls
+std::string g_scene_status{};
+// the span of plot vertices changed since the last upload, empty when first > last
+std::array<size_t, 2> g_dirty{SIZE_MAX, 0};
+// how many vertices the vertex buffer holds, which can be more than the plot has
+size_t g_vertex_capacity = 0;
 
 double g_refresh_time{};
+
+void setup_gl(int width, int height) {
+    std::cout << "Vender: " << glGetString(GL_VENDOR) << std::endl;
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+    std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
+    std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
+
+    glEnable(GL_MULTISAMPLE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+    glPointSize(2.0f);
+    glViewport(0, 0, width, height);
+
+    g_camera.set_screen((float)width, (float)height);
+    g_camera.set_data(INITIAL_RADIUS, INITIAL_THETA, INITIAL_PHI);
+    g_camera.set_center(mine::INITIAL_BOUNDS[0]);
+
+    g_graphics_pipeline.set_program("./shaders/vertex.glsl", "./shaders/fragment.glsl", "u_view_matrix", "u_camera_position");
+    g_surfaces_location = glGetUniformLocation(g_graphics_pipeline.get_program(), "u_surfaces");
+
+    if (!g_normal_pipeline.set_program("./shaders/normals.glsl")) {
+        std::cerr << "Error: Failed to build the normal pass, computing normals on the CPU" << std::endl;
+        g_gpu_normals = false;
+    }
+
+    g_draws.create();
+    if (!g_cull_pipeline.set_program("./shaders/cull.glsl")) {
+        std::cerr << "Error: Failed to build the cull pass, drawing every function" << std::endl;
+    }
+    g_draws.set_program(g_cull_pipeline.get_program());
+    if (!g_range_pipeline.set_program("./shaders/range.glsl")) {
+        std::cerr << "Error: Failed to build the range pass, reducing GPU heights on the CPU" << std::endl;
+    }
+    if (!g_flag_pipeline.set_program("./shaders/flags.glsl")) {
+        std::cerr << "Error: Failed to build the flag pass, flagging cells on the CPU" << std::endl;
+    }
+}
+
+// the scene target follows the window at the controller's scale and sample count
+void resize_scene() {
+    g_scene_ready = g_scene.set_size(
+        std::max(1, (int)(g_camera.screen_width * g_quality.scale)),
+        std::max(1, (int)(g_camera.screen_height * g_quality.scale)),
+        g_quality.samples
+    );
+}
+
 //test
 void setup() {
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
@@ -49,8 +219,8 @@ void setup() {
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 1);
-    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLESAMPLES, 8);
+    // the scene is multisampled in its own framebuffer, the window only ever receives the resolved image and the GUI
+    SDL_GL_SetAttribute(SDL_GL_MULTISAMPLEBUFFERS, 0);
     SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
     SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
 
@@ -78,18 +248,14 @@ void setup() {
         exit(1);
     }
 
-    std::cout << "Vender: " << glGetString(GL_VENDOR) << std::endl;
-    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
-    std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
-    std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
-
-    glEnable(GL_MULTISAMPLE);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
-    glViewport(0, 0, INITIAL_SCREEN_WIDTH, INITIAL_SCREEN_HEIGHT);
+    setup_gl(INITIAL_SCREEN_WIDTH, INITIAL_SCREEN_HEIGHT);
 
     IMGUI_CHECKVERSION();
+    // ImGui allocates through malloc, so it is pointed at the counted allocator to show up in the frame counts
+    ImGui::SetAllocatorFunctions(
+        [](size_t size, void*) { return mine::counted_allocate(size); },
+        [](void* pointer, void*) { mine::counted_free(pointer); }
+    );
     ImGui::CreateContext();
     ImGuiIO& io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
@@ -99,39 +265,358 @@ void setup() {
     ImGui_ImplSDL2_InitForOpenGL(g_window, gl_context);
     ImGui_ImplOpenGL3_Init("#version 460 core\n");
 
-    g_camera.set_screen((float)INITIAL_SCREEN_WIDTH, (float)INITIAL_SCREEN_HEIGHT);
-    g_camera.set_data(INITIAL_RADIUS, INITIAL_THETA, INITIAL_PHI);
-    g_camera.set_center(mine::INITIAL_BOUNDS[0]);
-
-    g_graphics_pipeline.set_program("./shaders/vertex.glsl", "./shaders/fragment.glsl", "u_view_matrix");
+    g_quality.create();
+    resize_scene();
 
     if (!SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(g_window), &g_display_mode)) {
         g_refresh_time = 1.0 / g_display_mode.refresh_rate;
     }
 }
 
-bool update_function(const std::string& function, int index) {
-    if (!g_compute_pipeline.set_program("./shaders/compute.glsl", function, index)) {
+// a context with nothing on screen: everything is drawn into an offscreen framebuffer
+void setup_headless(int width, int height) {
+#ifdef MINE_EGL
+    // the surfaceless Mesa platform needs no X or Wayland server; other drivers get the default display
+    auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display) {
+        g_egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (g_egl_display == EGL_NO_DISPLAY) {
+        g_egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint major = 0;
+    EGLint minor = 0;
+    if (g_egl_display == EGL_NO_DISPLAY || !eglInitialize(g_egl_display, &major, &minor) || !eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "Error: Failed to initialize EGL (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        exit(1);
+    }
+
+    const char* extensions = eglQueryString(g_egl_display, EGL_EXTENSIONS);
+    bool surfaceless = extensions && std::strstr(extensions, "EGL_KHR_surfaceless_context");
+
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config{};
+    EGLint config_count = 0;
+    if (!eglChooseConfig(g_egl_display, config_attributes, &config, 1, &config_count) || config_count == 0) {
+        std::cerr << "Error: No EGL config supports desktop OpenGL" << std::endl;
+        exit(1);
+    }
+
+    const EGLint context_attributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 6,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    g_egl_context = eglCreateContext(g_egl_display, config, EGL_NO_CONTEXT, context_attributes);
+
+    // drawing never touches the default framebuffer, so a 1x1 pbuffer only stands in where surfaceless is missing
+    if (!surfaceless) {
+        const EGLint pbuffer_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        g_egl_surface = eglCreatePbufferSurface(g_egl_display, config, pbuffer_attributes);
+    }
+    if (g_egl_context == EGL_NO_CONTEXT || !eglMakeCurrent(g_egl_display, g_egl_surface, g_egl_surface, g_egl_context)) {
+        std::cerr << "Error: Failed to create EGL OpenGL context (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        exit(1);
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cerr << "Error: Failed to initialize glad" << std::endl;
+        exit(1);
+    }
+#else
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        std::cerr << "Error: Failed to initialize SDL video subsytem\nSDL Error: " << SDL_GetError() << std::endl;
+        exit(1);
+    }
+
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 6);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+
+    g_window = SDL_CreateWindow("MA_385_Project", 0, 0, 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (!g_window || !SDL_GL_CreateContext(g_window)) {
+        std::cerr << "Error: Failed to create hidden window\nSDL Error: " << SDL_GetError() << std::endl;
+        exit(1);
+    }
+
+    if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) {
+        std::cerr << "Error: Failed to initialize glad" << std::endl;
+        exit(1);
+    }
+#endif
+
+    setup_gl(width, height);
+}
+
+void build_pyramid(int index) {
+    if (g_pyramids.size() < g_plot.function_count()) {
+        g_pyramids.resize(g_plot.function_count());
+    }
+    g_pyramids[index].build(
+        &g_plot.vertices[g_plot.base_vertice_count + index * mine::FUNCTION_VERTICE_COUNT],
+        mine::X_RECTS + 1,
+        mine::Z_RECTS + 1,
+        g_plot.valid[index]
+    );
+}
+
+void set_heights(int index, const mine::height_range& range) {
+    if (g_heights.size() < g_plot.function_count()) {
+        g_heights.resize(g_plot.function_count());
+    }
+    g_heights[index] = range;
+}
+
+// the range over every function, which both the fitted axis and the colormap use
+mine::height_range all_heights() {
+    mine::height_range range{};
+    for (size_t i = 0; i < g_plot.function_count() && i < g_heights.size(); ++i) {
+        mine::merge(range, g_heights[i]);
+    }
+    return range;
+}
+
+// widens the span the next scene upload sends, so editing one function sends only its own grid
+void touch_vertices(size_t first, size_t count) {
+    g_dirty = {std::min(g_dirty[0], first), std::max(g_dirty[1], first + count)};
+}
+
+// the vertex buffer leaves room for the overlay to double, so a growing overlay is still sent in place
+size_t vertex_capacity() {
+    return g_plot.vertices.size() + g_plot.overlay_count;
+}
+
+void set_op_counts(int index, std::array<int, 2> counts) {
+    if ((size_t)index >= g_op_counts.size()) {
+        g_op_counts.resize(index + 1);
+    }
+    g_op_counts[index] = counts;
+}
+
+// stretches the height axis to the whole numbers around every function, which only rewrites the axis lines
+void fit_height_axis() {
+    mine::height_range range = all_heights();
+    if (!(range.low <= range.high)) {
+        return;
+    }
+    int low = (int)std::floor(std::max(range.low, -1000.0f));
+    int high = (int)std::ceil(std::min(range.high, 1000.0f));
+    if (std::min(low, 0) == g_plot.axes[mine::NEG_Y_AXIS] && std::max(high, 0) == g_plot.axes[mine::POS_Y_AXIS]) {
+        return;
+    }
+    g_plot.update_height_axis(low, high);
+    touch_vertices(0, g_plot.base_vertice_count);
+    g_gui_stale = true;
+    g_change[mine::SCENE] = true;
+}
+
+void pick(float mouse_x, float mouse_y) {
+    glm::vec3 origin{};
+    glm::vec3 direction{};
+    g_camera.ray(mouse_x, mouse_y, origin, direction);
+
+    // t runs from the near plane at 0 to the far plane at 1
+    g_hit.t = 1.0f;
+    g_picked = false;
+    for (size_t i = 0; i < g_plot.function_count() && i < g_pyramids.size(); ++i) {
+        const mine::vertex* grid = &g_plot.vertices[g_plot.base_vertice_count + i * mine::FUNCTION_VERTICE_COUNT];
+        if (g_pyramids[i].intersect(grid, origin, direction, g_hit)) {
+            g_hit.function = (int)i;
+            g_picked = true;
+        }
+    }
+}
+
+void set_visible(int index, const std::vector<unsigned char>& cells) {
+    if (cells.empty() && g_plot.visible[index].empty()) {
+        return;
+    }
+    g_plot.set_visible(index, cells);
+    g_change[mine::SIZE] = true;
+}
+
+void set_valid(int index, std::vector<unsigned char>& cells) {
+    // a mask that keeps every cell is stored empty, so the index rebuild can skip it
+    if (std::find(cells.begin(), cells.end(), 0) == cells.end()) {
+        cells.clear();
+    }
+    if (cells == g_plot.valid[index]) {
+        return;
+    }
+    g_plot.set_valid(index, cells);
+    g_change[mine::SIZE] = true;
+}
+
+// the jump both flag passes test a kind's cells against: height and complex grids are heights over the domain, where
+// a pole or branch cut shows up as a jump, and the parametric kinds are not tested at all
+float jump_limit(int kind) {
+    return kind == mine::HEIGHT || kind == mine::COMPLEX ? g_jump_limit : 0.0f;
+}
+
+// leaves cells with a non-finite corner, and cells with a jump the slope around it does not predict, out of the
+// triangles, so poles and branch cuts are not bridged by spikes through the axis box
+void flag_function(int index) {
+    std::vector<unsigned char> cells{};
+    mine::flag_cells(
+        &g_plot.vertices[g_plot.base_vertice_count + index * mine::FUNCTION_VERTICE_COUNT],
+        mine::X_RECTS + 1,
+        mine::Z_RECTS + 1,
+        jump_limit(g_plot.kinds[index]),
+        cells
+    );
+    set_valid(index, cells);
+}
+
+void evaluate_function(const mine::expression& function, int index) {
+    // patches the interval bounds prove invisible are never sampled
+    bool cull = g_cull_range || g_cull_offscreen;
+    mine::culling view{
+        g_cull_range ? (double)g_plot.axes[mine::NEG_Y_AXIS] : -std::numeric_limits<double>::infinity(),
+        g_cull_range ? (double)g_plot.axes[mine::POS_Y_AXIS] : std::numeric_limits<double>::infinity(),
+        g_cull_offscreen ? &g_camera.view[0][0] : nullptr
+    };
+    if (g_worker.running() && g_worker.submit(index, function, g_plot.bounds[index], cull ? &view : nullptr)) {
+        g_compute_pipeline.set_function(function.get_source(), mine::HEIGHT, index);
+        return;
+    }
+
+    std::vector<unsigned char> cells{};
+    if (cull) {
+        mine::cull_cells(function, g_plot.bounds[index], mine::X_RECTS + 1, mine::Z_RECTS + 1, view, cells);
+    }
+
+    mine::height_range heights{};
+    mine::evaluate_height_field(
+        function,
+        g_plot.bounds[index],
+        (float)index,
+        &g_plot.vertices[g_plot.base_vertice_count + index * mine::FUNCTION_VERTICE_COUNT],
+        mine::X_RECTS + 1,
+        mine::Z_RECTS + 1,
+        cells.empty() ? nullptr : &cells,
+        &heights
+    );
+    touch_vertices(g_plot.base_vertice_count + index * mine::FUNCTION_VERTICE_COUNT, mine::FUNCTION_VERTICE_COUNT);
+    set_heights(index, heights);
+    set_visible(index, cells);
+    flag_function(index);
+    build_pyramid(index);
+    g_compute_pipeline.set_function(function.get_source(), mine::HEIGHT, index);
+}
+
+// re-evaluates the CPU height fields after the culling inputs change, leaving GPU evaluated ones alone
+void refresh_culling() {
+    for (size_t i = 0; i < g_plot.function_count(); ++i) {
+        mine::expression parsed{};
+        if (g_plot.kinds[i] == mine::HEIGHT && (g_cpu_evaluation || !g_plot.visible[i].empty()) && parsed.parse(g_compute_pipeline.get_function(i))) {
+            evaluate_function(parsed, i);
+        }
+    }
+    g_change[mine::SCENE] = true;
+}
+
+// complex functions have no shader of their own, so they are always colored on the CPU, on the worker while
+// it is up
+bool evaluate_complex(const std::string& function, int index) {
+    mine::expression parsed{};
+    if (!parsed.parse(function, true)) {
+        std::cerr << "Error: " << parsed.get_error() << " in " << function << std::endl;
         return false;
     }
+    set_op_counts(index, {parsed.parsed_size(), parsed.size()});
+    g_compute_pipeline.set_function(function, mine::COMPLEX, index);
+    if (g_worker.running() && g_worker.submit_complex(index, parsed, g_plot.bounds[index], g_complex_relief)) {
+        return true;
+    }
 
-    GLuint input_buffer;
-    glGenBuffers(1, &input_buffer);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, input_buffer);
-    glBufferData(
-        GL_SHADER_STORAGE_BUFFER,
-        g_plot.functions[index].size() * sizeof(mine::vertex),
-        g_plot.functions[index].data(),
-        GL_STATIC_READ
+    mine::height_range heights{};
+    mine::evaluate_complex_field(
+        parsed,
+        g_plot.bounds[index],
+        &g_plot.vertices[g_plot.base_vertice_count + index * mine::FUNCTION_VERTICE_COUNT],
+        mine::X_RECTS + 1,
+        mine::Z_RECTS + 1,
+        g_complex_relief,
+        &heights
     );
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, input_buffer);
+    touch_vertices(g_plot.base_vertice_count + index * mine::FUNCTION_VERTICE_COUNT, mine::FUNCTION_VERTICE_COUNT);
+    set_heights(index, heights);
+    set_visible(index, {});
+    flag_function(index);
+    build_pyramid(index);
+    return true;
+}
+
+// a data file is binned into the function's grid like a height field and sampled into its point cloud
+bool load_data(const std::string& path, int index) {
+    auto start = std::chrono::steady_clock::now();
+    mine::point_set points{};
+    mine::vertex* grid = &g_plot.vertices[g_plot.base_vertice_count + index * mine::FUNCTION_VERTICE_COUNT];
+    if (!mine::load_points(path, g_plot.bounds[index], (float)index, grid, mine::X_RECTS + 1, mine::Z_RECTS + 1, CLOUD_POINTS, points)) {
+        return false;
+    }
 
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if ((size_t)index >= g_load_notes.size()) {
+        g_load_notes.resize(index + 1);
+    }
+    std::array<char, 128> note{};
+    std::snprintf(note.data(), note.size(), "%zu points, %zu inside the bounds, %.1f ms", points.count, points.binned, milliseconds);
+    g_load_notes[index] = note.data();
+
+    g_compute_pipeline.set_function(path, mine::POINTS, index);
+    set_op_counts(index, {});
+    set_visible(index, points.visible);
+    set_heights(index, mine::reduce_heights(grid, mine::FUNCTION_VERTICE_COUNT));
+    g_plot.set_cloud(index, points.cloud);
+    flag_function(index);
+    build_pyramid(index);
+    g_change[mine::SIZE] = true;
+    return true;
+}
+
+bool update_function(const std::string& function, int index) {
+    g_worker.cancel(index);
+    if (g_plot.kinds[index] == mine::POINTS) {
+        return load_data(function, index);
+    }
+    if (!g_plot.clouds[index].empty()) {
+        g_plot.set_cloud(index, {});
+        g_change[mine::SIZE] = true;
+    }
+    if (g_plot.kinds[index] == mine::COMPLEX) {
+        return evaluate_complex(function, index);
+    }
+
+    // height fields the CPU parser understands skip the shader compile entirely; anything else falls back to the GPU
+    mine::expression parsed{};
+    bool valid = g_plot.kinds[index] == mine::HEIGHT && parsed.parse(function);
+    if (g_cpu_evaluation && valid) {
+        evaluate_function(parsed, index);
+        set_op_counts(index, {parsed.parsed_size(), parsed.size()});
+        return true;
+    }
+
+    if (!g_compute_pipeline.set_program("./shaders/compute.glsl", function, g_plot.kinds[index], index)) {
+        return false;
+    }
+    set_visible(index, {});
+    set_op_counts(index, {valid ? parsed.parsed_size() : 0, valid ? parsed.size() : 0});
+
+    // the shader generates the sample positions from the bounds, or the parameter ranges of a parametric function,
+    // so only the output needs a buffer
     GLuint output_buffer;
     glGenBuffers(1, &output_buffer);
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, output_buffer);
     glBufferData(
         GL_SHADER_STORAGE_BUFFER,
-        g_plot.functions[index].size() * sizeof(mine::vertex),
+        mine::FUNCTION_VERTICE_COUNT * sizeof(mine::vertex),
         nullptr,
         GL_DYNAMIC_COPY
     );
@@ -139,46 +624,503 @@ bool update_function(const std::string& function, int index) {
 
     glUseProgram(g_compute_pipeline.get_program());
     glUniform1f(glGetUniformLocation(g_compute_pipeline.get_program(), "i"), index);
-    glDispatchCompute(g_plot.functions[index].size(), 1, 1);
+    glUniform1i(glGetUniformLocation(g_compute_pipeline.get_program(), "kind"), g_plot.kinds[index]);
+    glUniform1i(glGetUniformLocation(g_compute_pipeline.get_program(), "rows"), mine::X_RECTS + 1);
+    glUniform1i(glGetUniformLocation(g_compute_pipeline.get_program(), "columns"), mine::Z_RECTS + 1);
+    const std::array<int, 4>& bounds = g_plot.bounds[index];
+    std::array<float, 4> domain{(float)bounds[0], (float)bounds[1], (float)bounds[2], (float)bounds[3]};
+    if (mine::parametric(g_plot.kinds[index])) {
+        domain = g_plot.parameters[index];
+    }
+    glUniform4f(glGetUniformLocation(g_compute_pipeline.get_program(), "bounds"), domain[0], domain[1], domain[2], domain[3]);
+    glDispatchCompute(mine::FUNCTION_VERTICE_COUNT, 1, 1);
     glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
-    glUseProgram(0);
 
-    float* results = (float*)glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
+    if (g_gpu_normals) {
+        glUseProgram(g_normal_pipeline.get_program());
+        glUniform1i(glGetUniformLocation(g_normal_pipeline.get_program(), "rows"), mine::X_RECTS + 1);
+        glUniform1i(glGetUniformLocation(g_normal_pipeline.get_program(), "columns"), mine::Z_RECTS + 1);
+        glDispatchCompute((mine::FUNCTION_VERTICE_COUNT + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
 
-    for (std::vector<mine::vertex>::size_type j = 0; j < (mine::X_RECTS + 1) * (mine::Z_RECTS + 1); ++j) {
-        g_plot.vertices[g_plot.base_vertice_count + index * ((mine::X_RECTS + 1) * (mine::Z_RECTS + 1)) + j].x = results[j * 6];
-        g_plot.vertices[g_plot.base_vertice_count + index * ((mine::X_RECTS + 1) * (mine::Z_RECTS + 1)) + j].y = results[j * 6 + 1];
-        g_plot.vertices[g_plot.base_vertice_count + index * ((mine::X_RECTS + 1) * (mine::Z_RECTS + 1)) + j].z = results[j * 6 + 2];
-        g_plot.vertices[g_plot.base_vertice_count + index * ((mine::X_RECTS + 1) * (mine::Z_RECTS + 1)) + j].r = results[j * 6 + 3];
-        g_plot.vertices[g_plot.base_vertice_count + index * ((mine::X_RECTS + 1) * (mine::Z_RECTS + 1)) + j].g = results[j * 6 + 4];
-        g_plot.vertices[g_plot.base_vertice_count + index * ((mine::X_RECTS + 1) * (mine::Z_RECTS + 1)) + j].b = results[j * 6 + 5];
+    // min, max and non-finite count reduced on the GPU while the heights are still in its buffer
+    GLuint range_buffer = 0;
+    if (g_range_pipeline.get_program()) {
+        const GLuint initial[3] = {0xFFFFFFFFu, 0u, 0u};
+        glGenBuffers(1, &range_buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, range_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(initial), initial, GL_DYNAMIC_READ);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, range_buffer);
+
+        glUseProgram(g_range_pipeline.get_program());
+        glUniform1i(glGetUniformLocation(g_range_pipeline.get_program(), "count"), mine::FUNCTION_VERTICE_COUNT);
+        glDispatchCompute((mine::FUNCTION_VERTICE_COUNT + 255) / 256, 1, 1);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        GLuint reduced[3]{};
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(reduced), reduced);
+        // undoes the bit flip that made the floats compare as unsigned integers
+        auto height = [](GLuint bits) {
+            bits = (bits & 0x80000000u) ? bits & 0x7FFFFFFFu : ~bits;
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        };
+        mine::height_range heights{};
+        if (reduced[0] <= reduced[1]) {
+            heights.low = height(reduced[0]);
+            heights.high = height(reduced[1]);
+        }
+        heights.non_finite = (int)reduced[2];
+        set_heights(index, heights);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, output_buffer);
+    }
+
+    // the cells worth drawing, flagged while the grid is still in its buffer; four flags to a uint read back as bytes
+    std::vector<unsigned char> cells{};
+    if (g_flag_pipeline.get_program()) {
+        cells.resize(((size_t)mine::X_RECTS * mine::Z_RECTS + 3) / 4 * 4);
+        GLuint flag_buffer = 0;
+        glGenBuffers(1, &flag_buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, flag_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, cells.size(), nullptr, GL_DYNAMIC_READ);
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, flag_buffer);
+
+        glUseProgram(g_flag_pipeline.get_program());
+        glUniform1i(glGetUniformLocation(g_flag_pipeline.get_program(), "rows"), mine::X_RECTS + 1);
+        glUniform1i(glGetUniformLocation(g_flag_pipeline.get_program(), "columns"), mine::Z_RECTS + 1);
+        glUniform1f(glGetUniformLocation(g_flag_pipeline.get_program(), "jump"), jump_limit(g_plot.kinds[index]));
+        glDispatchCompute((mine::X_RECTS * mine::Z_RECTS + 63) / 64, 1, 1);
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, cells.size(), cells.data());
+        cells.resize((size_t)mine::X_RECTS * mine::Z_RECTS);
+        glDeleteBuffers(1, &flag_buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, output_buffer);
     }
+    glUseProgram(0);
 
+    mine::vertex* grid = &g_plot.vertices[g_plot.base_vertice_count + index * mine::FUNCTION_VERTICE_COUNT];
+
+    // the output buffer is laid out exactly like mine::vertex
+    const void* results = glMapBuffer(GL_SHADER_STORAGE_BUFFER, GL_READ_ONLY);
+    std::memcpy(grid, results, mine::FUNCTION_VERTICE_COUNT * sizeof(mine::vertex));
     glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    touch_vertices(g_plot.base_vertice_count + index * mine::FUNCTION_VERTICE_COUNT, mine::FUNCTION_VERTICE_COUNT);
+
+    if (!g_gpu_normals) {
+        mine::compute_normals(grid, mine::X_RECTS + 1, mine::Z_RECTS + 1);
+    }
+    if (!range_buffer) {
+        set_heights(index, mine::reduce_heights(grid, mine::FUNCTION_VERTICE_COUNT));
+    }
+
     glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 
-    glDeleteBuffers(1, &input_buffer);
     glDeleteBuffers(1, &output_buffer);
+    glDeleteBuffers(1, &range_buffer);
+
+    if (cells.empty()) {
+        flag_function(index);
+    } else {
+        set_valid(index, cells);
+    }
+    build_pyramid(index);
 
     return true;
 }
 
-void vertex_specification() {
+// the overlay and the trajectories are last in the vertex buffer, so unless they outgrew it only the lines from
+// first on are sent
+void send_lines(size_t first) {
+    if (g_plot.vertices.size() > g_vertex_capacity) {
+        g_change[mine::SIZE] = true;
+    } else if (g_plot.vertices.size() > first) {
+        touch_vertices(first, g_plot.vertices.size() - first);
+        g_change[mine::SCENE] = true;
+    } else {
+        g_change[mine::SCREEN] = true;
+    }
+}
+
+void update_overlay() {
+    g_contour.clear();
+
+    for (size_t i = 0; i < g_plot.function_count(); ++i) {
+        if (g_plot.kinds[i] != mine::HEIGHT) {
+            continue;
+        }
+        g_contour.extract(
+            &g_plot.vertices[g_plot.base_vertice_count + i * mine::FUNCTION_VERTICE_COUNT],
+            mine::X_RECTS + 1,
+            mine::Z_RECTS + 1,
+            g_plot.valid[i]
+        );
+    }
+
+    std::vector<mine::vertex> lines = g_contour.segments;
+    g_solver.markers(lines, 0.08f);
+    g_flow.lines(lines);
+
+    g_plot.set_overlay(lines);
+    lines.clear();
+    g_flow.seed_lines(lines);
+    g_plot.set_trajectories(lines);
+    send_lines(g_plot.first_overlay);
+}
+
+// only the dragged seeds' trajectories, which follow the overlay
+void update_trajectories() {
+    std::vector<mine::vertex> lines{};
+    g_flow.seed_lines(lines);
+    g_plot.set_trajectories(lines);
+    send_lines(g_plot.first_trajectory);
+}
+
+// takes in the grids the worker finished since the last frame; a grid is only ever copied in, and so
+// uploaded, once it is complete. the worker's buffer is the back buffer, but the front one is a slice of
+// g_plot.vertices, which keeps every grid back to back for the single upload and the indirect draw's base
+// vertices, so it cannot be swapped with a vector; one copy of a finished grid is the price of that layout
+void collect_evaluations() {
+    mine::evaluation_result result{};
+    bool collected = false;
+    while (g_worker.collect(result)) {
+        if (result.index < (int)g_plot.function_count() && g_plot.kinds[result.index] == result.kind) {
+            size_t first = g_plot.base_vertice_count + result.index * mine::FUNCTION_VERTICE_COUNT;
+            std::memcpy(&g_plot.vertices[first], result.grid.data(), mine::FUNCTION_VERTICE_COUNT * sizeof(mine::vertex));
+            touch_vertices(first, mine::FUNCTION_VERTICE_COUNT);
+            set_heights(result.index, result.heights);
+            set_visible(result.index, result.visible);
+            flag_function(result.index);
+            build_pyramid(result.index);
+            collected = true;
+        }
+        g_worker.recycle(std::move(result.grid));
+    }
+
+    if (collected) {
+        if (!g_plot.overlay.empty()) {
+            update_overlay();
+        }
+        g_change[mine::SCENE] = true;
+    }
+}
+
+// blocks until every submitted evaluation is in, for anything that reads the grids right away
+void finish_evaluations() {
+    while (g_worker.busy()) {
+        std::this_thread::yield();
+        collect_evaluations();
+    }
+}
+
+// moves a CPU height field to bounds that keep its sample spacing, evaluating only the strips the move exposes;
+// false when the grid has to be evaluated whole
+bool pan_function(int index, int kind, std::array<int, 4>& bounds, const std::string& function) {
+    if (!g_incremental_pan || !g_cpu_evaluation || g_cull_range || g_cull_offscreen || kind != mine::HEIGHT ||
+        g_plot.kinds[index] != mine::HEIGHT || !g_plot.visible[index].empty() || g_worker.pending(index) ||
+        function != g_compute_pipeline.get_function(index)) {
+        return false;
+    }
+    mine::expression parsed{};
+    if (!parsed.parse(function)) {
+        return false;
+    }
+
+    std::array<int, 2> shift{};
+    if (!g_plot.shift_bounds(index, bounds, shift)) {
+        return false;
+    }
+
+    // the exposed rows whole, then the exposed columns of the rows that were kept
+    int rows = mine::X_RECTS + 1;
+    int columns = mine::Z_RECTS + 1;
+    std::array<int, 2> kept_rows{std::max(0, -shift[0]), rows - std::max(0, shift[0])};
+    size_t first = g_plot.base_vertice_count + index * mine::FUNCTION_VERTICE_COUNT;
+    mine::vertex* grid = &g_plot.vertices[first];
+    mine::evaluate_height_block(parsed, g_plot.bounds[index], (float)index, grid, rows, columns, {0, kept_rows[0], 0, columns});
+    mine::evaluate_height_block(parsed, g_plot.bounds[index], (float)index, grid, rows, columns, {kept_rows[1], rows, 0, columns});
+    if (shift[1] > 0) {
+        mine::evaluate_height_block(parsed, g_plot.bounds[index], (float)index, grid, rows, columns, {kept_rows[0], kept_rows[1], columns - shift[1], columns});
+    } else if (shift[1] < 0) {
+        mine::evaluate_height_block(parsed, g_plot.bounds[index], (float)index, grid, rows, columns, {kept_rows[0], kept_rows[1], 0, -shift[1]});
+    }
+
+    // every vertex moved in the buffer, but the ones that were kept cost a copy and no evaluation
+    touch_vertices(first, mine::FUNCTION_VERTICE_COUNT);
+    set_heights(index, mine::reduce_heights(grid, mine::FUNCTION_VERTICE_COUNT));
+    flag_function(index);
+    build_pyramid(index);
+    if (!g_plot.overlay.empty()) {
+        update_overlay();
+    }
+    return true;
+}
+
+// a function's domain is a stretch of the ground, but a parametric function's parameters are not, so it is
+// centered on the box its evaluated vertices span instead
+void center_function(int index) {
+    if (mine::parametric(g_plot.kinds[index]) && index < (int)g_pyramids.size()) {
+        g_camera.set_center(g_pyramids[index].get_box());
+    } else {
+        g_camera.set_center(g_plot.bounds[index]);
+    }
+}
+
+// every GUI edit to the plot goes through these, so they are also where a recording picks the edits up
+bool submit_function(int index, int kind, std::array<int, 4>& bounds, const std::array<float, 4>& parameters, const std::string& function) {
+    g_recording.add({0, 0, mine::RECORD_FUNCTION, parameters, {index, kind, bounds[0], bounds[1], bounds[2], bounds[3]}, {function}});
+    std::array<int, 4> previous = g_plot.bounds[index];
+    std::array<float, 4> previous_parameters = g_plot.parameters[index];
+    if (pan_function(index, kind, bounds, function)) {
+        g_camera.set_center(g_plot.bounds[index]);
+        g_change[mine::SCENE] = true;
+        return true;
+    }
+    // every evaluation lays the grid out itself, so the old surface stays up until the new one is in
+    g_plot.set_bounds(index, bounds);
+    g_plot.parameters[index] = parameters;
+    g_plot.kinds[index] = kind;
+    bool valid = update_function(function, index);
+    if (!valid) {
+        g_plot.kinds[index] = g_compute_pipeline.get_kind(index);
+        g_plot.bounds[index] = previous;
+        g_plot.parameters[index] = previous_parameters;
+    }
+    center_function(index);
+    // a grid handed to the worker is uploaded when collect_evaluations copies it in, not before
+    if (!g_worker.pending(index)) {
+        g_change[mine::SCENE] = true;
+    }
+    return valid;
+}
+
+// a new grid handed to the worker has nothing to show until it comes back, so its cells stay undrawn until then
+void hide_pending(int index) {
+    if (g_worker.pending(index)) {
+        std::vector<unsigned char> cells((size_t)mine::X_RECTS * mine::Z_RECTS, 0);
+        set_valid(index, cells);
+    }
+}
+
+void push_function(int kind, std::array<int, 4>& bounds, const std::array<float, 4>& parameters, const std::string& function) {
+    g_recording.add({0, 0, mine::RECORD_PUSH, parameters, {kind, bounds[0], bounds[1], bounds[2], bounds[3]}, {function}});
+    int index = (int)g_plot.function_count();
+    g_plot.add_function();
+    g_plot.update_bounds(index, bounds);
+    g_plot.parameters[index] = parameters;
+    g_plot.kinds[index] = kind;
+    update_function(function, index);
+    hide_pending(index);
+    g_change[mine::SIZE] = true;
+}
+
+void pop_function() {
+    g_recording.add({0, 0, mine::RECORD_POP, {}, {}, {}});
+    g_worker.cancel((int)g_plot.function_count() - 1);
+    g_plot.remove_function();
+    g_change[mine::SIZE] = true;
+}
+
+void set_axes(std::array<int, 6>& axes, const std::vector<std::string>& functions) {
+    g_recording.add({0, 0, mine::RECORD_AXES, {}, axes, functions});
+    g_plot.update_axes(axes);
+    for (size_t i = 0; i < functions.size() && i < g_plot.function_count(); ++i) {
+        update_function(functions[i], (int)i);
+    }
+    g_change[mine::SIZE] = true;
+}
+
+// traces y' = f(x, y) for g_flow_index into g_flow, or only the dragged seeds when the field is unchanged;
+// returns an error for the GUI, empty on success
+std::string trace_flow(bool seeds_only) {
+    if (g_flow_index < 0 || g_flow_index >= (int)g_plot.function_count()) {
+        g_flow.clear();
+        return "";
+    }
+    mine::expression function{};
+    if (g_plot.kinds[g_flow_index] != mine::HEIGHT) {
+        g_flow.clear();
+        return "only height fields define a slope field";
+    }
+    if (!function.parse(g_compute_pipeline.get_function(g_flow_index))) {
+        g_flow.clear();
+        return function.get_error();
+    }
+    if (!seeds_only) {
+        g_flow.trace(function, g_plot.bounds[g_flow_index]);
+    }
+    g_flow.trace_seeds(function, g_plot.bounds[g_flow_index], g_flow_seeds);
+    return "";
+}
+
+// moves the dragged seed to where the cursor meets the floor and re-integrates only its trajectory
+void drag_seed(float mouse_x, float mouse_y) {
+    glm::vec3 origin{};
+    glm::vec3 direction{};
+    g_camera.ray(mouse_x, mouse_y, origin, direction);
+    if (direction.y == 0.0f) {
+        return;
+    }
+    float t = -origin.y / direction.y;
+    if (t < 0.0f || t > 1.0f) {
+        return;
+    }
+    g_flow_seeds = {{origin.x + t * direction.x, origin.z + t * direction.z}};
+    // a field that no longer traces clears the whole flow, not only the seeds
+    if (trace_flow(true).empty()) {
+        update_trajectories();
+    } else {
+        update_overlay();
+    }
+}
+
+void zoom(bool in, bool out) {
+    g_recording.add({0, 0, mine::RECORD_ZOOM, {}, {in, out}, {}});
+    g_camera.zoom(in, out);
+    g_change[mine::CAMERA] = true;
+}
+
+void rotate(float theta, float phi) {
+    g_recording.add({0, 0, mine::RECORD_ANGLES, {theta, phi}, {}, {}});
+    g_camera.update_angles(theta, phi);
+    g_change[mine::CAMERA] = true;
+}
+
+void reset_camera() {
+    g_recording.add({0, 0, mine::RECORD_DATA, {INITIAL_RADIUS, INITIAL_THETA, INITIAL_PHI}, {}, {}});
+    g_camera.set_data(INITIAL_RADIUS, INITIAL_THETA, INITIAL_PHI);
+    g_change[mine::CAMERA] = true;
+}
+
+void pan(float forward, float right) {
+    g_recording.add({0, 0, mine::RECORD_PAN, {forward, right}, {}, {}});
+    g_camera.pan(forward, right);
+    g_change[mine::CAMERA] = true;
+}
+
+void resize_screen(int width, int height) {
+    g_recording.add({0, 0, mine::RECORD_SCREEN, {(float)width, (float)height}, {}, {}});
+    g_camera.set_screen(width, height);
+    glViewport(0, 0, g_camera.screen_width, g_camera.screen_height);
+    resize_scene();
+    if (!SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(g_window), &g_display_mode)) {
+        g_refresh_time = 1.0 / g_display_mode.refresh_rate;
+    }
+    g_change[mine::SCREEN] = true;
+}
+
+bool save_scene(const std::string& path, bool meshes) {
+    finish_evaluations();
+    mine::scene scene{};
+    scene.axes = g_plot.axes;
+    scene.view = {g_camera.get_radius(), g_camera.theta, g_camera.phi, g_camera.center.x, g_camera.center.y, g_camera.center.z};
+    scene.base_vertice_count = g_plot.base_vertice_count;
+    for (size_t i = 0; i < g_plot.function_count(); ++i) {
+        scene.functions.push_back({g_plot.kinds[i], g_plot.bounds[i], g_plot.parameters[i], g_compute_pipeline.get_function(i), g_plot.visible[i]});
+    }
+    // the overlay is rebuilt from the grids, so only the axes and function grids are stored
+    size_t count = g_plot.base_vertice_count + g_plot.function_count() * mine::FUNCTION_VERTICE_COUNT;
+    return scene.save(path, meshes ? g_plot.vertices.data() : nullptr, count);
+}
+
+// with stored meshes nothing is evaluated or compiled: the grids are copied out of the mapping and only
+// the pick pyramids are rebuilt. a scene saved under different grid dimensions falls back to evaluating
+bool open_scene(const std::string& path) {
+    auto start = std::chrono::steady_clock::now();
+    mine::scene scene{};
+    if (!scene.open(path)) {
+        return false;
+    }
+    while (g_plot.function_count() > scene.functions.size()) {
+        g_plot.remove_function();
+    }
+    while (g_plot.function_count() < scene.functions.size()) {
+        g_plot.add_function();
+    }
+    g_plot.update_axes(scene.axes);
+    for (size_t i = 0; i < scene.functions.size(); ++i) {
+        g_plot.kinds[i] = scene.functions[i].kind;
+        g_plot.update_bounds(i, scene.functions[i].bounds);
+        g_plot.parameters[i] = scene.functions[i].parameters;
+    }
+
+    g_camera.center = {scene.view[3], scene.view[4], scene.view[5]};
+    g_camera.set_data(scene.view[0], scene.view[1], scene.view[2]);
+
+    size_t count = g_plot.base_vertice_count + g_plot.function_count() * mine::FUNCTION_VERTICE_COUNT;
+    bool meshes = scene.vertices && scene.vertex_count == count && scene.base_vertice_count == g_plot.base_vertice_count;
+    if (meshes) {
+        std::memcpy(g_plot.vertices.data(), scene.vertices, count * sizeof(mine::vertex));
+    }
+    for (size_t i = 0; i < scene.functions.size(); ++i) {
+        const mine::scene_function& function = scene.functions[i];
+        if (meshes && function.kind != mine::POINTS) {
+            g_worker.cancel(i);
+            g_compute_pipeline.set_function(function.source, function.kind, i);
+            set_op_counts(i, {});
+            set_visible(i, function.visible);
+            set_heights(i, mine::reduce_heights(&g_plot.vertices[g_plot.base_vertice_count + i * mine::FUNCTION_VERTICE_COUNT], mine::FUNCTION_VERTICE_COUNT));
+            flag_function(i);
+            build_pyramid(i);
+        } else if (!update_function(function.source, i)) {
+            std::cerr << "Error: Scene function " << i + 1 << " failed to compile" << std::endl;
+        } else {
+            hide_pending(i);
+        }
+    }
+
+    if (!g_plot.overlay.empty()) {
+        update_overlay();
+    }
+    g_gui_stale = true;
+    g_change[mine::SIZE] = true;
+    g_change[mine::CAMERA] = true;
+
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::array<char, 64> took{};
+    std::snprintf(took.data(), took.size(), " in %.1f ms", milliseconds);
+    g_scene_status = "Opened " + path + (meshes ? " with stored meshes" : "") + took.data();
+    return true;
+}
+
+// one indirect command per function over its index range, boxed by its pick pyramid for the cull pass
+void update_draws() {
+    g_plot.refresh_indices();
+    g_highlighted = g_picked ? g_hit.function : -1;
+    g_draws.commands.clear();
+    g_draws.parameters.clear();
+    mine::height_range heights = all_heights();
+    std::array<float, 4> colormap{heights.low, heights.high, g_colormap && heights.low <= heights.high ? 1.0f : 0.0f, 0.0f};
+    for (size_t i = 0; i < g_plot.function_count() && i < g_plot.ranges.size(); ++i) {
+        std::array<float, 6> box = i < g_pyramids.size() ? g_pyramids[i].get_box() : mine::pyramid{}.get_box();
+        float tint = (int)i == g_highlighted ? 1.25f : 1.0f;
+        // the colormap would paint over the phase a complex function is colored by
+        colormap[2] = g_colormap && heights.low <= heights.high && g_plot.kinds[i] != mine::COMPLEX ? 1.0f : 0.0f;
+        g_draws.commands.push_back({g_plot.ranges[i][1], 1, g_plot.ranges[i][0], 0, 0});
+        g_draws.parameters.push_back({{box[0], box[1], box[2], 0.0f}, {box[3], box[4], box[5], 0.0f}, {tint, tint, tint, 1.0f}, colormap});
+    }
+    g_draws.upload();
+}
+
+void vertex_specification(const std::string& scene_path) {
     g_plot.set_vertices();
 
-    update_function(mine::INITIAL_FUNCTIONS[0], 0);
+    if (scene_path.empty() || !open_scene(scene_path)) {
+        update_function(mine::INITIAL_FUNCTIONS[0], 0);
+    }
+    g_plot.refresh_indices();
 
     glGenVertexArrays(1, &g_VAO);
     glBindVertexArray(g_VAO);
 
     glGenBuffers(1, &g_VBO);
     glBindBuffer(GL_ARRAY_BUFFER, g_VBO);
-    glBufferData(
-        GL_ARRAY_BUFFER,
-        g_plot.vertices.size() * sizeof(mine::vertex),
-        g_plot.vertices.data(),
-        GL_STATIC_DRAW
-    );
+    g_vertex_capacity = vertex_capacity();
+    glBufferData(GL_ARRAY_BUFFER, g_vertex_capacity * sizeof(mine::vertex), nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, g_plot.vertices.size() * sizeof(mine::vertex), g_plot.vertices.data());
 
     glGenBuffers(1, &g_IBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, g_IBO);
@@ -202,12 +1144,24 @@ void vertex_specification() {
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(
         1,
-        3,
-        GL_FLOAT,
-        GL_FALSE,
+        4,
+        GL_UNSIGNED_BYTE,
+        GL_TRUE,
+        sizeof(mine::vertex),
+        (GLvoid*)offsetof(mine::vertex, color)
+    );
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(
+        2,
+        4,
+        GL_INT_2_10_10_10_REV,
+        GL_TRUE,
         sizeof(mine::vertex),
-        (GLvoid*)(sizeof(GLfloat) * 3)
+        (GLvoid*)offsetof(mine::vertex, normal)
     );
+
+    update_draws();
 }
 
 void input() {
@@ -219,6 +1173,7 @@ void input() {
     
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
+        g_events++;
         ImGui_ImplSDL2_ProcessEvent(&event);
         switch (event.type) {
             case SDL_QUIT:
@@ -226,8 +1181,7 @@ void input() {
                 break;
             case SDL_MOUSEWHEEL:
                 if (ImGui::GetIO().WantCaptureMouse) { break; }
-                g_camera.zoom(event.wheel.y > 0, event.wheel.y < 0);
-                g_change[mine::CAMERA] = true;
+                zoom(event.wheel.y > 0, event.wheel.y < 0);
                 break;
             case SDL_MOUSEBUTTONDOWN:
                 if (ImGui::GetIO().WantCaptureMouse) { break; }
@@ -237,6 +1191,12 @@ void input() {
                         mouse_y = event.button.y;
                         left_down = true;
                         break;
+                    case SDL_BUTTON_RIGHT:
+                        if (g_flow_index >= 0) {
+                            g_seed_dragging = true;
+                            drag_seed((float)event.button.x, (float)event.button.y);
+                        }
+                        break;
                     default:
                         break;
                 }
@@ -246,27 +1206,46 @@ void input() {
                     case SDL_BUTTON_LEFT:
                         left_down = false;
                         break;
+                    case SDL_BUTTON_RIGHT:
+                        g_seed_dragging = false;
+                        break;
                     default:
                         break;
                 }
                 break;
             case SDL_MOUSEMOTION:
                 if (left_down) {
-                    g_camera.update_angles(
+                    rotate(
                         (event.button.x - mouse_x) / width_speed, 
                         (mouse_y - event.button.y) / height_speed
                     );
                     mouse_x = event.button.x;
                     mouse_y = event.button.y;
-                    g_change[mine::CAMERA] = true;
+                } else if (g_seed_dragging) {
+                    drag_seed((float)event.motion.x, (float)event.motion.y);
+                } else if (!ImGui::GetIO().WantCaptureMouse) {
+                    pick((float)event.motion.x, (float)event.motion.y);
+                } else {
+                    g_picked = false;
                 }
                 break;
             case SDL_KEYDOWN:
                 if (ImGui::GetIO().WantCaptureKeyboard) { break; }
                 switch (event.key.keysym.sym) {
                     case SDLK_x:
-                        g_camera.set_data(INITIAL_RADIUS, INITIAL_THETA, INITIAL_PHI);
-                        g_change[mine::CAMERA] = true;
+                        reset_camera();
+                        break;
+                    case SDLK_UP:
+                        pan(PAN_STEP, 0.0f);
+                        break;
+                    case SDLK_DOWN:
+                        pan(-PAN_STEP, 0.0f);
+                        break;
+                    case SDLK_LEFT:
+                        pan(0.0f, -PAN_STEP);
+                        break;
+                    case SDLK_RIGHT:
+                        pan(0.0f, PAN_STEP);
                         break;
                     default:
                         break;
@@ -275,14 +1254,9 @@ void input() {
             case SDL_WINDOWEVENT:
                 switch (event.window.event) {
                     case SDL_WINDOWEVENT_RESIZED:
-                        g_camera.set_screen(event.window.data1, event.window.data2);
-                        glViewport(0, 0, g_camera.screen_width, g_camera.screen_height);
+                        resize_screen(event.window.data1, event.window.data2);
                         width_speed = 2.0f * expf((g_camera.screen_width - INITIAL_SCREEN_WIDTH) / 1000.0f);
                         height_speed = 2.0f * expf((g_camera.screen_height - INITIAL_SCREEN_HEIGHT) / 1000.0f);
-                        if (!SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(g_window), &g_display_mode)) {
-                            g_refresh_time = 1.0 / g_display_mode.refresh_rate;
-                        }
-                        g_change[mine::SCREEN] = true;
                         break;
                     case SDL_WINDOWEVENT_MOVED:
                         if (!SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(g_window), &g_display_mode)) {
@@ -318,62 +1292,155 @@ void update_GUI() {
 
     ImGui::Text("Functions");
 
-    static int count = 1;
-    static std::array<char[256], 8> input_strings{mine::INITIAL_FUNCTIONS};
+    int count = (int)g_plot.function_count();
+    // one more entry than there are functions, holding what "+" adds next
+    static std::vector<std::array<char, 256>> input_strings{};
     static std::array<int, 6> axes{mine::INITIAL_AXES};
-    static std::array<std::array<int, 4>, 8> bounds{mine::INITIAL_BOUNDS};
+    static std::vector<std::array<int, 4>> bounds{};
+    static std::vector<std::array<float, 4>> parameters{};
+    static std::vector<int> kinds{};
+    while ((int)input_strings.size() <= count) {
+        size_t preset = input_strings.size() % mine::INITIAL_FUNCTIONS.size();
+        input_strings.emplace_back();
+        std::snprintf(input_strings.back().data(), input_strings.back().size(), "%s", mine::INITIAL_FUNCTIONS[preset]);
+        bounds.push_back(mine::INITIAL_BOUNDS[preset]);
+        const std::array<int, 4>& start = bounds.back();
+        parameters.push_back({(float)start[0], (float)start[1], (float)start[2], (float)start[3]});
+        kinds.push_back(mine::HEIGHT);
+    }
+    if (g_gui_stale) {
+        for (int i = 0; i < count; ++i) {
+            std::snprintf(input_strings[i].data(), input_strings[i].size(), "%s", g_compute_pipeline.get_function(i));
+            kinds[i] = g_plot.kinds[i];
+            bounds[i] = g_plot.bounds[i];
+            parameters[i] = g_plot.parameters[i];
+        }
+        axes = g_plot.axes;
+        g_gui_stale = false;
+    }
     float half_space = (ImGui::GetContentRegionAvail().x - ImGui::CalcTextSize(" <= x <= ").x) * 0.5f;
     half_space = (half_space < 0) ? 0 : half_space;
 
-    static auto domain_axes = [&](const char* str, int neg) {
+    auto domain_axes = [&](const char* str, int neg) {
         ImGui::SetNextItemWidth(half_space);
-        ImGui::InputInt(("##intInput" + std::to_string(neg)).c_str(), &axes[neg], 0, 0, ImGuiInputTextFlags_None);
+        ImGui::InputInt(g_frame.format("##intInput%d", neg), &axes[neg], 0, 0, ImGuiInputTextFlags_None);
         ImGui::SameLine();
         ImGui::Text(str);
         ImGui::SameLine();
         ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
-        ImGui::InputInt(("##intInput" + std::to_string(neg + 1)).c_str(), &axes[neg + 1], 0, 0, ImGuiInputTextFlags_None);
+        ImGui::InputInt(g_frame.format("##intInput%d", neg + 1), &axes[neg + 1], 0, 0, ImGuiInputTextFlags_None);
     };
 
-    static auto domain_functions = [&](const char* str, int func, int neg) {
+    auto domain_functions = [&](const char* str, int func, int neg) {
         ImGui::SetNextItemWidth(half_space);
-        ImGui::InputInt(("##intInput" + std::to_string(func) + std::to_string(neg)).c_str(), &bounds[func][neg], 0, 0, ImGuiInputTextFlags_None);
+        ImGui::InputInt(g_frame.format("##intInput%d%d", func, neg), &bounds[func][neg], 0, 0, ImGuiInputTextFlags_None);
         ImGui::SameLine();
         ImGui::Text(str);
         ImGui::SameLine();
         ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
-        ImGui::InputInt(("##intInput" + std::to_string(func) + std::to_string(neg + 1)).c_str(), &bounds[func][neg + 1], 0, 0, ImGuiInputTextFlags_None);
+        ImGui::InputInt(g_frame.format("##intInput%d%d", func, neg + 1), &bounds[func][neg + 1], 0, 0, ImGuiInputTextFlags_None);
     };
 
-    for (int i = 0; i < count; ++i) {
+    // parameter ranges are not world coordinates, so they take any float, 0 to 2 pi included
+    auto parameter_ranges = [&](const char* str, int func, int neg) {
+        ImGui::SetNextItemWidth(half_space);
+        ImGui::InputFloat(g_frame.format("##floatInput%d_%d", func, neg), &parameters[func][neg], 0.0f, 0.0f, "%.4g", ImGuiInputTextFlags_None);
+        ImGui::SameLine();
+        ImGui::Text(str);
+        ImGui::SameLine();
         ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
-        ImGui::InputText(mine::ids[2 * i], input_strings[i], sizeof(input_strings[i]));
-        domain_functions("<= x <=", i, mine::NEG_X_BOUND);
-        domain_functions("<= y <=", i, mine::NEG_Z_BOUND);
-        if (ImGui::Button(mine::ids[2 * i + 1])) {
-            g_plot.update_bounds(i, bounds[i]);
-            g_camera.set_center(g_plot.bounds[i]);
-            if (!update_function(input_strings[i], i)) {
-                strcpy(input_strings[i], g_compute_pipeline.get_function(i));
+        ImGui::InputFloat(g_frame.format("##floatInput%d_%d", func, neg + 1), &parameters[func][neg + 1], 0.0f, 0.0f, "%.4g", ImGuiInputTextFlags_None);
+    };
+
+    bool refresh_overlay = false;
+
+    // world y is the function value and world z is the domain's y
+    if (g_picked && (g_plot.kinds[g_hit.function] == mine::HEIGHT || g_plot.kinds[g_hit.function] == mine::POINTS)) {
+        ImGui::SetTooltip("f%d(%.4f, %.4f) = %.4f", g_hit.function + 1, g_hit.x, g_hit.z, g_hit.y);
+    } else if (g_picked && g_plot.kinds[g_hit.function] == mine::COMPLEX && g_complex_relief) {
+        ImGui::SetTooltip("log|f%d(%.4f %+.4fi)| = %.4f", g_hit.function + 1, g_hit.x, g_hit.z, g_hit.y);
+    } else if (g_picked && g_plot.kinds[g_hit.function] == mine::COMPLEX) {
+        ImGui::SetTooltip("f%d at z = %.4f %+.4fi", g_hit.function + 1, g_hit.x, g_hit.z);
+    } else if (g_picked) {
+        ImGui::SetTooltip("r%d = (%.4f, %.4f, %.4f)", g_hit.function + 1, g_hit.x, g_hit.z, g_hit.y);
+    }
+
+    // only a page of functions is laid out, so the panel costs the same with thousands of them
+    static int first_shown = 0;
+    first_shown = std::max(0, std::min(first_shown, (count - 1) / FUNCTIONS_SHOWN * FUNCTIONS_SHOWN));
+    if (count > FUNCTIONS_SHOWN) {
+        if (ImGui::Button("<") && first_shown > 0) {
+            first_shown -= FUNCTIONS_SHOWN;
+        }
+        ImGui::SameLine();
+        if (ImGui::Button(">") && first_shown + FUNCTIONS_SHOWN < count) {
+            first_shown += FUNCTIONS_SHOWN;
+        }
+        ImGui::SameLine();
+        ImGui::Text("%d to %d of %d", first_shown + 1, std::min(first_shown + FUNCTIONS_SHOWN, count), count);
+    }
+
+    for (int i = first_shown; i < std::min(first_shown + FUNCTIONS_SHOWN, count); ++i) {
+        ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+        ImGui::Combo(g_frame.format("##kind%d", i), &kinds[i], mine::KIND_NAMES.data(), mine::KIND_NAMES.size());
+        ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+        ImGui::InputText(g_frame.format("##Function%d", i + 1), input_strings[i].data(), input_strings[i].size());
+        if (i < (int)g_op_counts.size() && g_op_counts[i][0] > 0) {
+            ImGui::Text("%d ops per sample, %d as typed", g_op_counts[i][1], g_op_counts[i][0]);
+        }
+        if (g_plot.kinds[i] == mine::POINTS && i < (int)g_load_notes.size() && !g_load_notes[i].empty()) {
+            ImGui::Text("%s", g_load_notes[i].c_str());
+        }
+        if (kinds[i] == mine::HEIGHT || kinds[i] == mine::POINTS || kinds[i] == mine::COMPLEX) {
+            domain_functions("<= x <=", i, mine::NEG_X_BOUND);
+            domain_functions("<= y <=", i, mine::NEG_Z_BOUND);
+        } else if (kinds[i] == mine::SURFACE) {
+            parameter_ranges("<= u <=", i, 0);
+            parameter_ranges("<= v <=", i, 2);
+        } else {
+            parameter_ranges("<= t <=", i, 0);
+        }
+        bool submit = ImGui::Button(g_frame.format("Submit##%d", i + 1));
+        // shift_bounds only keeps samples when the bounds move by whole samples, so offer exactly those moves
+        if (g_incremental_pan && kinds[i] == mine::HEIGHT && g_plot.kinds[i] == mine::HEIGHT) {
+            std::array<int, 2> steps = g_plot.pan_steps(i);
+            const std::array<const char*, 4> labels{"-x##pan%d", "+x##pan%d", "-y##pan%d", "+y##pan%d"};
+            for (int side = 0; side < 4; ++side) {
+                int neg = side < 2 ? mine::NEG_X_BOUND : mine::NEG_Z_BOUND;
+                int step = (side % 2 == 0 ? -1 : 1) * steps[side / 2];
+                ImGui::SameLine();
+                if (ImGui::Button(g_frame.format(labels[side], i + 1)) && step != 0) {
+                    bounds[i] = g_plot.bounds[i];
+                    bounds[i][neg] += step;
+                    bounds[i][neg + 1] += step;
+                    submit = true;
+                }
             }
-            g_change[mine::SCENE] = true;
+            ImGui::SameLine();
+            ImGui::Text("by %d, %d", steps[0], steps[1]);
+        }
+        if (submit) {
+            if (!submit_function(i, kinds[i], bounds[i], parameters[i], input_strings[i].data())) {
+                std::snprintf(input_strings[i].data(), input_strings[i].size(), "%s", g_compute_pipeline.get_function(i));
+                kinds[i] = g_plot.kinds[i];
+            }
+            refresh_overlay = true;
         }
     }
 
-    if (count < 8 && ImGui::Button("+")) {
-        g_plot.add_function();
-        g_plot.update_bounds(count, bounds[count]);
-        update_function(input_strings[count], count);
+    if (ImGui::Button("+")) {
+        push_function(kinds[count], bounds[count], parameters[count], input_strings[count].data());
+        first_shown = count / FUNCTIONS_SHOWN * FUNCTIONS_SHOWN;
         count++;
-        g_change[mine::SIZE] = true;
+        refresh_overlay = true;
     }
-    if (count < 8 && count > 0) {
+    if (count > 0) {
         ImGui::SameLine();
     }
     if (count > 0 && ImGui::Button("-")) {
-        g_plot.remove_function();
+        pop_function();
         count--;
-        g_change[mine::SIZE] = true;
+        refresh_overlay = true;
     }
 
     domain_axes("<= X <=", 0);
@@ -381,26 +1448,315 @@ void update_GUI() {
     domain_axes("<= Z <=", 4);
 
     if (ImGui::Button("Set Bounds")) {
-        g_plot.update_axes(axes);
+        std::vector<std::string> functions{};
         for (int i = 0; i < count; ++i) {
-            update_function(input_strings[i], i);
+            functions.push_back(input_strings[i].data());
         }
+        set_axes(axes, functions);
         for (int i = 0; i < count; ++i) {
             bounds[i] = g_plot.bounds[i];
         }
-        g_change[mine::SIZE] = true;
+        refresh_overlay = true;
+    }
+
+    mine::height_range heights = all_heights();
+    if (heights.low <= heights.high) {
+        ImGui::Text("%.3g <= f <= %.3g, %d undefined", heights.low, heights.high, heights.non_finite);
+    }
+    if (ImGui::Checkbox("Fit Z to the functions", &g_fit_heights) && g_fit_heights) {
+        fit_height_axis();
+    }
+    if (ImGui::Checkbox("Color by height", &g_colormap)) {
+        update_draws();
+        g_change[mine::SCREEN] = true;
+    }
+    if (ImGui::InputFloat("Jump limit", &g_jump_limit, 0.0f, 0.0f, "%.2f", ImGuiInputTextFlags_None)) {
+        g_jump_limit = std::max(0.0f, g_jump_limit);
+        for (size_t i = 0; i < g_plot.function_count(); ++i) {
+            flag_function(i);
+            build_pyramid(i);
+        }
+        if (!g_plot.overlay.empty()) {
+            update_overlay();
+        }
+    }
+
+    ImGui::Text("Scene");
+
+    static char scene_path[256] = "scene.bin";
+    static bool embed_meshes = true;
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+    ImGui::InputText("##scenePath", scene_path, sizeof(scene_path));
+    ImGui::Checkbox("Store meshes", &embed_meshes);
+    if (ImGui::Button("Save##scene")) {
+        save_scene(scene_path, embed_meshes);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Open##scene") && open_scene(scene_path)) {
+        refresh_overlay = true;
+    }
+    if (!g_scene_status.empty()) {
+        ImGui::Text("%s", g_scene_status.c_str());
+    }
+
+    ImGui::Text("Quality");
+
+    bool resize = false;
+    ImGui::Checkbox("Automatic##quality", &g_quality.automatic);
+    ImGui::SetNextItemWidth(half_space);
+    ImGui::InputFloat("Target ms##quality", &g_quality.target, 0.0f, 0.0f, "%.1f", ImGuiInputTextFlags_None);
+    g_quality.target = (g_quality.target < 1.0f) ? 1.0f : g_quality.target;
+    if (!g_quality.automatic) {
+        ImGui::SetNextItemWidth(half_space);
+        resize |= ImGui::InputFloat("Scale##quality", &g_quality.scale, 0.0f, 0.0f, "%.2f", ImGuiInputTextFlags_None);
+        g_quality.scale = (g_quality.scale < 0.25f) ? 0.25f : (g_quality.scale > 1.0f) ? 1.0f : g_quality.scale;
+        ImGui::SetNextItemWidth(half_space);
+        resize |= ImGui::InputInt("MSAA samples##quality", &g_quality.samples, 0, 0, ImGuiInputTextFlags_None);
+        g_quality.samples = (g_quality.samples < 1) ? 1 : (g_quality.samples > g_quality.max_samples) ? g_quality.max_samples : g_quality.samples;
+    }
+    if (resize) {
+        resize_scene();
+    }
+    ImGui::Text("%dx%d, %dx MSAA, %.2f ms", g_scene.get_width(), g_scene.get_height(), g_scene.get_samples(), g_quality.get_frame_time());
+    ImGui::Text("%lld allocations last frame, %lld in the GUI, %lld in the scene", g_allocations.total.count, g_allocations.gui.count, g_allocations.scene.count);
+
+    // without the normal pass there is nothing to turn on; startup already fell back to the CPU
+    ImGui::BeginDisabled(g_normal_pipeline.get_program() == 0);
+    ImGui::Checkbox("Normals on GPU", &g_gpu_normals);
+    ImGui::EndDisabled();
+    // the fields already up were evaluated where the box said before, so they are evaluated again on the other side
+    if (ImGui::Checkbox("Evaluate on CPU", &g_cpu_evaluation)) {
+        for (size_t i = 0; i < g_plot.function_count(); ++i) {
+            if (g_plot.kinds[i] == mine::HEIGHT) {
+                update_function(g_compute_pipeline.get_function(i), i);
+            }
+        }
+        g_change[mine::SCENE] = true;
+    }
+    ImGui::Checkbox("Reuse samples when panning", &g_incremental_pan);
+    if (ImGui::IsItemHovered()) {
+        ImGui::SetTooltip("Only moves by whole samples reuse any, width / gcd(width, %d) at a time", mine::X_RECTS);
+    }
+    if (ImGui::Checkbox("Complex modulus as height", &g_complex_relief)) {
+        for (size_t i = 0; i < g_plot.function_count(); ++i) {
+            if (g_plot.kinds[i] == mine::COMPLEX) {
+                update_function(g_compute_pipeline.get_function(i), i);
+            }
+        }
+        g_change[mine::SCENE] = true;
+    }
+    bool culling_changed = ImGui::Checkbox("Cull patches outside the axes", &g_cull_range);
+    culling_changed |= ImGui::Checkbox("Cull offscreen patches", &g_cull_offscreen);
+    if (culling_changed) {
+        refresh_culling();
+        refresh_overlay = true;
+    }
+
+    ImGui::Text("Contours");
+
+    static bool contours = false;
+    static int levels = 10;
+    static std::array<float, 2> range{-5.0f, 5.0f};
+
+    refresh_overlay |= ImGui::Checkbox("Show##contours", &contours);
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+    refresh_overlay |= ImGui::InputInt("##levels", &levels, 0, 0, ImGuiInputTextFlags_None);
+    levels = (levels < 1) ? 1 : (levels > 256) ? 256 : levels;
+    ImGui::SetNextItemWidth(half_space);
+    refresh_overlay |= ImGui::InputFloat("##contourLow", &range[0], 0.0f, 0.0f, "%.2f", ImGuiInputTextFlags_None);
+    ImGui::SameLine();
+    ImGui::Text("<= z <=");
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+    refresh_overlay |= ImGui::InputFloat("##contourHigh", &range[1], 0.0f, 0.0f, "%.2f", ImGuiInputTextFlags_None);
+
+    ImGui::Text("Solver");
+
+    static int solver_index = 0;
+    static int seeds = 64;
+    static int solver_mode = 0;
+    static std::string solver_error{};
+
+    ImGui::SetNextItemWidth(half_space);
+    ImGui::InputInt("Function##solver", &solver_index, 0, 0, ImGuiInputTextFlags_None);
+    solver_index = (solver_index >= count) ? count - 1 : (solver_index < 0) ? 0 : solver_index;
+    ImGui::SetNextItemWidth(half_space);
+    ImGui::InputInt("Seeds per axis##solver", &seeds, 0, 0, ImGuiInputTextFlags_None);
+    seeds = (seeds < 1) ? 1 : (seeds > 256) ? 256 : seeds;
+    if (ImGui::Button("Critical points")) {
+        solver_mode = 1;
+        refresh_overlay = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Zeros")) {
+        solver_mode = 2;
+        refresh_overlay = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear##solver")) {
+        solver_mode = 0;
+        refresh_overlay = true;
+    }
+
+    if (refresh_overlay) {
+        g_solver.clear();
+        solver_error.clear();
+
+        mine::expression function{};
+        if (solver_mode == 0 || count == 0) {
+            solver_mode = 0;
+        } else if (g_plot.kinds[solver_index] != mine::HEIGHT) {
+            solver_error = "only height fields can be solved";
+        } else if (!function.parse(g_compute_pipeline.get_function(solver_index))) {
+            solver_error = function.get_error();
+        } else if (solver_mode == 1) {
+            g_solver.find_critical_points(function, g_plot.bounds[solver_index], seeds);
+        } else {
+            g_solver.find_zeros(function, g_plot.bounds[solver_index], seeds);
+        }
+    }
+
+    static constexpr std::array<const char*, 5> point_names{{ "min", "max", "saddle", "flat", "zero" }};
+    if (!solver_error.empty()) {
+        ImGui::Text("%s", solver_error.c_str());
+    } else if (solver_mode == 2) {
+        ImGui::Text("%d points on f = 0", (int)g_solver.points.size());
+    }
+    for (size_t i = 0; solver_mode == 1 && i < g_solver.points.size() && i < 16; ++i) {
+        const mine::critical_point& point = g_solver.points[i];
+        ImGui::Text("%s (%.4f, %.4f) f = %.4f", point_names[point.kind], point.x, point.y, point.f);
+    }
+
+    if (refresh_overlay && (contours || solver_mode != 0 || !g_plot.overlay.empty())) {
+        g_contour.set_levels(contours ? levels : 0, range[0], range[1]);
+        update_overlay();
+    }
+
+    ImGui::Text("Slope field");
+
+    static int flow_index = 0;
+    static int step_exponent = -2;
+    static int flow_tolerance_exponent = -6;
+    static std::string flow_error{};
+    static constexpr std::array<const char*, 2> method_names{{ "RK4", "RK45" }};
+
+    bool retrace = false;
+    ImGui::SetNextItemWidth(half_space);
+    ImGui::InputInt("Function##flow", &flow_index, 0, 0, ImGuiInputTextFlags_None);
+    flow_index = (flow_index >= count) ? count - 1 : (flow_index < 0) ? 0 : flow_index;
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+    retrace |= ImGui::Combo("##method", &g_flow.method, method_names.data(), (int)method_names.size());
+    ImGui::SetNextItemWidth(half_space);
+    retrace |= ImGui::InputInt("Slopes per axis##flow", &g_flow.samples, 0, 0, ImGuiInputTextFlags_None);
+    g_flow.samples = (g_flow.samples < 1) ? 1 : (g_flow.samples > 256) ? 256 : g_flow.samples;
+    ImGui::SetNextItemWidth(half_space);
+    retrace |= ImGui::InputInt("Seeds per axis##flow", &g_flow.seeds, 0, 0, ImGuiInputTextFlags_None);
+    g_flow.seeds = (g_flow.seeds < 0) ? 0 : (g_flow.seeds > 128) ? 128 : g_flow.seeds;
+    ImGui::SetNextItemWidth(half_space);
+    retrace |= ImGui::InputInt("Step 1e##flow", &step_exponent, 0, 0, ImGuiInputTextFlags_None);
+    step_exponent = (step_exponent < -5) ? -5 : (step_exponent > -1) ? -1 : step_exponent;
+    g_flow.step = std::pow(10.0, step_exponent);
+    if (g_flow.method == mine::RK45) {
+        ImGui::SetNextItemWidth(half_space);
+        retrace |= ImGui::InputInt("Tolerance 1e##flow", &flow_tolerance_exponent, 0, 0, ImGuiInputTextFlags_None);
+        flow_tolerance_exponent = (flow_tolerance_exponent < -14) ? -14 : (flow_tolerance_exponent > -1) ? -1 : flow_tolerance_exponent;
+        g_flow.tolerance = std::pow(10.0, flow_tolerance_exponent);
+    }
+    if (ImGui::Button("Trace##flow") && count > 0) {
+        g_flow_index = flow_index;
+        retrace = true;
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Clear##flow")) {
+        g_flow_index = -1;
+        g_flow_seeds.clear();
+        retrace = true;
+    }
+    if (retrace) {
+        flow_error = trace_flow(false);
+        update_overlay();
+    }
+    if (!flow_error.empty()) {
+        ImGui::Text("%s", flow_error.c_str());
+    } else if (g_flow_index >= 0) {
+        ImGui::Text("%lld steps; drag with the right button to seed", g_flow.steps + g_flow.seed_steps);
+    }
+
+    ImGui::Text("Integral");
+
+    static int integral_index = 0;
+    static int integral_rule = mine::ADAPTIVE;
+    static int resolution = 64;
+    static int order = 8;
+    static int tolerance_exponent = -10;
+    static mine::integral result{};
+    static double integral_time = -1.0;
+    static std::string integral_error{};
+    static constexpr std::array<const char*, 3> rule_names{{ "Composite Simpson", "Gauss-Legendre", "Adaptive Gauss-Kronrod" }};
+
+    ImGui::SetNextItemWidth(half_space);
+    ImGui::InputInt("Function##integral", &integral_index, 0, 0, ImGuiInputTextFlags_None);
+    integral_index = (integral_index >= count) ? count - 1 : (integral_index < 0) ? 0 : integral_index;
+    ImGui::SetNextItemWidth(ImGui::GetContentRegionAvail().x);
+    ImGui::Combo("##rule", &integral_rule, rule_names.data(), (int)rule_names.size());
+    ImGui::SetNextItemWidth(half_space);
+    if (integral_rule == mine::SIMPSON) {
+        ImGui::InputInt("Panels per axis##integral", &resolution, 0, 0, ImGuiInputTextFlags_None);
+        resolution = (resolution < 4) ? 4 : (resolution > 4096) ? 4096 : resolution;
+    } else if (integral_rule == mine::GAUSS_LEGENDRE) {
+        ImGui::InputInt("Cells per axis##integral", &resolution, 0, 0, ImGuiInputTextFlags_None);
+        resolution = (resolution < 1) ? 1 : (resolution > 4096) ? 4096 : resolution;
+        ImGui::SetNextItemWidth(half_space);
+        ImGui::InputInt("Order##integral", &order, 0, 0, ImGuiInputTextFlags_None);
+        order = (order < 2) ? 2 : (order > 32) ? 32 : order;
+        // each cell takes order^2 evaluations and (order - 1)^2 more for the error estimate
+        long long per_cell = (long long)order * order + (long long)(order - 1) * (order - 1);
+        int most_cells = (int)std::sqrt((double)(GAUSS_EVALUATIONS / per_cell));
+        if (resolution > most_cells) {
+            resolution = most_cells;
+        }
+        ImGui::Text("at most %d cells per axis at this order", most_cells);
+    } else {
+        ImGui::InputInt("Tolerance 1e##integral", &tolerance_exponent, 0, 0, ImGuiInputTextFlags_None);
+        tolerance_exponent = (tolerance_exponent < -14) ? -14 : (tolerance_exponent > 0) ? 0 : tolerance_exponent;
+    }
+    if (ImGui::Button("Integrate") && count > 0) {
+        mine::expression function{};
+        integral_error.clear();
+        integral_time = -1.0;
+        if (g_plot.kinds[integral_index] != mine::HEIGHT) {
+            integral_error = "only height fields can be integrated";
+        } else if (!function.parse(g_compute_pipeline.get_function(integral_index))) {
+            integral_error = function.get_error();
+        } else {
+            auto start = std::chrono::steady_clock::now();
+            const std::array<int, 4>& domain = g_plot.bounds[integral_index];
+            if (integral_rule == mine::SIMPSON) {
+                result = mine::integrate_simpson(function, domain, resolution);
+            } else if (integral_rule == mine::GAUSS_LEGENDRE) {
+                result = mine::integrate_gauss(function, domain, resolution, order);
+            } else {
+                result = mine::integrate_adaptive(function, domain, std::pow(10.0, tolerance_exponent), 1 << 14);
+            }
+            integral_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    if (!integral_error.empty()) {
+        ImGui::Text("%s", integral_error.c_str());
+    } else if (integral_time >= 0.0) {
+        ImGui::Text("%.12g +- %.2g%s", result.value, result.error, result.converged ? "" : " (not converged)");
+        ImGui::Text("%lld evaluations, %d regions, %.2f ms", result.evaluations, result.regions, integral_time);
     }
 
     ImGui::End();
 }
 
 void reallocate_buffers() {
-    glBufferData(
-        GL_ARRAY_BUFFER, 
-        g_plot.vertices.size() * sizeof(mine::vertex),
-        g_plot.vertices.data(), 
-        GL_STATIC_DRAW
-    );
+    g_plot.refresh_indices();
+    g_dirty = {SIZE_MAX, 0};
+    g_vertex_capacity = vertex_capacity();
+    glBufferData(GL_ARRAY_BUFFER, g_vertex_capacity * sizeof(mine::vertex), nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, g_plot.vertices.size() * sizeof(mine::vertex), g_plot.vertices.data());
     glBufferData(
         GL_ELEMENT_ARRAY_BUFFER,
         g_plot.indices.size() * sizeof(GLuint),
@@ -409,12 +1765,20 @@ void reallocate_buffers() {
     );
 }
 
+// sends only the touched span; a scene change that touched nothing resends every vertex
 void update_buffers() {
+    size_t first = 0;
+    size_t last = g_plot.vertices.size();
+    if (g_dirty[0] < g_dirty[1]) {
+        first = g_dirty[0];
+        last = std::min(g_dirty[1], last);
+    }
+    g_dirty = {SIZE_MAX, 0};
     glBufferSubData(
         GL_ARRAY_BUFFER, 
-        0, 
-        g_plot.vertices.size() * sizeof(mine::vertex), 
-        g_plot.vertices.data()
+        first * sizeof(mine::vertex), 
+        (last - first) * sizeof(mine::vertex), 
+        g_plot.vertices.data() + first
     );
 }
 
@@ -424,70 +1788,171 @@ void predraw() {
 
 void update_view() {
     glUniformMatrix4fv(g_graphics_pipeline.get_view_matrix_location(), 1, GL_FALSE, &g_camera.view[0][0]);
+    glUniform3f(g_graphics_pipeline.get_camera_position_location(), g_camera.position.x, g_camera.position.y, g_camera.position.z);
 }
 
+// the same submissions whatever the function count: the lines, every surface through one indirect draw, then
+// any data points
 void draw() {
+    g_draws.cull(&g_camera.view[0][0]);
+    glUseProgram(g_graphics_pipeline.get_program());
+
     glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
-    glDrawElements(GL_LINES, g_plot.base_vertice_count, GL_UNSIGNED_INT, nullptr);
-    glDrawElements(GL_TRIANGLES, g_plot.indices.size() - g_plot.base_vertice_count, GL_UNSIGNED_INT, (void*)(g_plot.base_vertice_count * sizeof(GLuint)));
+    glUniform1i(g_surfaces_location, GL_FALSE);
+    glDrawElements(GL_LINES, g_plot.line_count, GL_UNSIGNED_INT, nullptr);
+    if (g_plot.overlay_count > 0) {
+        glDrawArrays(GL_LINES, g_plot.first_overlay, g_plot.overlay_count);
+    }
+    glUniform1i(g_surfaces_location, GL_TRUE);
+    g_draws.draw();
+    if (g_plot.point_count > 0) {
+        glUniform1i(g_surfaces_location, GL_FALSE);
+        glDrawArrays(GL_POINTS, g_plot.first_point, g_plot.point_count);
+    }
+    if (g_terrain.is_open()) {
+        glUniform1i(g_surfaces_location, GL_FALSE);
+        g_terrain.draw();
+    }
 }
 
 void postdraw() {
     glUseProgram(0);
 }
 
+// one GUI pass and, when anything changed, one scene draw
+void render() {
+    static bool draw_ = false;
+
+    frame_allocations frame{};
+    mine::allocation_stats start = mine::thread_allocations();
+    g_frame.reset();
+    {
+        mine::allocation_scope gui(frame.gui);
+        update_GUI();
+    }
+    mine::allocation_scope scene(frame.scene);
+
+    collect_evaluations();
+
+    predraw();
+
+    // whatever moved under the cursor, the last pick no longer holds until the mouse moves again
+    if (g_change.any()) {
+        g_picked = false;
+    }
+
+    // re-culling evaluates every CPU field again, so a moving camera only re-culls every few frames, and once
+    // more on the first frame it holds still
+    static bool cull_stale = false;
+    static int cull_frames = 0;
+    bool moving = g_change[mine::CAMERA];
+    cull_stale |= moving && g_cull_offscreen && g_cpu_evaluation;
+    if (cull_stale && (!moving || ++cull_frames >= CULL_FRAMES)) {
+        cull_stale = false;
+        cull_frames = 0;
+        if (g_cull_offscreen && g_cpu_evaluation) {
+            refresh_culling();
+            if (!g_plot.overlay.empty()) {
+                update_overlay();
+            }
+        }
+    }
+
+    if (g_change[mine::CAMERA]) {
+        update_view();
+        draw_ = true;
+        g_change[mine::CAMERA] = false;
+    }
+
+    // tiles stream in over several frames, so the terrain is asked every frame, not only when the camera moves;
+    // a replay waits for them, or each run would draw whatever the loader happened to finish
+    if (g_terrain.update(g_camera.center, g_camera.get_radius(), g_replaying)) {
+        draw_ = true;
+    }
+
+    if (g_fit_heights && (g_change[mine::SIZE] || g_change[mine::SCENE])) {
+        fit_height_axis();
+    }
+
+    if (g_change[mine::SIZE] || g_change[mine::SCENE] || g_highlighted != (g_picked ? g_hit.function : -1)) {
+        update_draws();
+        draw_ = true;
+    }
+
+    if (g_change[mine::SIZE]) {
+        reallocate_buffers();
+        draw_ = true;
+        g_change[mine::SIZE] = false;
+        g_change[mine::SCENE] = false;
+        g_change[mine::SCREEN] = false;
+    } else if (g_change[mine::SCENE]) {
+        update_buffers();
+        draw_ = true;
+        g_change[mine::SCENE] = false;
+        g_change[mine::SCREEN] = false;
+    } else if (g_change[mine::SCREEN]) {
+        draw_ = true;
+        g_change[mine::SCREEN] = false;
+    }
+
+    if (draw_) {
+        if (g_scene_ready) {
+            g_scene.bind();
+        }
+        g_quality.begin();
+        draw();
+        g_quality.end();
+        if (g_scene_ready) {
+            g_scene.present((int)g_camera.screen_width, (int)g_camera.screen_height);
+        }
+    }
+
+    postdraw();
+
+    ImGui::Render();
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+    SDL_GL_SwapWindow(g_window);
+
+    if (g_quality.update()) {
+        resize_scene();
+    }
+
+    frame.total = mine::thread_allocations();
+    frame.total.count -= start.count;
+    frame.total.bytes -= start.bytes;
+    g_allocations = frame;
+}
+
+// once nothing has happened for QUIET_FRAMES frames, every further quiet frame must leave the heap alone
+void check_allocations(bool steady) {
+    static int quiet = 0;
+    quiet = steady ? quiet + 1 : 0;
+    if (quiet > QUIET_FRAMES && g_allocations.total.count > 0) {
+        std::cerr << "Error: A steady frame made " << g_allocations.total.count << " allocations ("
+            << g_allocations.gui.count << " in the GUI, " << g_allocations.scene.count << " in the scene)" << std::endl;
+        g_allocation_failures++;
+    }
+}
+
 void loop() {
     Uint64 prev_counter = SDL_GetPerformanceCounter();
     Uint64 curr_counter{};
     double elapsed_time{};
     double frame_elapsed_time{};
     int frame_count{};
-    bool draw_ = false;
 
     while (g_running) {
         input();
         if (frame_elapsed_time >= g_refresh_time) {
-            update_GUI();
-            
-            predraw();
-
-            if (g_change[mine::CAMERA]) {
-                update_view();
-                draw_ = true;
-                g_change[mine::CAMERA] = false;
-                std::cout << "camera\n";
-            }
-            
-            if (g_change[mine::SIZE]) {
-                reallocate_buffers();
-                draw_ = true;
-                g_change[mine::SIZE] = false;
-                g_change[mine::SCENE] = false;
-                g_change[mine::SCREEN] = false;
-                std::cout << "size\n";
-            } else if (g_change[mine::SCENE]) {
-                update_buffers();
-                draw_ = true;
-                g_change[mine::SCENE] = false;
-                g_change[mine::SCREEN] = false;
-                std::cout << "scene\n";
-            } else if (g_change[mine::SCREEN]) {
-                draw_ = true;
-                g_change[mine::SCREEN] = false;
-                std::cout << "screen\n";
+            bool steady = g_events == 0 && g_change.none() && !g_worker.busy();
+            g_events = 0;
+            render();
+            g_recording.next_frame();
+            if (g_check_allocations) {
+                check_allocations(steady);
             }
 
-            if (draw_) {
-                draw();
-            }
-
-            postdraw();
-
-            ImGui::Render();
-            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-
-            SDL_GL_SwapWindow(g_window);
-
             frame_count++;
             frame_elapsed_time = 0.0;
         }
@@ -498,9 +1963,9 @@ void loop() {
         frame_elapsed_time += frame_time;
 
         if (elapsed_time >= 1.0) {
-            int FPS = frame_count;
-            std::string title = std::to_string(FPS) + " FPS";
-            SDL_SetWindowTitle(g_window, title.c_str());
+            char title[32];
+            std::snprintf(title, sizeof(title), "%d FPS", frame_count);
+            SDL_SetWindowTitle(g_window, title);
 
             frame_count = 0;
             elapsed_time = 0.0;
@@ -510,12 +1975,196 @@ void loop() {
     }
 }
 
+// applies one recorded call the way the GUI or input() made it; returns true for edits to the plot
+bool apply(const mine::record& record) {
+    std::array<int, 6> n = record.integers;
+    std::array<int, 4> bounds{};
+    switch (record.kind) {
+        case mine::RECORD_ANGLES:
+            rotate(record.values[0], record.values[1]);
+            return false;
+        case mine::RECORD_ZOOM:
+            zoom(n[0] != 0, n[1] != 0);
+            return false;
+        case mine::RECORD_DATA:
+            g_camera.set_data(record.values[0], record.values[1], record.values[2]);
+            g_change[mine::CAMERA] = true;
+            return false;
+        case mine::RECORD_PAN:
+            pan(record.values[0], record.values[1]);
+            return false;
+        case mine::RECORD_SCREEN:
+            SDL_SetWindowSize(g_window, (int)record.values[0], (int)record.values[1]);
+            resize_screen((int)record.values[0], (int)record.values[1]);
+            return false;
+        case mine::RECORD_FUNCTION:
+            if (n[0] < (int)g_plot.function_count()) {
+                bounds = {n[2], n[3], n[4], n[5]};
+                submit_function(n[0], n[1], bounds, record.values, record.functions[0]);
+            }
+            break;
+        case mine::RECORD_PUSH:
+            bounds = {n[1], n[2], n[3], n[4]};
+            push_function(n[0], bounds, record.values, record.functions[0]);
+            break;
+        case mine::RECORD_POP:
+            if (g_plot.function_count() > 0) {
+                pop_function();
+            }
+            break;
+        case mine::RECORD_AXES:
+            set_axes(n, record.functions);
+            break;
+        default:
+            return false;
+    }
+    if (!g_plot.overlay.empty()) {
+        update_overlay();
+    }
+    g_gui_stale = true;
+    return true;
+}
+
+void print_times(const char* label, std::vector<double> times) {
+    if (times.empty()) {
+        return;
+    }
+    std::sort(times.begin(), times.end());
+    double total = 0.0;
+    for (double time : times) {
+        total += time;
+    }
+    auto percentile = [&](double p) { return times[std::min(times.size() - 1, (size_t)(p * times.size()))]; };
+    std::printf(
+        "%-12s %6d frames  mean %7.3f ms  p50 %7.3f  p95 %7.3f  p99 %7.3f  max %7.3f\n",
+        label, (int)times.size(), total / times.size(), percentile(0.5), percentile(0.95), percentile(0.99), times.back()
+    );
+}
+
+// drives the render loop from a recording: one recorded frame per iteration, vsync off and the quality
+// controller held still, so every build runs the same camera path and edits on the same frames
+void replay() {
+    SDL_GL_SetSwapInterval(0);
+    g_quality.automatic = false;
+    g_replaying = true;
+
+    std::vector<double> times{};
+    std::vector<double> edit_times{};
+    times.reserve(g_recording.get_frames());
+
+    auto start = std::chrono::steady_clock::now();
+    mine::record record{};
+    for (uint32_t frame = 0; g_running && frame < g_recording.get_frames(); ++frame) {
+        auto frame_start = std::chrono::steady_clock::now();
+
+        // the window still has to drain its events, but only closing it is honoured
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_QUIT) {
+                g_running = false;
+            }
+        }
+
+        bool edited = false;
+        bool recorded = false;
+        while (g_recording.next(frame, record)) {
+            edited |= apply(record);
+            recorded = true;
+        }
+        bool steady = !recorded && g_change.none() && !g_worker.busy();
+        render();
+        // the frame is not done until the GPU is, or the times would only measure command submission
+        glFinish();
+
+        if (g_check_allocations) {
+            check_allocations(steady);
+        }
+
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_start).count();
+        times.push_back(time);
+        if (edited) {
+            edit_times.push_back(time);
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf(
+        "Replayed %d of %d frames in %.3f s (%.1f FPS), recorded over %.3f s\n",
+        (int)times.size(), (int)g_recording.get_frames(), seconds, times.size() / seconds, g_recording.get_seconds()
+    );
+    print_times("all", times);
+    print_times("edits", edit_times);
+    g_replaying = false;
+}
+
+// sweeps the camera once around the scene, writing one PNG per step; each frame's pixels are copied out
+// while the next one renders and encoded on a writer thread while the one after that renders
+void render_frames(const std::string& directory, int width, int height, int frames, int samples) {
+    mine::framebuffer target{};
+    if (!target.set_size(width, height, samples)) {
+        exit(1);
+    }
+
+    std::vector<unsigned char> pixels{};
+    std::vector<unsigned char> writing{};
+    std::thread writer{};
+    auto save = [&](int frame) {
+        if (writer.joinable()) {
+            writer.join();
+        }
+        writing.swap(pixels);
+        writer = std::thread([&writing, directory, width, height, frame]() {
+            std::array<char, 32> name{};
+            std::snprintf(name.data(), name.size(), "/frame_%04d.png", frame);
+            if (!mine::write_png(directory + name.data(), width, height, writing)) {
+                std::cerr << "Error: Failed to write " << directory << name.data() << std::endl;
+            }
+        });
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    // the sweep starts wherever the camera is, which is the scene's camera when one was opened
+    float radius = g_camera.get_radius();
+    float theta = g_camera.theta;
+    float phi = g_camera.phi;
+
+    predraw();
+    target.bind();
+    for (int frame = 0; frame < frames; ++frame) {
+        g_camera.set_data(radius, theta + 360.0f * frame / frames, phi);
+        g_terrain.update(g_camera.center, g_camera.get_radius(), true);
+        update_view();
+        draw();
+        target.read();
+        if (frame > 0 && target.collect(pixels)) {
+            save(frame - 1);
+        }
+    }
+    if (target.collect(pixels)) {
+        save(frames - 1);
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+    target.unbind();
+    postdraw();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << frames << " frames at " << width << "x" << height << " in " << seconds << " s (" << frames / seconds << " FPS)" << std::endl;
+
+    target.destroy();
+}
+
 void cleanup() {
-    ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplSDL2_Shutdown();
-    ImGui::DestroyContext();
+    if (!g_headless) {
+        ImGui_ImplOpenGL3_Shutdown();
+        ImGui_ImplSDL2_Shutdown();
+        ImGui::DestroyContext();
 
-    SDL_DestroyWindow(g_window);
+        g_scene.destroy();
+        g_quality.destroy();
+    }
 
     glDeleteBuffers(1, &g_VBO);
     glDeleteBuffers(1, &g_IBO);
@@ -523,14 +2172,120 @@ void cleanup() {
 
     glDeleteProgram(g_graphics_pipeline.get_program());
     glDeleteProgram(g_compute_pipeline.get_program());
+    glDeleteProgram(g_normal_pipeline.get_program());
+    glDeleteProgram(g_cull_pipeline.get_program());
+    glDeleteProgram(g_range_pipeline.get_program());
+    glDeleteProgram(g_flag_pipeline.get_program());
+    g_draws.destroy();
+    g_terrain.close();
+
+#ifdef MINE_EGL
+    if (g_egl_display != EGL_NO_DISPLAY) {
+        eglMakeCurrent(g_egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroySurface(g_egl_display, g_egl_surface);
+        eglDestroyContext(g_egl_display, g_egl_context);
+        eglTerminate(g_egl_display);
+    }
+#endif
 
+    if (g_window) {
+        SDL_DestroyWindow(g_window);
+    }
     SDL_Quit();
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    std::string render_directory{};
+    int width = INITIAL_SCREEN_WIDTH;
+    int height = INITIAL_SCREEN_HEIGHT;
+    int frames = 1;
+    int samples = 8;
+    std::string record_path{};
+    std::string replay_path{};
+    std::string scene_path{};
+    std::string terrain_path{};
+
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument == "--render" && i + 1 < argc) {
+            render_directory = argv[++i];
+        } else if (argument == "--size" && i + 1 < argc && std::sscanf(argv[++i], "%dx%d", &width, &height) == 2) {
+            continue;
+        } else if (argument == "--frames" && i + 1 < argc) {
+            frames = std::max(1, std::atoi(argv[++i]));
+        } else if (argument == "--samples" && i + 1 < argc) {
+            samples = std::atoi(argv[++i]);
+        } else if (argument == "--record" && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (argument == "--replay" && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (argument == "--scene" && i + 1 < argc) {
+            scene_path = argv[++i];
+        } else if (argument == "--check-allocations") {
+            g_check_allocations = true;
+        } else if (argument == "--terrain" && i + 1 < argc) {
+            terrain_path = argv[++i];
+        } else if (argument == "--tiles" && i + 3 < argc) {
+            // converts a raw float32 raster into a tile file laid over the initial x and z axes, then exits
+            int raster_width = 0;
+            int raster_height = 0;
+            if (std::sscanf(argv[i + 2], "%dx%d", &raster_width, &raster_height) != 2) {
+                std::cerr << "Error: Expected <width>x<height>, got " << argv[i + 2] << std::endl;
+                return 1;
+            }
+            std::array<float, 4> extent{
+                (float)mine::INITIAL_AXES[mine::NEG_X_AXIS], (float)mine::INITIAL_AXES[mine::NEG_Z_AXIS],
+                (float)mine::INITIAL_AXES[mine::POS_X_AXIS], (float)mine::INITIAL_AXES[mine::POS_Z_AXIS]
+            };
+            return mine::build_tiles(argv[i + 1], raster_width, raster_height, extent, argv[i + 3]) ? 0 : 1;
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--render <directory> [--size <width>x<height>] [--frames <count>] [--samples <count>]]"
+                << " [--record <file> | --replay <file>] [--scene <file>] [--terrain <file>] [--check-allocations]"
+                << " | --tiles <raster> <width>x<height> <file>" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!render_directory.empty()) {
+        g_headless = true;
+        setup_headless(width, height);
+        vertex_specification(scene_path);
+        if (!terrain_path.empty() && !g_terrain.open(terrain_path, TERRAIN_TILES)) {
+            cleanup();
+            return 1;
+        }
+        render_frames(render_directory, width, height, frames, samples);
+        cleanup();
+        return 0;
+    }
+
+    if (!replay_path.empty() && !g_recording.load(replay_path)) {
+        return 1;
+    }
+
     setup();
-    vertex_specification();
-    loop();
+    vertex_specification(scene_path);
+    if (!terrain_path.empty() && !g_terrain.open(terrain_path, TERRAIN_TILES)) {
+        cleanup();
+        return 1;
+    }
+    if (!replay_path.empty()) {
+        replay();
+    } else {
+        if (!record_path.empty()) {
+            g_recording.begin();
+        }
+        g_worker.start(mine::X_RECTS + 1, mine::Z_RECTS + 1);
+        loop();
+        g_worker.stop();
+        if (!record_path.empty()) {
+            g_recording.save(record_path);
+        }
+    }
     cleanup();
+    if (g_check_allocations && g_allocation_failures > 0) {
+        std::cerr << "Error: " << g_allocation_failures << " steady frames allocated" << std::endl;
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include <mine/allocation.hpp>
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace mine {
+namespace {
+// plain thread_locals with no constructor, so counting never allocates itself
+thread_local allocation_stats thread_totals{};
+thread_local allocation_stats* current = nullptr;
+
+void count(size_t size) {
+    thread_totals.count++;
+    thread_totals.bytes += (long long)size;
+    if (current) {
+        current->count++;
+        current->bytes += (long long)size;
+    }
+}
+
+void* checked(void* pointer) {
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* allocate_aligned(size_t size, size_t alignment) {
+#ifdef _WIN32
+    return _aligned_malloc(size == 0 ? 1 : size, alignment);
+#else
+    // aligned_alloc only takes whole multiples of the alignment
+    size_t rounded = (size + alignment - 1) / alignment * alignment;
+    return std::aligned_alloc(alignment, rounded == 0 ? alignment : rounded);
+#endif
+}
+
+void free_aligned(void* pointer) {
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    std::free(pointer);
+#endif
+}
+}
+
+allocation_stats thread_allocations() {
+    return thread_totals;
+}
+
+void* counted_allocate(size_t size) {
+    count(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void counted_free(void* pointer) {
+    std::free(pointer);
+}
+
+allocation_scope::allocation_scope(allocation_stats& into) : previous{current} {
+    current = &into;
+}
+
+allocation_scope::~allocation_scope() {
+    current = previous;
+}
+
+frame_arena::frame_arena(size_t capacity) : block(capacity), used{0}, spilled{0}, spills{} {}
+
+void frame_arena::reset() {
+    if (spilled > 0) {
+        block.assign(std::max(block.size() * 2, block.size() + spilled), 0);
+        spills.clear();
+        spilled = 0;
+    }
+    used = 0;
+}
+
+void* frame_arena::allocate(size_t size, size_t alignment) {
+    // the block itself is only aligned for max_align_t, so the address is rounded, not the offset
+    uintptr_t base = (uintptr_t)block.data();
+    size_t start = (size_t)((base + used + alignment - 1) / alignment * alignment - base);
+    if (start + size <= block.size()) {
+        used = start + size;
+        return block.data() + start;
+    }
+
+    spilled += size + alignment;
+    spills.emplace_back(new char[size + alignment]);
+    void* pointer = spills.back().get();
+    size_t space = size + alignment;
+    return std::align(alignment, size, pointer, space);
+}
+
+const char* frame_arena::format(const char* pattern, ...) {
+    va_list args;
+    va_start(args, pattern);
+    va_list measure;
+    va_copy(measure, args);
+    int length = std::vsnprintf(nullptr, 0, pattern, measure);
+    va_end(measure);
+    if (length < 0) {
+        va_end(args);
+        return "";
+    }
+
+    char* text = (char*)allocate((size_t)length + 1, 1);
+    std::vsnprintf(text, (size_t)length + 1, pattern, args);
+    va_end(args);
+    return text;
+}
+}
+
+// the replaceable global allocation functions; the nothrow forms call these, so they are counted too
+void* operator new(size_t size) {
+    mine::count(size);
+    return mine::checked(std::malloc(size == 0 ? 1 : size));
+}
+
+void* operator new[](size_t size) {
+    mine::count(size);
+    return mine::checked(std::malloc(size == 0 ? 1 : size));
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    mine::count(size);
+    return mine::checked(mine::allocate_aligned(size, (size_t)alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    mine::count(size);
+    return mine::checked(mine::allocate_aligned(size, (size_t)alignment));
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    mine::free_aligned(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+    mine::free_aligned(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    mine::free_aligned(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+    mine::free_aligned(pointer);
+}
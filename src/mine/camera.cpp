@@ -61,6 +61,16 @@ void camera::set_center(const std::array<int, 4>& bounds) {
     update_position();
 }
 
+void camera::set_center(const std::array<float, 6>& box) {
+    if (!(box[0] <= box[3] && box[2] <= box[5])) {
+        return;
+    }
+    center.x = (box[0] + box[3]) / 2.0f;
+    center.z = (box[2] + box[5]) / 2.0f;
+
+    update_position();
+}
+
 void camera::zoom(bool in, bool out) {
     if (in) {
         radius -= 0.1f * radius;
@@ -77,6 +87,16 @@ void camera::zoom(bool in, bool out) {
     update_position();
 }
 
+void camera::pan(float forward, float right) {
+    float x = -cos(glm::radians(theta));
+    float z = -sin(glm::radians(theta));
+
+    center.x += radius * (forward * x - right * z);
+    center.z += radius * (forward * z + right * x);
+
+    update_position();
+}
+
 void camera::update_angles(float theta, float phi) {
     this->theta += theta;
     this->phi += phi;
@@ -96,6 +116,22 @@ void camera::update_angles(float theta, float phi) {
     update_position();
 }
 
+float camera::get_radius() const {
+    return radius;
+}
+
+void camera::ray(float mouse_x, float mouse_y, glm::vec3& origin, glm::vec3& direction) const {
+    glm::highp_mat4 inverse = glm::inverse(view);
+    float x = 2.0f * mouse_x / screen_width - 1.0f;
+    float y = 1.0f - 2.0f * mouse_y / screen_height;
+
+    glm::vec4 front = inverse * glm::vec4(x, y, -1.0f, 1.0f);
+    glm::vec4 back = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+
+    origin = glm::vec3(front.x, front.y, front.z) / front.w;
+    direction = glm::vec3(back.x, back.y, back.z) / back.w - origin;
+}
+
 void camera::update_position() {
     position = glm::vec3(
         radius * sin(glm::radians(phi)) * cos(glm::radians(theta)) + center.x,
@@ -0,0 +1,130 @@
+#include <mine/compaction.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+#include <mine/parallel.hpp>
+
+namespace mine {
+namespace {
+// whether the change from a to b breaks with the changes on the edges either side of it, which are what the slope
+// at either end predicts. a pole or a branch cut turns the change around or blows it up, while on a steep but
+// smooth surface it differs from its neighbours by a fraction of itself. a missing neighbour predicts no change
+bool breaks(float before, float a, float b, float after, float jump) {
+    float change = b - a;
+    float previous = std::isfinite(before) ? a - before : 0.0f;
+    float next = std::isfinite(after) ? after - b : 0.0f;
+    return std::abs(change - previous) > std::max(jump, std::abs(previous)) &&
+        std::abs(change - next) > std::max(jump, std::abs(next));
+}
+}
+
+int flag_cells(const vertex* grid, int rows, int columns, float jump, std::vector<unsigned char>& valid) {
+    int cells = columns - 1;
+    valid.assign((size_t)(rows - 1) * cells, 0);
+
+    auto height = [&](int i, int j) {
+        return i >= 0 && i < rows && j >= 0 && j < columns ? grid[i * columns + j].y : std::numeric_limits<float>::quiet_NaN();
+    };
+    // the edges along row i and down column j leaving sample (i, j)
+    auto row_breaks = [&](int i, int j) {
+        return breaks(height(i, j - 1), height(i, j), height(i, j + 1), height(i, j + 2), jump);
+    };
+    auto column_breaks = [&](int i, int j) {
+        return breaks(height(i - 1, j), height(i, j), height(i + 1, j), height(i + 2, j), jump);
+    };
+
+    std::vector<int> kept(thread_count(), 0);
+    parallel_for(0, rows - 1, [&](int first, int last, int thread) {
+        for (int i = first; i < last; ++i) {
+            const vertex* row = grid + i * columns;
+            const vertex* next = row + columns;
+            for (int j = 0; j < cells; ++j) {
+                std::array<const vertex*, 4> corners{{ row + j, row + j + 1, next + j, next + j + 1 }};
+                bool finite = true;
+                for (const vertex* corner : corners) {
+                    finite = finite && std::isfinite(corner->x) && std::isfinite(corner->y) && std::isfinite(corner->z);
+                }
+                bool keep = finite && (jump <= 0.0f ||
+                    !(row_breaks(i, j) || row_breaks(i + 1, j) || column_breaks(i, j) || column_breaks(i, j + 1)));
+                valid[(size_t)i * cells + j] = keep;
+                kept[thread] += keep;
+            }
+        }
+    });
+
+    int total = 0;
+    for (int k : kept) {
+        total += k;
+    }
+    return total;
+}
+
+void compact_cells(const std::vector<std::vector<unsigned char>>& visible, const std::vector<std::vector<unsigned char>>& valid, int rows, int columns, GLuint first_vertex, std::vector<GLuint>& indices, std::vector<std::array<GLuint, 2>>& ranges) {
+    int cells = columns - 1;
+    int band = rows - 1;
+    int total_rows = (int)visible.size() * band;
+    auto drawn = [&](int k, size_t cell) {
+        return (visible[k].empty() || visible[k][cell]) && (valid[k].empty() || valid[k][cell]);
+    };
+
+    // the cells each row keeps, turned into each row's offset by the second pass
+    std::vector<size_t> row_offsets(total_rows + 1, 0);
+    std::vector<size_t> offsets(thread_count() + 1, 0);
+    parallel_for(0, total_rows, [&](int first, int last, int thread) {
+        size_t count = 0;
+        for (int r = first; r < last; ++r) {
+            int k = r / band;
+            size_t cell = (size_t)(r % band) * cells;
+            size_t kept = 0;
+            for (int j = 0; j < cells; ++j) {
+                kept += drawn(k, cell + j);
+            }
+            row_offsets[r] = kept;
+            count += kept;
+        }
+        offsets[thread + 1] = count;
+    });
+    // parallel_for hands thread t the same band both times, so the scan over the counts lines the bands up
+    for (size_t t = 1; t < offsets.size(); ++t) {
+        offsets[t] += offsets[t - 1];
+    }
+
+    size_t start = indices.size();
+    indices.resize(start + offsets.back() * 6);
+    parallel_for(0, total_rows, [&](int first, int last, int thread) {
+        size_t offset = offsets[thread];
+        for (int r = first; r < last; ++r) {
+            int k = r / band;
+            int i = r % band;
+            size_t kept = row_offsets[r];
+            row_offsets[r] = offset;
+            GLuint* out = indices.data() + start + offset * 6;
+            offset += kept;
+            for (int j = 0; j < cells; ++j) {
+                if (!drawn(k, (size_t)i * cells + j)) {
+                    continue;
+                }
+                GLuint g = first_vertex + (GLuint)(k * rows * columns + i * columns + j);
+                out[0] = g;
+                out[1] = g + 1;
+                out[2] = g + 1 + columns;
+                out[3] = g + 1 + columns;
+                out[4] = g + columns;
+                out[5] = g;
+                out += 6;
+            }
+        }
+    });
+    row_offsets[total_rows] = offsets.back();
+
+    ranges.resize(visible.size());
+    for (size_t k = 0; k < visible.size(); ++k) {
+        size_t first = row_offsets[k * band];
+        size_t last = row_offsets[(k + 1) * band];
+        ranges[k] = {(GLuint)(start + first * 6), (GLuint)((last - first) * 6)};
+    }
+}
+}
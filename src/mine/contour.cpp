@@ -0,0 +1,140 @@
+#include <mine/contour.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include <mine/parallel.hpp>
+
+namespace mine {
+namespace {
+// edge pairs crossed by the level for each corner case, -1 terminated; 5 and 10 are saddles resolved by the cell center
+constexpr std::array<std::array<int, 4>, 16> EDGES{{
+    { -1, -1, -1, -1 },
+    {  3,  0, -1, -1 },
+    {  0,  1, -1, -1 },
+    {  3,  1, -1, -1 },
+    {  1,  2, -1, -1 },
+    {  3,  0,  1,  2 },
+    {  0,  2, -1, -1 },
+    {  3,  2, -1, -1 },
+    {  2,  3, -1, -1 },
+    {  0,  2, -1, -1 },
+    {  0,  1,  2,  3 },
+    {  1,  2, -1, -1 },
+    {  1,  3, -1, -1 },
+    {  0,  1, -1, -1 },
+    {  3,  0, -1, -1 },
+    { -1, -1, -1, -1 }
+}};
+
+constexpr float LIFT = 0.01f;
+constexpr vertex COLOR{0.0f, 0.0f, 0.0f, pack_color(0.05f, 0.05f, 0.05f), 0};
+}
+
+contour::contour() : levels{}, partials{} {}
+
+void contour::set_levels(int count, float low, float high) {
+    levels.clear();
+
+    if (count == 1) {
+        levels.push_back((low + high) / 2.0f);
+    }
+    for (int i = 0; i < count && count > 1; ++i) {
+        levels.push_back(low + (high - low) * i / (count - 1));
+    }
+}
+
+void contour::clear() {
+    segments.clear();
+}
+
+void contour::extract(const vertex* grid, int rows, int columns, const std::vector<unsigned char>& valid) {
+    if (levels.empty() || rows < 2 || columns < 2) {
+        return;
+    }
+
+    partials.resize(thread_count());
+    for (std::vector<vertex>& partial : partials) {
+        partial.clear();
+    }
+
+    parallel_for(0, rows - 1, [&](int first, int last, int thread) {
+        extract_rows(grid, valid, first, last, columns, partials[thread]);
+    });
+
+    for (const std::vector<vertex>& partial : partials) {
+        segments.insert(segments.end(), partial.begin(), partial.end());
+    }
+}
+
+void contour::extract_rows(const vertex* grid, const std::vector<unsigned char>& valid, int first, int last, int columns, std::vector<vertex>& out) const {
+    for (int i = first; i < last; ++i) {
+        for (int j = 0; j < columns - 1; ++j) {
+            if (!valid.empty() && !valid[(size_t)i * (columns - 1) + j]) {
+                continue;
+            }
+            const std::array<const vertex*, 4> corners{{
+                &grid[i * columns + j],
+                &grid[i * columns + j + 1],
+                &grid[(i + 1) * columns + j + 1],
+                &grid[(i + 1) * columns + j]
+            }};
+
+            float low = corners[0]->y;
+            float high = corners[0]->y;
+            bool finite = true;
+            for (const vertex* corner : corners) {
+                finite = finite && std::isfinite(corner->y);
+                low = corner->y < low ? corner->y : low;
+                high = corner->y > high ? corner->y : high;
+            }
+            if (!finite) {
+                continue;
+            }
+
+            // levels are evenly spaced, so only the ones inside [low, high] are visited
+            int begin = 0;
+            int end = (int)levels.size();
+            if (levels.size() > 1 && levels[1] > levels[0]) {
+                float step = levels[1] - levels[0];
+                begin = (int)std::max(0.0f, std::min((float)end, std::ceil((low - levels[0]) / step)));
+                end = (int)std::max(0.0f, std::min((float)end, std::floor((high - levels[0]) / step) + 1.0f));
+            }
+
+            for (int l = begin; l < end; ++l) {
+                float level = levels[l];
+                if (level < low || level > high) {
+                    continue;
+                }
+
+                int index = 0;
+                for (int c = 0; c < 4; ++c) {
+                    index |= (corners[c]->y > level) << c;
+                }
+
+                std::array<int, 4> edges = EDGES[index];
+                float center = (corners[0]->y + corners[1]->y + corners[2]->y + corners[3]->y) / 4.0f;
+                if ((index == 5 && center > level) || (index == 10 && center <= level)) {
+                    edges = EDGES[10];
+                } else if (index == 10) {
+                    edges = EDGES[5];
+                }
+
+                for (int e = 0; e < 4 && edges[e] >= 0; ++e) {
+                    const vertex& a = *corners[edges[e]];
+                    const vertex& b = *corners[(edges[e] + 1) % 4];
+                    float t = (level - a.y) / (b.y - a.y);
+                    out.push_back({
+                        a.x + t * (b.x - a.x),
+                        level + LIFT,
+                        a.z + t * (b.z - a.z),
+                        COLOR.color,
+                        0
+                    });
+                }
+            }
+        }
+    }
+}
+}
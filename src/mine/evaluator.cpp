@@ -0,0 +1,370 @@
+#include <mine/evaluator.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include <mine/normals.hpp>
+#include <mine/parallel.hpp>
+
+namespace mine {
+void height_color(float z, float index, vertex& out, float shade) {
+    out.color = pack_color(
+        shade * std::abs(std::sin(z / 2.0f + index)) / 1.2f,
+        shade * std::abs(std::sin(z / 2.0f + 3.1415926535f / 3 + 6.0f * index)) / 1.2f,
+        shade * std::abs(std::sin(z / 2.0f + (2 * 3.1415926535f) / 3) + index / 15.0f) / 1.2f
+    );
+}
+
+namespace {
+// patches at or below this many cells per side are decided without splitting further
+constexpr int PATCH = 8;
+
+enum sides {
+    OUTSIDE,
+    STRADDLING,
+    INSIDE
+};
+
+// the domain coloring only has to be right to well under a color step, so its log and angle are short
+// polynomials, and their selects pick between constants so the compiler can turn them into masks and vectorize
+// the loop over a batch.
+// log2 of a positive float to about 2e-5, from its exponent and an odd series in (m - 1) / (m + 1) of its
+// mantissa; zero, denormals, infinity and NaN come out far past any clamp
+float fast_log2(float v) {
+    std::uint32_t bits = 0;
+    std::memcpy(&bits, &v, sizeof(bits));
+    float exponent = (float)((int)(bits >> 23) - 127);
+    bits = (bits & 0x007fffffu) | 0x3f800000u;
+    float m = 0.0f;
+    std::memcpy(&m, &bits, sizeof(m));
+    float t = (m - 1.0f) / (m + 1.0f);
+    float t2 = t * t;
+    return exponent + t * (2.8853901f + t2 * (0.9617967f + t2 * (0.5770780f + t2 * 0.4121986f)));
+}
+
+// atan2(y, x) in turns, in [-0.5, 0.5], to about 1e-6 of a turn: a minimax arctangent on [0, 1] folded out to
+// the octants
+float fast_turns(float y, float x) {
+    float ax = std::abs(x);
+    float ay = std::abs(y);
+    // 0 / 0 is never taken, and at the origin the angle is 0
+    float t = std::min(ax, ay) / std::max(std::max(ax, ay), std::numeric_limits<float>::min());
+    float s = t * t;
+    float a = t * (0.15915132f + s * (-0.05293867f + s * (0.03080340f + s * (-0.01853087f + s * (0.00838004f + s * -0.00186549f)))));
+    a = a * (ay > ax ? -1.0f : 1.0f) + (ay > ax ? 0.25f : 0.0f);
+    a = a * (x < 0.0f ? -1.0f : 1.0f) + (x < 0.0f ? 0.5f : 0.0f);
+    return std::copysign(a, y);
+}
+
+// c clamped to [0, 1] with arithmetic, where min and max would leave selects that keep the conversion in
+// pack_unit from vectorizing
+float unit(float c) {
+    return 0.5f * (1.0f + std::abs(c) - std::abs(c - 1.0f));
+}
+
+// pack_color for channels already in [0, 1]
+GLuint pack_unit(float r, float g, float b) {
+    auto channel = [](float c) {
+        return (GLuint)(int)(c * 255.0f + 0.5f);
+    };
+    return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (255u << 24);
+}
+
+// classifies the world box [x] x [y] x [z] against the clip volume -w <= x, y, z <= w of a column-major matrix
+int classify_box(const float* m, double x0, double x1, double y0, double y1, double z0, double z1) {
+    std::array<int, 6> out{};
+    for (int c = 0; c < 8; ++c) {
+        double x = (c & 1) ? x1 : x0;
+        double y = (c & 2) ? y1 : y0;
+        double z = (c & 4) ? z1 : z0;
+        std::array<double, 4> p{};
+        for (int r = 0; r < 4; ++r) {
+            p[r] = m[r] * x + m[4 + r] * y + m[8 + r] * z + m[12 + r];
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            out[2 * axis] += p[axis] < -p[3];
+            out[2 * axis + 1] += p[axis] > p[3];
+        }
+    }
+
+    bool inside = true;
+    for (int plane : out) {
+        if (plane == 8) {
+            return OUTSIDE;
+        }
+        inside = inside && plane == 0;
+    }
+    return inside ? INSIDE : STRADDLING;
+}
+}
+
+int cull_cells(const expression& function, const std::array<int, 4>& bounds, int rows, int columns, const culling& view, std::vector<unsigned char>& visible) {
+    double x_ref = (double)(bounds[POS_X_BOUND] - bounds[NEG_X_BOUND]) / (rows - 1);
+    double z_ref = (double)(bounds[POS_Z_BOUND] - bounds[NEG_Z_BOUND]) / (columns - 1);
+    int cells = columns - 1;
+
+    visible.assign((size_t)(rows - 1) * cells, 0);
+
+    // decides the patch [i0, i1) x [j0, j1) of cells, returning how many were kept
+    auto patch = [&](auto& self, int i0, int i1, int j0, int j1) -> int {
+        double x0 = bounds[NEG_X_BOUND] + i0 * x_ref;
+        double x1 = bounds[NEG_X_BOUND] + i1 * x_ref;
+        double z0 = bounds[NEG_Z_BOUND] + j0 * z_ref;
+        double z1 = bounds[NEG_Z_BOUND] + j1 * z_ref;
+        interval y = function.evaluate_interval({std::min(x0, x1), std::max(x0, x1)}, {std::min(z0, z1), std::max(z0, z1)});
+
+        if (y.hi < view.low || y.lo > view.high) {
+            return 0;
+        }
+
+        int side = INSIDE;
+        double y0 = std::max(y.lo, view.low);
+        double y1 = std::min(y.hi, view.high);
+        if (view.clip && (!std::isfinite(y0) || !std::isfinite(y1))) {
+            side = STRADDLING;
+        } else if (view.clip) {
+            side = classify_box(view.clip, x0, x1, y0, y1, z0, z1);
+            if (side == OUTSIDE) {
+                return 0;
+            }
+        }
+
+        bool settled = side == INSIDE && y.lo >= view.low && y.hi <= view.high;
+        if (settled || (i1 - i0 <= PATCH && j1 - j0 <= PATCH)) {
+            for (int i = i0; i < i1; ++i) {
+                std::fill(visible.begin() + i * cells + j0, visible.begin() + i * cells + j1, 1);
+            }
+            return (i1 - i0) * (j1 - j0);
+        }
+
+        int im = i1 - i0 > PATCH ? (i0 + i1) / 2 : i1;
+        int jm = j1 - j0 > PATCH ? (j0 + j1) / 2 : j1;
+        int kept = self(self, i0, im, j0, jm);
+        if (jm < j1) {
+            kept += self(self, i0, im, jm, j1);
+        }
+        if (im < i1) {
+            kept += self(self, im, i1, j0, jm);
+        }
+        if (im < i1 && jm < j1) {
+            kept += self(self, im, i1, jm, j1);
+        }
+        return kept;
+    };
+
+    // the top level is split into one band of rows per thread, since each band's tree is independent
+    std::vector<int> kept(thread_count(), 0);
+    parallel_for(0, (rows - 2) / PATCH + 1, [&](int first, int last, int thread) {
+        for (int band = first; band < last; ++band) {
+            kept[thread] += patch(patch, band * PATCH, std::min((band + 1) * PATCH, rows - 1), 0, cells);
+        }
+    });
+
+    int total = 0;
+    for (int k : kept) {
+        total += k;
+    }
+    return total;
+}
+
+namespace {
+// the rows [first_row, last_row) by columns [first_column, last_column) of evaluate_height_field's grid, with
+// each thread's height range merged into partial
+void evaluate_block(const expression& function, const std::array<int, 4>& bounds, float index, vertex* grid, int rows, int columns, std::array<int, 4> block, const std::vector<unsigned char>* visible, std::vector<height_range>& partial, const std::atomic<bool>* cancelled) {
+    double x_ref = (double)(bounds[POS_X_BOUND] - bounds[NEG_X_BOUND]) / (rows - 1);
+    double z_ref = (double)(bounds[POS_Z_BOUND] - bounds[NEG_Z_BOUND]) / (columns - 1);
+    int cells = columns - 1;
+
+    // a vertex is needed if any of the up to four cells around it is drawn
+    auto needed = [&](int i, int j) {
+        for (int ci = std::max(i - 1, 0); ci <= std::min(i, rows - 2); ++ci) {
+            for (int cj = std::max(j - 1, 0); cj <= std::min(j, cells - 1); ++cj) {
+                if ((*visible)[ci * cells + cj]) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    parallel_for(block[0], block[1], [&](int first, int last, int thread) {
+        std::array<double, BATCH> z{};
+        std::array<float, BATCH> y{};
+        std::array<double, BATCH> f{};
+        std::array<double, BATCH> dfdx{};
+        std::array<double, BATCH> dfdz{};
+        std::array<int, BATCH> column{};
+
+        for (int i = first; i < last; ++i) {
+            if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+                return;
+            }
+            double x = bounds[NEG_X_BOUND] + i * x_ref;
+
+            // gather the needed columns of the row into full batches, leaving the culled ones untouched by the tape
+            int j = block[2];
+            while (j < block[3]) {
+                int lanes = 0;
+                for (; j < block[3] && lanes < BATCH; ++j) {
+                    if (visible && !needed(i, j)) {
+                        vertex& out = grid[i * columns + j];
+                        out.x = (float)x;
+                        out.y = std::numeric_limits<float>::quiet_NaN();
+                        out.z = (float)(bounds[NEG_Z_BOUND] + j * z_ref);
+                        out.normal = 0;
+                        continue;
+                    }
+                    z[lanes] = bounds[NEG_Z_BOUND] + j * z_ref;
+                    column[lanes] = j;
+                    lanes++;
+                }
+                if (lanes == 0) {
+                    continue;
+                }
+
+                function.evaluate_dual_row(x, z.data(), f.data(), dfdx.data(), dfdz.data(), lanes);
+
+                for (int l = 0; l < lanes; ++l) {
+                    vertex& out = grid[i * columns + column[l]];
+                    y[l] = (float)f[l];
+                    out.x = (float)x;
+                    out.y = y[l];
+                    out.z = (float)z[l];
+                    height_color(out.y, index, out);
+                    out.normal = pack_normal((float)-dfdx[l], 1.0f, (float)-dfdz[l]);
+                }
+                // the batch is still in cache, so the range costs no pass of its own
+                accumulate(partial[thread], y.data(), lanes);
+            }
+        }
+    });
+}
+}
+
+bool evaluate_height_field(const expression& function, const std::array<int, 4>& bounds, float index, vertex* grid, int rows, int columns, const std::vector<unsigned char>* visible, height_range* heights, const std::atomic<bool>* cancelled) {
+    std::vector<height_range> partial(thread_count());
+    evaluate_block(function, bounds, index, grid, rows, columns, {0, rows, 0, columns}, visible, partial, cancelled);
+
+    if (heights) {
+        *heights = {};
+        for (const height_range& part : partial) {
+            merge(*heights, part);
+        }
+    }
+    return !cancelled || !cancelled->load(std::memory_order_relaxed);
+}
+
+void evaluate_height_block(const expression& function, const std::array<int, 4>& bounds, float index, vertex* grid, int rows, int columns, const std::array<int, 4>& block) {
+    if (block[0] >= block[1] || block[2] >= block[3]) {
+        return;
+    }
+    std::vector<height_range> partial(thread_count());
+    evaluate_block(function, bounds, index, grid, rows, columns, block, nullptr, partial, nullptr);
+}
+
+bool evaluate_complex_field(const expression& function, const std::array<int, 4>& bounds, vertex* grid, int rows, int columns, bool relief, height_range* heights, const std::atomic<bool>* cancelled) {
+    // LOG_MODULUS_LIMIT in doublings
+    constexpr float RING_LIMIT = LOG_MODULUS_LIMIT / 0.6931472f;
+    double x_ref = (double)(bounds[POS_X_BOUND] - bounds[NEG_X_BOUND]) / (rows - 1);
+    double z_ref = (double)(bounds[POS_Z_BOUND] - bounds[NEG_Z_BOUND]) / (columns - 1);
+
+    std::vector<height_range> partial(thread_count());
+    parallel_for(0, rows, [&](int first, int last, int thread) {
+        std::array<double, BATCH> z{};
+        std::array<double, BATCH> re{};
+        std::array<double, BATCH> im{};
+        std::array<float, BATCH> y{};
+        std::array<float, BATCH> real{};
+        std::array<float, BATCH> imag{};
+        std::array<float, BATCH> ring{};
+        std::array<float, BATCH> hue{};
+        std::array<float, BATCH> level{};
+        std::array<GLuint, BATCH> color{};
+
+        for (int i = first; i < last; ++i) {
+            if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+                return;
+            }
+            double x = bounds[NEG_X_BOUND] + i * x_ref;
+            for (int j = 0; j < columns; j += BATCH) {
+                int lanes = std::min(BATCH, columns - j);
+                for (int l = 0; l < lanes; ++l) {
+                    z[l] = bounds[NEG_Z_BOUND] + (j + l) * z_ref;
+                }
+
+                function.evaluate_complex_row(x, z.data(), re.data(), im.data(), lanes);
+
+                // the passes without calls in them run over the whole batch, a fixed count the compiler vectorizes
+                // even at -O2; the lanes past the row's end hold finite leftovers and are never stored
+                for (int l = 0; l < BATCH; ++l) {
+                    // squared in double, so only moduli far past the clamp overflow, and an infinite part is the
+                    // point at infinity
+                    float norm = (float)(re[l] * re[l] + im[l] * im[l]);
+                    norm = std::max(norm, std::isinf(re[l]) | std::isinf(im[l]) ? std::numeric_limits<float>::infinity() : 0.0f);
+                    level[l] = norm;
+                    // the height starts as NaN where f is and 0 elsewhere
+                    y[l] = std::min(norm, 0.0f);
+                    real[l] = (float)re[l];
+                    imag[l] = (float)im[l];
+                }
+                for (int l = 0; l < BATCH; ++l) {
+                    // NaN where f is, which is a hole; it is given hue 0 so that the colors stay finite
+                    float turns = fast_turns(imag[l], real[l]);
+                    hue[l] = std::min(1.0f, std::max(0.0f, turns + (turns < 0.0f ? 1.0f : 0.0f)));
+                }
+                for (int l = 0; l < BATCH; ++l) {
+                    // a ring at every doubling of |f|
+                    ring[l] = std::max(std::min(0.5f * fast_log2(level[l]), RING_LIMIT), -RING_LIMIT);
+                }
+                // off the relief zeros fade to black and poles to white; a level of 1/2 leaves the color as it is
+                for (int l = 0; l < lanes; ++l) {
+                    level[l] = relief || level[l] != level[l] ? 0.5f : 2.0f / 3.1415926535f * std::atan(std::sqrt(level[l]));
+                }
+                for (int l = 0; l < BATCH; ++l) {
+                    // shifted by whole rings to be positive, where truncating is flooring
+                    float shifted = ring[l] + 12.0f;
+                    float value = (0.75f + 0.25f * (shifted - (float)(int)shifted)) * unit(2.0f * level[l]);
+                    float lift = unit(2.0f * level[l] - 1.0f);
+
+                    // the hue circle red, yellow, green, cyan, blue, magenta, washed toward white by lift
+                    auto channel = [&](float c) {
+                        c = unit(c);
+                        return value * (c + (1.0f - c) * lift);
+                    };
+                    color[l] = pack_unit(
+                        channel(std::abs(hue[l] * 6.0f - 3.0f) - 1.0f),
+                        channel(2.0f - std::abs(hue[l] * 6.0f - 2.0f)),
+                        channel(2.0f - std::abs(hue[l] * 6.0f - 4.0f))
+                    );
+                    y[l] += ring[l] * (relief ? 0.6931472f : 0.0f);
+                }
+
+                for (int l = 0; l < lanes; ++l) {
+                    vertex& out = grid[i * columns + j + l];
+                    out.x = (float)x;
+                    out.y = y[l];
+                    out.z = (float)z[l];
+                    out.color = color[l];
+                }
+                accumulate(partial[thread], y.data(), lanes);
+            }
+        }
+    });
+    if (cancelled && cancelled->load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    compute_normals(grid, rows, columns);
+
+    if (heights) {
+        *heights = {};
+        for (const height_range& part : partial) {
+            merge(*heights, part);
+        }
+    }
+    return true;
+}
+}
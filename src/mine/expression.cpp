@@ -0,0 +1,1144 @@
+#include <mine/expression.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <tuple>
+#include <utility>
+
+namespace mine {
+namespace {
+struct function_name {
+    const char* name;
+    int op;
+    int arguments;
+};
+
+constexpr std::array<function_name, 17> FUNCTIONS{{
+    { "sin",  SIN,  1 },
+    { "cos",  COS,  1 },
+    { "tan",  TAN,  1 },
+    { "asin", ASIN, 1 },
+    { "acos", ACOS, 1 },
+    { "atan", ATAN, 1 },
+    { "sinh", SINH, 1 },
+    { "cosh", COSH, 1 },
+    { "tanh", TANH, 1 },
+    { "exp",  EXP,  1 },
+    { "log",  LOG,  1 },
+    { "sqrt", SQRT, 1 },
+    { "abs",  ABS,  1 },
+    { "pow",  POW,  2 },
+    { "min",  MIN,  2 },
+    { "max",  MAX,  2 },
+    { "mod",  MOD,  2 }
+}};
+
+constexpr double PI = 3.14159265358979323846;
+constexpr int MAX_EXPANDED_POWER = 16;
+
+constexpr std::array<const char*, ABS + 1> GLSL_NAMES{{
+    "", "", "", "", "", "", "", "", "", "", "pow", "min", "max", "mod",
+    "sin", "cos", "tan", "asin", "acos", "atan", "sinh", "cosh", "tanh", "exp", "log", "sqrt", "abs"
+}};
+
+// one op on scalars, used to fold constant subtrees
+double apply(int op, double a, double b) {
+    switch (op) {
+        case ADD:  return a + b;
+        case SUB:  return a - b;
+        case MUL:  return a * b;
+        case DIV:  return a / b;
+        case NEG:  return -a;
+        case POW:  return std::pow(a, b);
+        case MIN:  return std::min(a, b);
+        case MAX:  return std::max(a, b);
+        case MOD:  return a - b * std::floor(a / b);
+        case SIN:  return std::sin(a);
+        case COS:  return std::cos(a);
+        case TAN:  return std::tan(a);
+        case ASIN: return std::asin(a);
+        case ACOS: return std::acos(a);
+        case ATAN: return std::atan(a);
+        case SINH: return std::sinh(a);
+        case COSH: return std::cosh(a);
+        case TANH: return std::tanh(a);
+        case EXP:  return std::exp(a);
+        case LOG:  return std::log(a);
+        case SQRT: return std::sqrt(a);
+        case ABS:  return std::abs(a);
+        default:   return 0.0;
+    }
+}
+
+// true when 1 / value is exact, so a division by it can become a multiply
+bool power_of_two(double value) {
+    int exponent = 0;
+    return value != 0.0 && std::isfinite(value) && std::abs(std::frexp(value, &exponent)) == 0.5 && std::isfinite(1.0 / value);
+}
+
+std::string glsl_constant(double value) {
+    if (std::isnan(value)) {
+        return "uintBitsToFloat(0x7fc00000u)";
+    } else if (std::isinf(value)) {
+        return value > 0.0 ? "uintBitsToFloat(0x7f800000u)" : "uintBitsToFloat(0xff800000u)";
+    }
+    std::array<char, 32> buffer{};
+    std::snprintf(buffer.data(), buffer.size(), "%.9g", value);
+    std::string text = buffer.data();
+    if (text.find_first_of(".e") == std::string::npos) {
+        text += ".0";
+    }
+    return value < 0.0 ? "(" + text + ")" : text;
+}
+
+constexpr double INF = std::numeric_limits<double>::infinity();
+constexpr interval WHOLE{-INF, INF};
+
+// both from one expm1 of |v|, which keeps sinh exact near zero; past where its square overflows libm takes over
+void hyperbolic(double v, double& sinh, double& cosh) {
+    if (std::abs(v) > 350.0) {
+        sinh = std::sinh(v);
+        cosh = std::cosh(v);
+        return;
+    }
+    double m = std::expm1(std::abs(v));
+    sinh = std::copysign(0.5 * m * (m + 2.0) / (m + 1.0), v);
+    cosh = std::abs(sinh) + 1.0 / (m + 1.0);
+}
+
+// a zero factor stays zero even against an overflowed one, so exp(x) on the real axis is infinite and not NaN
+double scale(double factor, double overflowed) {
+    return factor == 0.0 ? factor : factor * overflowed;
+}
+
+// |x + iy|; libm's hypot guards against overflow and underflow at a cost several times a square root, so it is
+// only taken where the squares would leave the range of a double
+double magnitude(double x, double y) {
+    double larger = std::max(std::abs(x), std::abs(y));
+    return larger > 1e-150 && larger < 1e150 ? std::sqrt(x * x + y * y) : std::hypot(x, y);
+}
+
+// atan2(y, x) from atan of the smaller part over the larger, folded out to the octants, for half of libm's
+// atan2's cost; zeros and infinities go to atan2 itself, whose signs there are the ones the branch cuts follow
+double angle(double y, double x) {
+    double ax = std::abs(x);
+    double ay = std::abs(y);
+    double high = std::max(ax, ay);
+    if (!(high > 0.0 && high < INF) || std::min(ax, ay) == 0.0) {
+        return std::atan2(y, x);
+    }
+    double a = std::atan(std::min(ax, ay) / high);
+    a = ay > ax ? 0.5 * PI - a : a;
+    a = x < 0.0 ? PI - a : a;
+    return std::copysign(a, y);
+}
+
+// tan(x + iy) from sin 2x and sinh 2y over a shared denominator; far from the real axis it is +-i to working
+// precision, and the real part is taken from the exponential before cosh y overflows
+void tangent(double x, double y, double& re, double& im) {
+    double s = std::sin(x);
+    double c = std::cos(x);
+    if (std::abs(y) > 20.0) {
+        re = 4.0 * s * c * std::exp(-2.0 * std::abs(y));
+        im = std::copysign(1.0, y);
+        return;
+    }
+    double sinh = 0.0;
+    double cosh = 0.0;
+    hyperbolic(y, sinh, cosh);
+    double inverse = 1.0 / (c * c + sinh * sinh);
+    re = s * c * inverse;
+    im = sinh * cosh * inverse;
+}
+
+// the principal root, taking the part that cannot cancel from the modulus and the other from it by division
+void square_root(double x, double y, double& re, double& im) {
+    if (x == 0.0 && y == 0.0) {
+        re = 0.0;
+        im = y;
+        return;
+    }
+    double t = std::sqrt(0.5 * (std::abs(x) + magnitude(x, y)));
+    re = x >= 0.0 ? t : std::abs(y) / (2.0 * t);
+    im = x >= 0.0 ? y / (2.0 * t) : std::copysign(t, y);
+}
+
+// asin and acos through the distances to +-1 (Hull, Fairgrieve and Tang), arranged so that neither part cancels
+// near the branch points. both share the imaginary part up to sign, and their real parts are atan2(x, root) and
+// atan2(root, x)
+void arcsine(double x, double y, double& root, double& im) {
+    double ax = std::abs(x);
+    double ay = std::abs(y);
+    double r = magnitude(ax + 1.0, ay);
+    double s = magnitude(ax - 1.0, ay);
+    double a = std::max(0.5 * (r + s), 1.0);
+    double near = ay * ay / (r + ax + 1.0);
+    double d = ax <= 1.0 ? near + s + (1.0 - ax) : near + ay * ay / (s + ax - 1.0);
+    root = std::sqrt(0.5 * (a + ax) * d);
+    if (a <= 1.5) {
+        double am1 = ax < 1.0 ? 0.5 * (near + ay * ay / (s + 1.0 - ax)) : 0.5 * (near + s + ax - 1.0);
+        im = std::copysign(std::log1p(am1 + std::sqrt(am1 * (a + 1.0))), y);
+    } else {
+        im = std::copysign(std::acosh(a), y);
+    }
+}
+
+// atan(x + iy) as half the angle and a quarter of the log of the squared distances to -i and i. for y >= 0 their
+// ratio is 1 + 4y / |z - i|^2, which never cancels, and the lower half plane mirrors it; squares past the range
+// of a double send the ratio to 1 or to the pole at i, where the limits are
+void arctangent(double x, double y, double& re, double& im) {
+    double length = magnitude(x, y);
+    double ay = std::abs(y);
+    re = 0.5 * angle(2.0 * x, (1.0 - length) * (1.0 + length));
+    im = std::copysign(0.25 * std::log1p(4.0 * ay / (x * x + (ay - 1.0) * (ay - 1.0))), y);
+}
+
+interval hull(double a, double b, double c, double d) {
+    double lo = std::min(std::min(a, b), std::min(c, d));
+    double hi = std::max(std::max(a, b), std::max(c, d));
+    return std::isnan(lo) || std::isnan(hi) ? WHOLE : interval{lo, hi};
+}
+
+interval multiply(interval a, interval b) {
+    return hull(a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi);
+}
+
+// true if some point offset + k * period lies inside a
+bool contains_phase(interval a, double offset, double period) {
+    double k = std::ceil((a.lo - offset) / period);
+    return offset + k * period <= a.hi;
+}
+
+interval sine(interval a) {
+    if (!(a.hi - a.lo < 2.0 * PI)) {
+        return {-1.0, 1.0};
+    }
+    double lo = std::min(std::sin(a.lo), std::sin(a.hi));
+    double hi = std::max(std::sin(a.lo), std::sin(a.hi));
+    if (contains_phase(a, PI / 2.0, 2.0 * PI)) {
+        hi = 1.0;
+    }
+    if (contains_phase(a, -PI / 2.0, 2.0 * PI)) {
+        lo = -1.0;
+    }
+    return {lo, hi};
+}
+
+interval power(interval a, interval b) {
+    // integer exponents keep the sign structure of x^n, everything else needs a positive base
+    if (b.lo == b.hi && b.lo == std::floor(b.lo) && std::abs(b.lo) <= 1024.0) {
+        double n = b.lo;
+        if (n == 0.0) {
+            return {1.0, 1.0};
+        }
+        if (n < 0.0 && a.lo <= 0.0 && a.hi >= 0.0) {
+            return WHOLE;
+        }
+        double p = std::pow(a.lo, n);
+        double q = std::pow(a.hi, n);
+        if (std::fmod(n, 2.0) == 0.0 && a.lo < 0.0 && a.hi > 0.0) {
+            return n > 0.0 ? interval{0.0, std::max(p, q)} : WHOLE;
+        }
+        return hull(p, q, p, q);
+    }
+    if (a.lo <= 0.0) {
+        return WHOLE;
+    }
+    return hull(std::pow(a.lo, b.lo), std::pow(a.lo, b.hi), std::pow(a.hi, b.lo), std::pow(a.hi, b.hi));
+}
+}
+
+expression::expression() : nodes{}, source{}, error{}, position{}, parsed{}, invariant{}, complex{false} {}
+
+bool expression::parse(const std::string& source, bool complex) {
+    this->source = source;
+    this->complex = complex;
+    nodes.clear();
+    error.clear();
+    position = 0;
+
+    int root = parse_sum();
+    skip_spaces();
+    if (root >= 0 && position < source.size()) {
+        fail("unexpected '" + std::string(1, source[position]) + "'");
+        root = -1;
+    }
+    if (root < 0) {
+        nodes.clear();
+        parsed = 0;
+        invariant = 0;
+        return false;
+    }
+
+    parsed = (int)nodes.size();
+    optimize();
+
+    return true;
+}
+
+bool expression::is_complex() const {
+    return complex;
+}
+
+bool expression::empty() const {
+    return nodes.empty();
+}
+
+int expression::size() const {
+    return (int)nodes.size();
+}
+
+int expression::parsed_size() const {
+    return parsed;
+}
+
+const std::string& expression::get_source() const {
+    return source;
+}
+
+const std::string& expression::get_error() const {
+    return error;
+}
+
+int expression::parse_sum() {
+    int left = parse_product();
+    while (left >= 0) {
+        skip_spaces();
+        if (position >= source.size() || (source[position] != '+' && source[position] != '-')) {
+            break;
+        }
+        int op = source[position++] == '+' ? ADD : SUB;
+        int right = parse_product();
+        left = right < 0 ? -1 : push(op, left, right, 0.0);
+    }
+    return left;
+}
+
+int expression::parse_product() {
+    int left = parse_unary();
+    while (left >= 0) {
+        skip_spaces();
+        if (position >= source.size() || (source[position] != '*' && source[position] != '/')) {
+            break;
+        }
+        int op = source[position++] == '*' ? MUL : DIV;
+        int right = parse_unary();
+        left = right < 0 ? -1 : push(op, left, right, 0.0);
+    }
+    return left;
+}
+
+int expression::parse_unary() {
+    skip_spaces();
+    if (position < source.size() && (source[position] == '-' || source[position] == '+')) {
+        bool negate = source[position++] == '-';
+        int operand = parse_unary();
+        return (operand < 0 || !negate) ? operand : push(NEG, operand, -1, 0.0);
+    }
+    return parse_primary();
+}
+
+int expression::parse_primary() {
+    skip_spaces();
+    if (position >= source.size()) {
+        fail("unexpected end of expression");
+        return -1;
+    }
+
+    char c = source[position];
+
+    if (c == '(') {
+        ++position;
+        int inner = parse_sum();
+        skip_spaces();
+        if (inner >= 0 && (position >= source.size() || source[position] != ')')) {
+            fail("missing ')'");
+            return -1;
+        }
+        ++position;
+        return inner;
+    }
+
+    if (std::isdigit((unsigned char)c) || c == '.') {
+        const char* begin = source.c_str() + position;
+        char* end = nullptr;
+        double value = std::strtod(begin, &end);
+        if (end == begin) {
+            fail("malformed number");
+            return -1;
+        }
+        position += end - begin;
+        if (position < source.size() && (source[position] == 'f' || source[position] == 'F')) {
+            ++position;
+        }
+        return push(CONSTANT, -1, -1, value);
+    }
+
+    if (!std::isalpha((unsigned char)c) && c != '_') {
+        fail("unexpected '" + std::string(1, c) + "'");
+        return -1;
+    }
+
+    size_t begin = position;
+    while (position < source.size() && (std::isalnum((unsigned char)source[position]) || source[position] == '_')) {
+        ++position;
+    }
+    std::string name = source.substr(begin, position - begin);
+
+    // the same names the compute shader binds: u and t alias x, v aliases y
+    if (name == "x" || name == "u" || name == "t") {
+        return push(VARIABLE_X, -1, -1, 0.0);
+    } else if (name == "y" || name == "v") {
+        return push(VARIABLE_Y, -1, -1, 0.0);
+    } else if (name == "pi") {
+        return push(CONSTANT, -1, -1, PI);
+    } else if (complex && name == "z") {
+        return push(VARIABLE_Z, -1, -1, 0.0);
+    } else if (complex && name == "i") {
+        return push(IMAGINARY, -1, -1, 0.0);
+    }
+
+    const function_name* function = nullptr;
+    for (const function_name& candidate : FUNCTIONS) {
+        if (name == candidate.name) {
+            function = &candidate;
+        }
+    }
+    if (!function) {
+        fail("unknown name '" + name + "'");
+        return -1;
+    }
+    if (complex && (function->op == MIN || function->op == MAX || function->op == MOD)) {
+        fail(name + " is not defined for complex values");
+        return -1;
+    }
+
+    skip_spaces();
+    if (position >= source.size() || source[position] != '(') {
+        fail("expected '(' after " + name);
+        return -1;
+    }
+    ++position;
+
+    std::array<int, 2> arguments{{ -1, -1 }};
+    for (int i = 0; i < function->arguments; ++i) {
+        arguments[i] = parse_sum();
+        if (arguments[i] < 0) {
+            return -1;
+        }
+        skip_spaces();
+        char expected = (i + 1 == function->arguments) ? ')' : ',';
+        if (position >= source.size() || source[position] != expected) {
+            fail(std::string("expected '") + expected + "' in " + name);
+            return -1;
+        }
+        ++position;
+    }
+
+    return push(function->op, arguments[0], arguments[1], 0.0);
+}
+
+void expression::optimize() {
+    std::vector<node> out{};
+    std::map<std::tuple<int, int, int, uint64_t>, int> seen{};
+
+    // folds constants and returns an existing node for any op already on the tape
+    auto intern = [&](int op, int a, int b, double value) -> int {
+        bool foldable = op > IMAGINARY && out[a].op == CONSTANT && (b < 0 || out[b].op == CONSTANT);
+        double folded = foldable ? apply(op, out[a].value, b < 0 ? 0.0 : out[b].value) : 0.0;
+        // a real NaN such as sqrt(-1) may well have a complex value, so a complex tape leaves it to run
+        if (foldable && !(complex && std::isnan(folded))) {
+            value = folded;
+            op = CONSTANT;
+            a = -1;
+            b = -1;
+        }
+        if ((op == ADD || op == MUL || op == MIN || op == MAX) && a > b) {
+            std::swap(a, b);
+        }
+
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        auto key = std::make_tuple(op, a, b, bits);
+        auto found = seen.find(key);
+        if (found != seen.end()) {
+            return found->second;
+        }
+        out.push_back({op, a, b, value});
+        seen.emplace(key, (int)out.size() - 1);
+        return (int)out.size() - 1;
+    };
+    auto is_constant = [&](int n, double value) {
+        return out[n].op == CONSTANT && out[n].value == value;
+    };
+
+    std::vector<int> remap(nodes.size());
+    for (size_t n = 0; n < nodes.size(); ++n) {
+        node op = nodes[n];
+        int a = op.a >= 0 ? remap[op.a] : -1;
+        int b = op.b >= 0 ? remap[op.b] : -1;
+
+        // the ADD, SUB, MUL, DIV and NEG rewrites hold for every IEEE input (up to the sign of a zero), so they
+        // agree with the typed expression bit for bit; the pow expansion below does not
+        if (op.op == ADD && is_constant(a, 0.0)) {
+            remap[n] = b;
+        } else if ((op.op == ADD || op.op == SUB) && is_constant(b, 0.0)) {
+            remap[n] = a;
+        } else if (op.op == MUL && is_constant(a, 1.0)) {
+            remap[n] = b;
+        } else if ((op.op == MUL || op.op == DIV) && is_constant(b, 1.0)) {
+            remap[n] = a;
+        } else if (op.op == NEG && out[a].op == NEG) {
+            remap[n] = out[a].a;
+        } else if (op.op == DIV && out[b].op == CONSTANT && power_of_two(out[b].value)) {
+            // dividing by a power of two is exact as a multiply
+            remap[n] = intern(MUL, a, intern(CONSTANT, -1, -1, 1.0 / out[b].value), 0.0);
+        } else if (op.op == POW && out[b].op == CONSTANT && out[a].op != CONSTANT &&
+                   out[b].value == std::floor(out[b].value) && std::abs(out[b].value) <= MAX_EXPANDED_POWER) {
+            // square and multiply, so pow(x, 5) is three products. each product rounds, and so does the 1 / result
+            // of a negative power, so this can differ from std::pow and GLSL pow in the last bits
+            int exponent = (int)std::abs(out[b].value);
+            int result = exponent == 0 ? intern(CONSTANT, -1, -1, 1.0) : -1;
+            int base = a;
+            while (exponent > 0) {
+                if (exponent & 1) {
+                    result = result < 0 ? base : intern(MUL, result, base, 0.0);
+                }
+                exponent >>= 1;
+                if (exponent > 0) {
+                    base = intern(MUL, base, base, 0.0);
+                }
+            }
+            remap[n] = out[b].value < 0.0 ? intern(DIV, intern(CONSTANT, -1, -1, 1.0), result, 0.0) : result;
+        } else {
+            remap[n] = intern(op.op, a, b, op.value);
+        }
+    }
+
+    // keep what the result reaches, x-only nodes first; both groups stay in tape order so operands still come first
+    int root = remap.back();
+    std::vector<char> live(out.size(), 0);
+    std::vector<char> varies(out.size(), 0);
+    live[root] = 1;
+    for (int n = root; n >= 0; --n) {
+        if (live[n] && out[n].a >= 0) {
+            live[out[n].a] = 1;
+        }
+        if (live[n] && out[n].b >= 0) {
+            live[out[n].b] = 1;
+        }
+    }
+    for (size_t n = 0; n < out.size(); ++n) {
+        varies[n] = out[n].op == VARIABLE_Y || out[n].op == VARIABLE_Z || (out[n].a >= 0 && varies[out[n].a]) || (out[n].b >= 0 && varies[out[n].b]);
+    }
+
+    std::vector<int> order(out.size(), -1);
+    nodes.clear();
+    for (int pass = 0; pass < 2; ++pass) {
+        for (size_t n = 0; n < out.size(); ++n) {
+            if (!live[n] || varies[n] != pass) {
+                continue;
+            }
+            node op = out[n];
+            op.a = op.a >= 0 ? order[op.a] : -1;
+            op.b = op.b >= 0 ? order[op.b] : -1;
+            order[n] = (int)nodes.size();
+            nodes.push_back(op);
+        }
+        if (pass == 0) {
+            invariant = (int)nodes.size();
+        }
+    }
+}
+
+std::string expression::glsl(const std::string& prefix, std::string& statements) const {
+    std::vector<std::string> names(nodes.size());
+
+    for (size_t n = 0; n < nodes.size(); ++n) {
+        const node& op = nodes[n];
+        const std::string& a = op.a >= 0 ? names[op.a] : names[n];
+        const std::string& b = op.b >= 0 ? names[op.b] : names[n];
+
+        std::string value{};
+        switch (op.op) {
+            case CONSTANT:   names[n] = glsl_constant(op.value); continue;
+            case VARIABLE_X: names[n] = "x"; continue;
+            case VARIABLE_Y: names[n] = "y"; continue;
+            case ADD: value = a + " + " + b; break;
+            case SUB: value = a + " - " + b; break;
+            case MUL: value = a + " * " + b; break;
+            case DIV: value = a + " / " + b; break;
+            case NEG: value = "-" + a; break;
+            case POW:
+            case MIN:
+            case MAX:
+            case MOD: value = std::string(GLSL_NAMES[op.op]) + "(" + a + ", " + b + ")"; break;
+            default:  value = std::string(GLSL_NAMES[op.op]) + "(" + a + ")"; break;
+        }
+
+        names[n] = prefix + std::to_string(n);
+        statements += "    float " + names[n] + " = " + value + ";\n";
+    }
+
+    return nodes.empty() ? "0.0" : names.back();
+}
+
+int expression::push(int op, int a, int b, double value) {
+    nodes.push_back({op, a, b, value});
+    return (int)nodes.size() - 1;
+}
+
+void expression::skip_spaces() {
+    while (position < source.size() && std::isspace((unsigned char)source[position])) {
+        ++position;
+    }
+}
+
+bool expression::fail(const std::string& message) {
+    if (error.empty()) {
+        error = message;
+    }
+    return false;
+}
+
+double expression::evaluate(double x, double y) const {
+    double f = 0.0;
+    evaluate(&x, &y, &f, 1);
+    return f;
+}
+
+void expression::evaluate(const double* x, const double* y, double* f, int count) const {
+    evaluate_batch(x, y, f, count, false);
+}
+
+void expression::evaluate_row(double x, const double* y, double* f, int count) const {
+    evaluate_batch(&x, y, f, count, true);
+}
+
+void expression::evaluate_dual(const double* x, const double* y, double* f, double* dfdx, double* dfdy, int count) const {
+    evaluate_dual_batch(x, y, f, dfdx, dfdy, count, false);
+}
+
+void expression::evaluate_dual_row(double x, const double* y, double* f, double* dfdx, double* dfdy, int count) const {
+    evaluate_dual_batch(&x, y, f, dfdx, dfdy, count, true);
+}
+
+void expression::evaluate_complex(const double* x, const double* y, double* re, double* im, int count) const {
+    evaluate_complex_batch(x, y, re, im, count, false);
+}
+
+void expression::evaluate_complex_row(double x, const double* y, double* re, double* im, int count) const {
+    evaluate_complex_batch(&x, y, re, im, count, true);
+}
+
+void expression::evaluate_batch(const double* x, const double* y, double* f, int count, bool row) const {
+    if (nodes.empty()) {
+        std::fill(f, f + count, 0.0);
+        return;
+    }
+
+    thread_local std::vector<double> registers;
+    registers.resize(nodes.size() * BATCH);
+
+    for (int first = 0; first < count; first += BATCH) {
+        int batch_lanes = std::min(BATCH, count - first);
+
+        // along a row x is fixed, so the x-only prefix of the tape runs once in one lane and is broadcast
+        for (size_t n = (row && first > 0) ? invariant : 0; n < nodes.size(); ++n) {
+            const node& op = nodes[n];
+            bool hoisted = row && (int)n < invariant;
+            int lanes = hoisted ? 1 : batch_lanes;
+            double* r = &registers[n * BATCH];
+            const double* a = op.a >= 0 ? &registers[op.a * BATCH] : nullptr;
+            const double* b = op.b >= 0 ? &registers[op.b * BATCH] : nullptr;
+
+            switch (op.op) {
+                case CONSTANT:   for (int l = 0; l < lanes; ++l) { r[l] = op.value; } break;
+                case VARIABLE_X: for (int l = 0; l < lanes; ++l) { r[l] = x[row ? 0 : first + l]; } break;
+                case VARIABLE_Y: for (int l = 0; l < lanes; ++l) { r[l] = y[first + l]; } break;
+                case ADD:  for (int l = 0; l < lanes; ++l) { r[l] = a[l] + b[l]; } break;
+                case SUB:  for (int l = 0; l < lanes; ++l) { r[l] = a[l] - b[l]; } break;
+                case MUL:  for (int l = 0; l < lanes; ++l) { r[l] = a[l] * b[l]; } break;
+                case DIV:  for (int l = 0; l < lanes; ++l) { r[l] = a[l] / b[l]; } break;
+                case NEG:  for (int l = 0; l < lanes; ++l) { r[l] = -a[l]; } break;
+                case POW:  for (int l = 0; l < lanes; ++l) { r[l] = std::pow(a[l], b[l]); } break;
+                case MIN:  for (int l = 0; l < lanes; ++l) { r[l] = std::min(a[l], b[l]); } break;
+                case MAX:  for (int l = 0; l < lanes; ++l) { r[l] = std::max(a[l], b[l]); } break;
+                case MOD:  for (int l = 0; l < lanes; ++l) { r[l] = a[l] - b[l] * std::floor(a[l] / b[l]); } break;
+                case SIN:  for (int l = 0; l < lanes; ++l) { r[l] = std::sin(a[l]); } break;
+                case COS:  for (int l = 0; l < lanes; ++l) { r[l] = std::cos(a[l]); } break;
+                case TAN:  for (int l = 0; l < lanes; ++l) { r[l] = std::tan(a[l]); } break;
+                case ASIN: for (int l = 0; l < lanes; ++l) { r[l] = std::asin(a[l]); } break;
+                case ACOS: for (int l = 0; l < lanes; ++l) { r[l] = std::acos(a[l]); } break;
+                case ATAN: for (int l = 0; l < lanes; ++l) { r[l] = std::atan(a[l]); } break;
+                case SINH: for (int l = 0; l < lanes; ++l) { r[l] = std::sinh(a[l]); } break;
+                case COSH: for (int l = 0; l < lanes; ++l) { r[l] = std::cosh(a[l]); } break;
+                case TANH: for (int l = 0; l < lanes; ++l) { r[l] = std::tanh(a[l]); } break;
+                case EXP:  for (int l = 0; l < lanes; ++l) { r[l] = std::exp(a[l]); } break;
+                case LOG:  for (int l = 0; l < lanes; ++l) { r[l] = std::log(a[l]); } break;
+                case SQRT: for (int l = 0; l < lanes; ++l) { r[l] = std::sqrt(a[l]); } break;
+                case ABS:  for (int l = 0; l < lanes; ++l) { r[l] = std::abs(a[l]); } break;
+                default: break;
+            }
+
+            if (hoisted) {
+                std::fill(r + 1, r + BATCH, r[0]);
+            }
+        }
+
+        std::memcpy(f + first, &registers[(nodes.size() - 1) * BATCH], batch_lanes * sizeof(double));
+    }
+}
+
+void expression::evaluate_dual_batch(const double* x, const double* y, double* f, double* dfdx, double* dfdy, int count, bool row) const {
+    if (nodes.empty()) {
+        std::fill(f, f + count, 0.0);
+        std::fill(dfdx, dfdx + count, 0.0);
+        std::fill(dfdy, dfdy + count, 0.0);
+        return;
+    }
+
+    // three banks per node: value, d/dx and d/dy, so each op updates all of them in one sweep over the lanes
+    thread_local std::vector<double> registers;
+    registers.resize(nodes.size() * BATCH * 3);
+
+    for (int first = 0; first < count; first += BATCH) {
+        int batch_lanes = std::min(BATCH, count - first);
+
+        for (size_t n = (row && first > 0) ? invariant : 0; n < nodes.size(); ++n) {
+            const node& op = nodes[n];
+            bool hoisted = row && (int)n < invariant;
+            int lanes = hoisted ? 1 : batch_lanes;
+            double* r = &registers[n * BATCH * 3];
+            double* rx = r + BATCH;
+            double* ry = r + 2 * BATCH;
+            const double* a = op.a >= 0 ? &registers[op.a * BATCH * 3] : nullptr;
+            const double* ax = a ? a + BATCH : nullptr;
+            const double* ay = a ? a + 2 * BATCH : nullptr;
+            const double* b = op.b >= 0 ? &registers[op.b * BATCH * 3] : nullptr;
+            const double* bx = b ? b + BATCH : nullptr;
+            const double* by = b ? b + 2 * BATCH : nullptr;
+
+            // unary ops only differ in f(a) and f'(a), the chain rule is shared
+            auto chain = [&](auto value, auto derivative) {
+                for (int l = 0; l < lanes; ++l) {
+                    double d = derivative(a[l]);
+                    r[l] = value(a[l]);
+                    rx[l] = d * ax[l];
+                    ry[l] = d * ay[l];
+                }
+            };
+
+            switch (op.op) {
+                case CONSTANT:
+                    for (int l = 0; l < lanes; ++l) { r[l] = op.value; rx[l] = 0.0; ry[l] = 0.0; }
+                    break;
+                case VARIABLE_X:
+                    for (int l = 0; l < lanes; ++l) { r[l] = x[row ? 0 : first + l]; rx[l] = 1.0; ry[l] = 0.0; }
+                    break;
+                case VARIABLE_Y:
+                    for (int l = 0; l < lanes; ++l) { r[l] = y[first + l]; rx[l] = 0.0; ry[l] = 1.0; }
+                    break;
+                case ADD:
+                    for (int l = 0; l < lanes; ++l) { r[l] = a[l] + b[l]; rx[l] = ax[l] + bx[l]; ry[l] = ay[l] + by[l]; }
+                    break;
+                case SUB:
+                    for (int l = 0; l < lanes; ++l) { r[l] = a[l] - b[l]; rx[l] = ax[l] - bx[l]; ry[l] = ay[l] - by[l]; }
+                    break;
+                case MUL:
+                    for (int l = 0; l < lanes; ++l) {
+                        r[l] = a[l] * b[l];
+                        rx[l] = a[l] * bx[l] + b[l] * ax[l];
+                        ry[l] = a[l] * by[l] + b[l] * ay[l];
+                    }
+                    break;
+                case DIV:
+                    for (int l = 0; l < lanes; ++l) {
+                        double inverse = 1.0 / b[l];
+                        r[l] = a[l] * inverse;
+                        rx[l] = (ax[l] - r[l] * bx[l]) * inverse;
+                        ry[l] = (ay[l] - r[l] * by[l]) * inverse;
+                    }
+                    break;
+                case NEG:
+                    for (int l = 0; l < lanes; ++l) { r[l] = -a[l]; rx[l] = -ax[l]; ry[l] = -ay[l]; }
+                    break;
+                case POW:
+                    if (nodes[op.b].op == CONSTANT) {
+                        double exponent = nodes[op.b].value;
+                        chain(
+                            [=](double v) { return std::pow(v, exponent); },
+                            [=](double v) { return exponent * std::pow(v, exponent - 1.0); }
+                        );
+                    } else {
+                        for (int l = 0; l < lanes; ++l) {
+                            r[l] = std::pow(a[l], b[l]);
+                            double log_a = std::log(a[l]);
+                            rx[l] = r[l] * (bx[l] * log_a + b[l] * ax[l] / a[l]);
+                            ry[l] = r[l] * (by[l] * log_a + b[l] * ay[l] / a[l]);
+                        }
+                    }
+                    break;
+                case MIN:
+                case MAX:
+                    for (int l = 0; l < lanes; ++l) {
+                        bool pick_a = (op.op == MIN) == (a[l] <= b[l]);
+                        r[l] = pick_a ? a[l] : b[l];
+                        rx[l] = pick_a ? ax[l] : bx[l];
+                        ry[l] = pick_a ? ay[l] : by[l];
+                    }
+                    break;
+                case MOD:
+                    for (int l = 0; l < lanes; ++l) {
+                        double q = std::floor(a[l] / b[l]);
+                        r[l] = a[l] - b[l] * q;
+                        rx[l] = ax[l] - bx[l] * q;
+                        ry[l] = ay[l] - by[l] * q;
+                    }
+                    break;
+                case SIN:  chain([](double v) { return std::sin(v); }, [](double v) { return std::cos(v); }); break;
+                case COS:  chain([](double v) { return std::cos(v); }, [](double v) { return -std::sin(v); }); break;
+                case TAN:  chain([](double v) { return std::tan(v); }, [](double v) { double t = std::tan(v); return 1.0 + t * t; }); break;
+                case ASIN: chain([](double v) { return std::asin(v); }, [](double v) { return 1.0 / std::sqrt(1.0 - v * v); }); break;
+                case ACOS: chain([](double v) { return std::acos(v); }, [](double v) { return -1.0 / std::sqrt(1.0 - v * v); }); break;
+                case ATAN: chain([](double v) { return std::atan(v); }, [](double v) { return 1.0 / (1.0 + v * v); }); break;
+                case SINH: chain([](double v) { return std::sinh(v); }, [](double v) { return std::cosh(v); }); break;
+                case COSH: chain([](double v) { return std::cosh(v); }, [](double v) { return std::sinh(v); }); break;
+                case TANH: chain([](double v) { return std::tanh(v); }, [](double v) { double t = std::tanh(v); return 1.0 - t * t; }); break;
+                case LOG:  chain([](double v) { return std::log(v); }, [](double v) { return 1.0 / v; }); break;
+                case ABS:  chain([](double v) { return std::abs(v); }, [](double v) { return v < 0.0 ? -1.0 : 1.0; }); break;
+                case EXP:
+                    for (int l = 0; l < lanes; ++l) {
+                        r[l] = std::exp(a[l]);
+                        rx[l] = r[l] * ax[l];
+                        ry[l] = r[l] * ay[l];
+                    }
+                    break;
+                case SQRT:
+                    for (int l = 0; l < lanes; ++l) {
+                        r[l] = std::sqrt(a[l]);
+                        rx[l] = ax[l] / (2.0 * r[l]);
+                        ry[l] = ay[l] / (2.0 * r[l]);
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            if (hoisted) {
+                std::fill(r + 1, r + BATCH, r[0]);
+                std::fill(rx + 1, rx + BATCH, rx[0]);
+                std::fill(ry + 1, ry + BATCH, ry[0]);
+            }
+        }
+
+        const double* root = &registers[(nodes.size() - 1) * BATCH * 3];
+        std::memcpy(f + first, root, batch_lanes * sizeof(double));
+        std::memcpy(dfdx + first, root + BATCH, batch_lanes * sizeof(double));
+        std::memcpy(dfdy + first, root + 2 * BATCH, batch_lanes * sizeof(double));
+    }
+}
+
+void expression::evaluate_complex_batch(const double* x, const double* y, double* re, double* im, int count, bool row) const {
+    if (nodes.empty()) {
+        std::fill(re, re + count, 0.0);
+        std::fill(im, im + count, 0.0);
+        return;
+    }
+
+    // two banks per node, real and imaginary parts, so the arithmetic ops stay plain loops over the lanes
+    thread_local std::vector<double> registers;
+    registers.resize(nodes.size() * BATCH * 2);
+    std::array<double, BATCH> sine{};
+    std::array<double, BATCH> cosine{};
+    std::array<double, BATCH> sinh{};
+    std::array<double, BATCH> cosh{};
+
+    for (int first = 0; first < count; first += BATCH) {
+        int batch_lanes = std::min(BATCH, count - first);
+
+        for (size_t n = (row && first > 0) ? invariant : 0; n < nodes.size(); ++n) {
+            const node& op = nodes[n];
+            bool hoisted = row && (int)n < invariant;
+            int lanes = hoisted ? 1 : batch_lanes;
+            double* r = &registers[n * BATCH * 2];
+            double* ri = r + BATCH;
+            const double* a = op.a >= 0 ? &registers[op.a * BATCH * 2] : nullptr;
+            const double* ai = a ? a + BATCH : nullptr;
+            const double* b = op.b >= 0 ? &registers[op.b * BATCH * 2] : nullptr;
+            const double* bi = b ? b + BATCH : nullptr;
+
+            // along a row z's real part is fixed, so a part that is the same in every lane has its sine, cosine or
+            // exponential taken once
+            auto uniform = [&](const double* v) {
+                for (int l = 1; l < lanes; ++l) {
+                    if (v[l] != v[0]) {
+                        return false;
+                    }
+                }
+                return true;
+            };
+            auto circular = [&](const double* v) {
+                if (uniform(v)) {
+                    std::fill(sine.begin(), sine.begin() + lanes, std::sin(v[0]));
+                    std::fill(cosine.begin(), cosine.begin() + lanes, std::cos(v[0]));
+                    return;
+                }
+                for (int l = 0; l < lanes; ++l) {
+                    sine[l] = std::sin(v[l]);
+                    cosine[l] = std::cos(v[l]);
+                }
+            };
+            auto hyperbolics = [&](const double* v) {
+                if (uniform(v)) {
+                    hyperbolic(v[0], sinh[0], cosh[0]);
+                    std::fill(sinh.begin() + 1, sinh.begin() + lanes, sinh[0]);
+                    std::fill(cosh.begin() + 1, cosh.begin() + lanes, cosh[0]);
+                    return;
+                }
+                for (int l = 0; l < lanes; ++l) {
+                    hyperbolic(v[l], sinh[l], cosh[l]);
+                }
+            };
+
+            switch (op.op) {
+                case CONSTANT:
+                    for (int l = 0; l < lanes; ++l) { r[l] = op.value; ri[l] = 0.0; }
+                    break;
+                case VARIABLE_X:
+                    for (int l = 0; l < lanes; ++l) { r[l] = x[row ? 0 : first + l]; ri[l] = 0.0; }
+                    break;
+                case VARIABLE_Y:
+                    for (int l = 0; l < lanes; ++l) { r[l] = y[first + l]; ri[l] = 0.0; }
+                    break;
+                case VARIABLE_Z:
+                    for (int l = 0; l < lanes; ++l) { r[l] = x[row ? 0 : first + l]; ri[l] = y[first + l]; }
+                    break;
+                case IMAGINARY:
+                    for (int l = 0; l < lanes; ++l) { r[l] = 0.0; ri[l] = 1.0; }
+                    break;
+                case ADD:
+                    for (int l = 0; l < lanes; ++l) { r[l] = a[l] + b[l]; ri[l] = ai[l] + bi[l]; }
+                    break;
+                case SUB:
+                    for (int l = 0; l < lanes; ++l) { r[l] = a[l] - b[l]; ri[l] = ai[l] - bi[l]; }
+                    break;
+                case MUL:
+                    for (int l = 0; l < lanes; ++l) {
+                        r[l] = a[l] * b[l] - ai[l] * bi[l];
+                        ri[l] = a[l] * bi[l] + ai[l] * b[l];
+                    }
+                    break;
+                case DIV:
+                    for (int l = 0; l < lanes; ++l) {
+                        // dividing anything but zero by zero lands on the point at infinity
+                        double norm = b[l] * b[l] + bi[l] * bi[l];
+                        bool pole = norm == 0.0 && (a[l] != 0.0 || ai[l] != 0.0);
+                        double inverse = 1.0 / norm;
+                        r[l] = pole ? INF : (a[l] * b[l] + ai[l] * bi[l]) * inverse;
+                        ri[l] = pole ? 0.0 : (ai[l] * b[l] - a[l] * bi[l]) * inverse;
+                    }
+                    break;
+                case NEG:
+                    for (int l = 0; l < lanes; ++l) { r[l] = -a[l]; ri[l] = -ai[l]; }
+                    break;
+                case POW:
+                    // exp(b log a), with 0^b taken as the limit along the real part of b
+                    for (int l = 0; l < lanes; ++l) {
+                        if (a[l] == 0.0 && ai[l] == 0.0) {
+                            r[l] = b[l] > 0.0 ? 0.0 : (b[l] == 0.0 && bi[l] == 0.0 ? 1.0 : INF);
+                            ri[l] = 0.0;
+                            continue;
+                        }
+                        double log_modulus = std::log(magnitude(a[l], ai[l]));
+                        double phase = angle(ai[l], a[l]);
+                        double modulus = std::exp(b[l] * log_modulus - bi[l] * phase);
+                        double argument = b[l] * phase + bi[l] * log_modulus;
+                        r[l] = modulus * std::cos(argument);
+                        ri[l] = modulus * std::sin(argument);
+                    }
+                    break;
+                case SIN:
+                    circular(a);
+                    hyperbolics(ai);
+                    for (int l = 0; l < lanes; ++l) { r[l] = scale(sine[l], cosh[l]); ri[l] = scale(cosine[l], sinh[l]); }
+                    break;
+                case COS:
+                    circular(a);
+                    hyperbolics(ai);
+                    for (int l = 0; l < lanes; ++l) { r[l] = scale(cosine[l], cosh[l]); ri[l] = -scale(sine[l], sinh[l]); }
+                    break;
+                case SINH:
+                    hyperbolics(a);
+                    circular(ai);
+                    for (int l = 0; l < lanes; ++l) { r[l] = scale(cosine[l], sinh[l]); ri[l] = scale(sine[l], cosh[l]); }
+                    break;
+                case COSH:
+                    hyperbolics(a);
+                    circular(ai);
+                    for (int l = 0; l < lanes; ++l) { r[l] = scale(cosine[l], cosh[l]); ri[l] = scale(sine[l], sinh[l]); }
+                    break;
+                case EXP:
+                    circular(ai);
+                    if (uniform(a)) {
+                        double modulus = std::exp(a[0]);
+                        for (int l = 0; l < lanes; ++l) { r[l] = scale(cosine[l], modulus); ri[l] = scale(sine[l], modulus); }
+                        break;
+                    }
+                    for (int l = 0; l < lanes; ++l) {
+                        double modulus = std::exp(a[l]);
+                        r[l] = scale(cosine[l], modulus);
+                        ri[l] = scale(sine[l], modulus);
+                    }
+                    break;
+                case LOG:
+                    for (int l = 0; l < lanes; ++l) {
+                        r[l] = std::log(magnitude(a[l], ai[l]));
+                        ri[l] = angle(ai[l], a[l]);
+                    }
+                    break;
+                case ABS:
+                    for (int l = 0; l < lanes; ++l) { r[l] = magnitude(a[l], ai[l]); ri[l] = 0.0; }
+                    break;
+                case TAN:
+                    for (int l = 0; l < lanes; ++l) { tangent(a[l], ai[l], r[l], ri[l]); }
+                    break;
+                case TANH:
+                    // tanh z = -i tan iz
+                    for (int l = 0; l < lanes; ++l) {
+                        tangent(-ai[l], a[l], ri[l], r[l]);
+                        ri[l] = -ri[l];
+                    }
+                    break;
+                case ASIN:
+                    for (int l = 0; l < lanes; ++l) {
+                        double root = 0.0;
+                        arcsine(a[l], ai[l], root, ri[l]);
+                        r[l] = angle(a[l], root);
+                    }
+                    break;
+                case ACOS:
+                    for (int l = 0; l < lanes; ++l) {
+                        double root = 0.0;
+                        arcsine(a[l], ai[l], root, ri[l]);
+                        r[l] = angle(root, a[l]);
+                        ri[l] = -ri[l];
+                    }
+                    break;
+                case ATAN:
+                    for (int l = 0; l < lanes; ++l) { arctangent(a[l], ai[l], r[l], ri[l]); }
+                    break;
+                case SQRT:
+                    for (int l = 0; l < lanes; ++l) { square_root(a[l], ai[l], r[l], ri[l]); }
+                    break;
+                default:
+                    break;
+            }
+
+            if (hoisted) {
+                std::fill(r + 1, r + BATCH, r[0]);
+                std::fill(ri + 1, ri + BATCH, ri[0]);
+            }
+        }
+
+        const double* root = &registers[(nodes.size() - 1) * BATCH * 2];
+        std::memcpy(re + first, root, batch_lanes * sizeof(double));
+        std::memcpy(im + first, root + BATCH, batch_lanes * sizeof(double));
+    }
+}
+
+interval expression::evaluate_interval(interval x, interval y) const {
+    if (nodes.empty()) {
+        return {0.0, 0.0};
+    }
+
+    thread_local std::vector<interval> registers;
+    registers.resize(nodes.size());
+
+    for (size_t n = 0; n < nodes.size(); ++n) {
+        const node& op = nodes[n];
+        interval a = op.a >= 0 ? registers[op.a] : interval{};
+        interval b = op.b >= 0 ? registers[op.b] : interval{};
+        interval r = WHOLE;
+
+        switch (op.op) {
+            case CONSTANT:   r = {op.value, op.value}; break;
+            case VARIABLE_X: r = x; break;
+            case VARIABLE_Y: r = y; break;
+            case ADD: r = {a.lo + b.lo, a.hi + b.hi}; break;
+            case SUB: r = {a.lo - b.hi, a.hi - b.lo}; break;
+            case MUL: r = op.a == op.b ? power(a, {2.0, 2.0}) : multiply(a, b); break;
+            case DIV:
+                if (b.lo > 0.0 || b.hi < 0.0) {
+                    r = multiply(a, {1.0 / b.hi, 1.0 / b.lo});
+                }
+                break;
+            case NEG: r = {-a.hi, -a.lo}; break;
+            case POW: r = power(a, b); break;
+            case MIN: r = {std::min(a.lo, b.lo), std::min(a.hi, b.hi)}; break;
+            case MAX: r = {std::max(a.lo, b.lo), std::max(a.hi, b.hi)}; break;
+            case MOD:
+                if (b.lo > 0.0) {
+                    r = {0.0, b.hi};
+                } else if (b.hi < 0.0) {
+                    r = {b.lo, 0.0};
+                }
+                break;
+            case SIN: r = sine(a); break;
+            case COS: r = sine({a.lo + PI / 2.0, a.hi + PI / 2.0}); break;
+            case TAN:
+                if (a.hi - a.lo < PI && !contains_phase(a, PI / 2.0, PI)) {
+                    r = {std::tan(a.lo), std::tan(a.hi)};
+                }
+                break;
+            case ASIN:
+                if (a.lo >= -1.0 && a.hi <= 1.0) {
+                    r = {std::asin(a.lo), std::asin(a.hi)};
+                }
+                break;
+            case ACOS:
+                if (a.lo >= -1.0 && a.hi <= 1.0) {
+                    r = {std::acos(a.hi), std::acos(a.lo)};
+                }
+                break;
+            case ATAN: r = {std::atan(a.lo), std::atan(a.hi)}; break;
+            case SINH: r = {std::sinh(a.lo), std::sinh(a.hi)}; break;
+            case COSH:
+                r = {std::cosh(a.lo > 0.0 ? a.lo : a.hi < 0.0 ? a.hi : 0.0), std::max(std::cosh(a.lo), std::cosh(a.hi))};
+                break;
+            case TANH: r = {std::tanh(a.lo), std::tanh(a.hi)}; break;
+            case EXP:  r = {std::exp(a.lo), std::exp(a.hi)}; break;
+            case LOG:
+                if (a.lo > 0.0) {
+                    r = {std::log(a.lo), std::log(a.hi)};
+                }
+                break;
+            case SQRT:
+                if (a.lo >= 0.0) {
+                    r = {std::sqrt(a.lo), std::sqrt(a.hi)};
+                }
+                break;
+            case ABS:
+                r = {a.lo > 0.0 ? a.lo : a.hi < 0.0 ? -a.hi : 0.0, std::max(std::abs(a.lo), std::abs(a.hi))};
+                break;
+            default: break;
+        }
+
+        // libm is only faithful to an ulp or so, so round every bound outward to stay conservative
+        if (std::isnan(r.lo) || std::isnan(r.hi)) {
+            r = WHOLE;
+        }
+        registers[n] = {std::nextafter(std::nextafter(r.lo, -INF), -INF), std::nextafter(std::nextafter(r.hi, INF), INF)};
+    }
+
+    return registers.back();
+}
+}
@@ -0,0 +1,274 @@
+#include <mine/flow.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#include <mine/parallel.hpp>
+
+namespace mine {
+namespace {
+constexpr int MAX_STEPS = 4096;
+constexpr int STAGES = 7;
+
+// Dormand-Prince 5(4): nodes, the stage matrix, the fifth order weights (also the last stage, so it is the
+// next step's first) and the difference to the embedded fourth order weights
+constexpr std::array<double, STAGES> C{{ 0.0, 1.0 / 5, 3.0 / 10, 4.0 / 5, 8.0 / 9, 1.0, 1.0 }};
+constexpr std::array<std::array<double, STAGES>, STAGES> A{{
+    { 0.0 },
+    { 1.0 / 5 },
+    { 3.0 / 40, 9.0 / 40 },
+    { 44.0 / 45, -56.0 / 15, 32.0 / 9 },
+    { 19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729 },
+    { 9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656 },
+    { 35.0 / 384, 0.0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84 }
+}};
+constexpr std::array<double, STAGES> ERROR{{
+    71.0 / 57600, 0.0, -71.0 / 16695, 71.0 / 1920, -17253.0 / 339200, 22.0 / 525, -1.0 / 40
+}};
+
+// the classic four stages as a tableau, so both methods share one lane loop
+constexpr std::array<std::array<double, 4>, 4> RK4_A{{
+    { 0.0 }, { 0.5 }, { 0.0, 0.5 }, { 0.0, 0.0, 1.0 }
+}};
+constexpr std::array<double, 4> RK4_C{{ 0.0, 0.5, 0.5, 1.0 }};
+
+constexpr std::array<float, 3> FIELD_COLOR{{ 0.35f, 0.35f, 0.45f }};
+constexpr std::array<float, 3> GRID_COLOR{{ 0.9f, 0.55f, 0.1f }};
+constexpr std::array<float, 3> SEED_COLOR{{ 1.0f, 1.0f, 1.0f }};
+
+struct lanes {
+    std::array<double, BATCH> x;
+    std::array<double, BATCH> y;
+    std::array<double, BATCH> h;
+    std::array<double, BATCH> direction;
+    std::array<int, BATCH> taken;
+    std::array<bool, BATCH> alive;
+};
+}
+
+flow::flow() :
+    field{}, grid{}, seeded{}, partials{},
+    method{RK45}, step{0.01}, tolerance{1e-6}, samples{24}, seeds{8}, steps{}, seed_steps{}
+{}
+
+void flow::trace(const expression& function, const std::array<int, 4>& bounds) {
+    field.clear();
+    grid.clear();
+    steps = 0;
+
+    double x0 = bounds[NEG_X_BOUND];
+    double y0 = bounds[NEG_Z_BOUND];
+    double width = bounds[POS_X_BOUND] - bounds[NEG_X_BOUND];
+    double depth = bounds[POS_Z_BOUND] - bounds[NEG_Z_BOUND];
+    if (function.empty() || width <= 0.0 || depth <= 0.0) {
+        return;
+    }
+
+    // one short segment along (1, f) through each cell center, scaled to fit inside the cell
+    int n = std::max(1, samples);
+    std::vector<double> y(n);
+    for (int j = 0; j < n; ++j) {
+        y[j] = y0 + (j + 0.5) * depth / n;
+    }
+    field.resize((size_t)n * n * 2);
+    double length = 0.35 * std::min(width, depth) / n;
+    parallel_for(0, n, [&](int first, int last, int) {
+        std::vector<double> slope(n);
+        for (int i = first; i < last; ++i) {
+            double x = x0 + (i + 0.5) * width / n;
+            function.evaluate_row(x, y.data(), slope.data(), n);
+            for (int j = 0; j < n; ++j) {
+                double norm = std::sqrt(1.0 + slope[j] * slope[j]);
+                double dx = std::isfinite(norm) ? length / norm : 0.0;
+                double dy = std::isfinite(norm) ? length * slope[j] / norm : 0.0;
+                vertex* segment = &field[((size_t)i * n + j) * 2];
+                segment[0] = {(float)(x - dx), 0.0f, (float)(y[j] - dy), pack_color(FIELD_COLOR[0], FIELD_COLOR[1], FIELD_COLOR[2]), 0};
+                segment[1] = {(float)(x + dx), 0.0f, (float)(y[j] + dy), pack_color(FIELD_COLOR[0], FIELD_COLOR[1], FIELD_COLOR[2]), 0};
+            }
+        }
+    });
+
+    std::vector<std::array<double, 2>> points{};
+    int m = std::max(1, seeds);
+    for (int i = 0; i < m; ++i) {
+        for (int j = 0; j < m; ++j) {
+            points.push_back({x0 + (i + 0.5) * width / m, y0 + (j + 0.5) * depth / m});
+        }
+    }
+    steps = integrate(function, bounds, points, GRID_COLOR, grid);
+}
+
+void flow::trace_seeds(const expression& function, const std::array<int, 4>& bounds, const std::vector<std::array<double, 2>>& points) {
+    seeded.clear();
+    seed_steps = function.empty() ? 0 : integrate(function, bounds, points, SEED_COLOR, seeded);
+}
+
+void flow::clear() {
+    field.clear();
+    grid.clear();
+    seeded.clear();
+    steps = 0;
+    seed_steps = 0;
+}
+
+void flow::lines(std::vector<vertex>& out) const {
+    out.insert(out.end(), field.begin(), field.end());
+    out.insert(out.end(), grid.begin(), grid.end());
+}
+
+void flow::seed_lines(std::vector<vertex>& out) const {
+    out.insert(out.end(), seeded.begin(), seeded.end());
+}
+
+long long flow::integrate(const expression& function, const std::array<int, 4>& bounds, const std::vector<std::array<double, 2>>& points, const std::array<float, 3>& color, std::vector<vertex>& out) {
+    double x0 = bounds[NEG_X_BOUND];
+    double x1 = bounds[POS_X_BOUND];
+    double y0 = bounds[NEG_Z_BOUND];
+    double y1 = bounds[POS_Z_BOUND];
+    double largest = std::max(step, 1e-6) * (x1 - x0);
+    double smallest = 1e-9 * (x1 - x0);
+
+    // every seed runs once forward and once backward in x
+    int total = (int)points.size() * 2;
+    int batches = (total + BATCH - 1) / BATCH;
+    partials.resize(thread_count());
+    for (std::vector<vertex>& partial : partials) {
+        partial.clear();
+    }
+    std::vector<long long> taken(thread_count(), 0);
+
+    parallel_for(0, batches, [&](int first, int last, int thread) {
+        lanes p{};
+        std::array<std::array<double, BATCH>, STAGES> k{};
+        std::array<double, BATCH> sx{};
+        std::array<double, BATCH> sy{};
+        std::array<double, BATCH> next{};
+        std::vector<vertex>& lines = partials[thread];
+
+        // k[s] = f at stage s of a tableau row a with node c, for every lane at once
+        auto stage = [&](int s, const double* a, double c, int count) {
+            for (int l = 0; l < count; ++l) {
+                double h = p.h[l] * p.direction[l];
+                double sum = 0.0;
+                for (int j = 0; j < s; ++j) {
+                    sum += a[j] * k[j][l];
+                }
+                sx[l] = p.x[l] + c * h;
+                sy[l] = p.y[l] + h * sum;
+            }
+            function.evaluate(sx.data(), sy.data(), k[s].data(), count);
+        };
+
+        auto emit = [&](double x, double y, double nx, double ny) {
+            lines.push_back({(float)x, 0.0f, (float)y, pack_color(color[0], color[1], color[2]), 0});
+            lines.push_back({(float)nx, 0.0f, (float)ny, pack_color(color[0], color[1], color[2]), 0});
+        };
+
+        for (int batch = first; batch < last; ++batch) {
+            int count = std::min(BATCH, total - batch * BATCH);
+            for (int l = 0; l < count; ++l) {
+                int lane = batch * BATCH + l;
+                p.x[l] = points[lane / 2][0];
+                p.y[l] = points[lane / 2][1];
+                p.direction[l] = lane % 2 ? -1.0 : 1.0;
+                p.h[l] = method == RK4 ? largest : largest / 16;
+                p.taken[l] = 0;
+                p.alive[l] = p.x[l] >= x0 && p.x[l] <= x1 && p.y[l] >= y0 && p.y[l] <= y1;
+            }
+            function.evaluate(p.x.data(), p.y.data(), k[0].data(), count);
+
+            bool any = true;
+            while (any) {
+                // the last step lands on the x bound instead of being cut off past it
+                for (int l = 0; l < count; ++l) {
+                    double remaining = p.direction[l] > 0.0 ? x1 - p.x[l] : p.x[l] - x0;
+                    p.alive[l] = p.alive[l] && remaining > smallest;
+                    p.h[l] = std::min(p.h[l], remaining);
+                }
+
+                if (method == RK4) {
+                    for (int s = 1; s < 4; ++s) {
+                        stage(s, RK4_A[s].data(), RK4_C[s], count);
+                    }
+                    for (int l = 0; l < count; ++l) {
+                        next[l] = p.y[l] + p.h[l] * p.direction[l] * (k[0][l] + 2.0 * k[1][l] + 2.0 * k[2][l] + k[3][l]) / 6.0;
+                        sx[l] = p.x[l] + p.h[l] * p.direction[l];
+                    }
+                } else {
+                    for (int s = 1; s < STAGES; ++s) {
+                        stage(s, A[s].data(), C[s], count);
+                    }
+                    // the last stage sits at the fifth order solution, so its point is the step's result
+                    for (int l = 0; l < count; ++l) {
+                        next[l] = sy[l];
+                    }
+                }
+
+                any = false;
+                for (int l = 0; l < count; ++l) {
+                    if (!p.alive[l]) {
+                        continue;
+                    }
+                    double x = p.x[l];
+                    double y = p.y[l];
+                    double nx = sx[l];
+                    double ny = next[l];
+                    bool accepted = true;
+
+                    if (method == RK45) {
+                        double error = 0.0;
+                        for (int s = 0; s < STAGES; ++s) {
+                            error += ERROR[s] * k[s][l];
+                        }
+                        error = std::abs(error * p.h[l]);
+                        double scale = tolerance * std::max(1.0, std::abs(ny));
+                        accepted = error <= scale || p.h[l] <= smallest;
+                        // the usual controller, kept from growing or shrinking more than fivefold at a time
+                        double factor = error > 0.0 ? 0.9 * std::pow(scale / error, 0.2) : 5.0;
+                        p.h[l] = std::max(smallest, std::min(largest, p.h[l] * std::max(0.2, std::min(5.0, factor))));
+                    }
+
+                    if (!std::isfinite(ny)) {
+                        p.alive[l] = false;
+                        continue;
+                    }
+                    if (accepted) {
+                        // a step that leaves the bounds is cut at the edge it crossed
+                        double t = 1.0;
+                        if (nx < x0) { t = std::min(t, (x0 - x) / (nx - x)); }
+                        if (nx > x1) { t = std::min(t, (x1 - x) / (nx - x)); }
+                        if (ny < y0) { t = std::min(t, (y0 - y) / (ny - y)); }
+                        if (ny > y1) { t = std::min(t, (y1 - y) / (ny - y)); }
+                        emit(x, y, x + t * (nx - x), y + t * (ny - y));
+                        p.x[l] = nx;
+                        p.y[l] = ny;
+                        p.taken[l]++;
+                        if (method == RK45) {
+                            k[0][l] = k[STAGES - 1][l];
+                        }
+                        p.alive[l] = t == 1.0 && p.taken[l] < MAX_STEPS;
+                    }
+                    any |= p.alive[l];
+                }
+
+                if (method == RK4 && any) {
+                    function.evaluate(p.x.data(), p.y.data(), k[0].data(), count);
+                }
+            }
+
+            for (int l = 0; l < count; ++l) {
+                taken[thread] += p.taken[l];
+            }
+        }
+    });
+
+    for (const std::vector<vertex>& partial : partials) {
+        out.insert(out.end(), partial.begin(), partial.end());
+    }
+    long long total_steps = 0;
+    for (long long t : taken) {
+        total_steps += t;
+    }
+    return total_steps;
+}
+}
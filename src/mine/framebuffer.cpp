@@ -0,0 +1,190 @@
+#include <mine/framebuffer.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace mine {
+framebuffer::framebuffer() :
+    multisample_fbo{}, color_buffer{}, depth_buffer{}, resolve_fbo{}, resolve_buffer{},
+    pixel_buffers{}, fences{}, width{}, height{}, samples{}, issued{}, collected{}
+{}
+
+bool framebuffer::set_size(int width, int height, int samples) {
+    GLint max_size = 0;
+    GLint max_samples = 0;
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &max_size);
+    glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+    if (width < 1 || height < 1 || width > max_size || height > max_size) {
+        std::cerr << "Error: " << width << "x" << height << " is outside the supported render size of " << max_size << std::endl;
+        return false;
+    }
+
+    destroy();
+    this->width = width;
+    this->height = height;
+    this->samples = std::max(1, std::min(samples, (int)max_samples));
+
+    glGenFramebuffers(1, &resolve_fbo);
+    glGenRenderbuffers(1, &resolve_buffer);
+    glGenRenderbuffers(1, &depth_buffer);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, resolve_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindFramebuffer(GL_FRAMEBUFFER, resolve_fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolve_buffer);
+
+    // the depth buffer belongs to whichever FBO is drawn into
+    if (this->samples > 1) {
+        glGenFramebuffers(1, &multisample_fbo);
+        glGenRenderbuffers(1, &color_buffer);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, color_buffer);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, this->samples, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, this->samples, GL_DEPTH_COMPONENT24, width, height);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, multisample_fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+    } else {
+        glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+    }
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Error: Offscreen framebuffer is incomplete (0x" << std::hex << status << std::dec << ")" << std::endl;
+        destroy();
+        return false;
+    }
+
+    return true;
+}
+
+void framebuffer::destroy() {
+    for (GLsync& fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    glDeleteBuffers(2, pixel_buffers.data());
+    glDeleteFramebuffers(1, &multisample_fbo);
+    glDeleteFramebuffers(1, &resolve_fbo);
+    glDeleteRenderbuffers(1, &color_buffer);
+    glDeleteRenderbuffers(1, &depth_buffer);
+    glDeleteRenderbuffers(1, &resolve_buffer);
+
+    multisample_fbo = 0;
+    color_buffer = 0;
+    depth_buffer = 0;
+    resolve_fbo = 0;
+    resolve_buffer = 0;
+    pixel_buffers = {};
+    issued = 0;
+    collected = 0;
+}
+
+void framebuffer::bind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, samples > 1 ? multisample_fbo : resolve_fbo);
+    glViewport(0, 0, width, height);
+}
+
+void framebuffer::unbind() const {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void framebuffer::present(int screen_width, int screen_height) const {
+    if (samples > 1) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, multisample_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolve_fbo);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+
+    // a multisampled source cannot be scaled by a blit, so the upsample always reads the resolved copy
+    bool native = width == screen_width && height == screen_height;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, resolve_fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, screen_width, screen_height, GL_COLOR_BUFFER_BIT, native ? GL_NEAREST : GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, screen_width, screen_height);
+}
+
+bool framebuffer::read() {
+    if (issued - collected >= (int)pixel_buffers.size()) {
+        return false;
+    }
+
+    if (samples > 1) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, multisample_fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolve_fbo);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+
+    // only targets that are read back pay for the pixel buffers
+    if (pixel_buffers[0] == 0) {
+        glGenBuffers(2, pixel_buffers.data());
+        for (GLuint pixel_buffer : pixel_buffers) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffer);
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, nullptr, GL_STREAM_READ);
+        }
+    }
+
+    // glReadPixels into a bound pack buffer returns immediately; the fence tells collect when the copy landed
+    int slot = issued % (int)pixel_buffers.size();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, resolve_fbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffers[slot]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, samples > 1 ? multisample_fbo : resolve_fbo);
+
+    issued++;
+    return true;
+}
+
+bool framebuffer::collect(std::vector<unsigned char>& pixels) {
+    if (collected == issued) {
+        return false;
+    }
+
+    int slot = collected % (int)pixel_buffers.size();
+    while (glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+    glDeleteSync(fences[slot]);
+    fences[slot] = nullptr;
+
+    size_t row = (size_t)width * 4;
+    pixels.resize(row * height);
+
+    // GL rows start at the bottom, image files at the top
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixel_buffers[slot]);
+    const unsigned char* mapped = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, row * height, GL_MAP_READ_BIT);
+    if (mapped) {
+        for (int y = 0; y < height; ++y) {
+            std::memcpy(&pixels[y * row], mapped + (height - 1 - y) * row, row);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    collected++;
+    return mapped != nullptr;
+}
+
+int framebuffer::get_width() const {
+    return width;
+}
+
+int framebuffer::get_height() const {
+    return height;
+}
+
+int framebuffer::get_samples() const {
+    return samples;
+}
+}
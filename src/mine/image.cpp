@@ -0,0 +1,145 @@
+#include <mine/image.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace mine {
+namespace {
+constexpr size_t STORED_BLOCK = 65535;
+
+// slicing-by-4 tables for the PNG chunk CRC
+std::array<std::array<uint32_t, 256>, 4> crc_tables() {
+    std::array<std::array<uint32_t, 256>, 4> tables{};
+    for (uint32_t n = 0; n < 256; ++n) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        tables[0][n] = c;
+    }
+    for (uint32_t n = 0; n < 256; ++n) {
+        for (int t = 1; t < 4; ++t) {
+            tables[t][n] = (tables[t - 1][n] >> 8) ^ tables[0][tables[t - 1][n] & 0xff];
+        }
+    }
+    return tables;
+}
+
+uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size) {
+    static const std::array<std::array<uint32_t, 256>, 4> tables = crc_tables();
+    crc = ~crc;
+    for (; size >= 4; size -= 4, data += 4) {
+        crc ^= (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+        crc = tables[3][crc & 0xff] ^ tables[2][(crc >> 8) & 0xff] ^ tables[1][(crc >> 16) & 0xff] ^ tables[0][crc >> 24];
+    }
+    for (; size > 0; --size, ++data) {
+        crc = tables[0][(crc ^ *data) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void put_u32(std::vector<unsigned char>& out, uint32_t value) {
+    out.push_back((unsigned char)(value >> 24));
+    out.push_back((unsigned char)(value >> 16));
+    out.push_back((unsigned char)(value >> 8));
+    out.push_back((unsigned char)value);
+}
+
+void put_chunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data) {
+    std::vector<unsigned char> header{};
+    put_u32(header, (uint32_t)data.size());
+    header.insert(header.end(), type, type + 4);
+
+    uint32_t crc = crc32(crc32(0, header.data() + 4, 4), data.data(), data.size());
+    std::vector<unsigned char> footer{};
+    put_u32(footer, crc);
+
+    file.write((const char*)header.data(), header.size());
+    file.write((const char*)data.data(), data.size());
+    file.write((const char*)footer.data(), footer.size());
+}
+}
+
+bool write_png(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels) {
+    size_t row = (size_t)width * 4;
+    if (width < 1 || height < 1 || pixels.size() < row * height) {
+        return false;
+    }
+
+    std::ofstream file(path.c_str(), std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    static const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    file.write((const char*)SIGNATURE, sizeof(SIGNATURE));
+
+    std::vector<unsigned char> header{};
+    put_u32(header, (uint32_t)width);
+    put_u32(header, (uint32_t)height);
+    header.insert(header.end(), { 8, 6, 0, 0, 0 });
+    put_chunk(file, "IHDR", header);
+
+    // every row is filter type 0 followed by its pixels, cut into stored deflate blocks inside a zlib stream
+    size_t raw_size = (row + 1) * height;
+    size_t blocks = (raw_size + STORED_BLOCK - 1) / STORED_BLOCK;
+    std::vector<unsigned char> data{};
+    data.reserve(2 + raw_size + 5 * blocks + 4);
+    data.push_back(0x78);
+    data.push_back(0x01);
+
+    uint32_t a = 1;
+    uint32_t b = 0;
+    size_t written = 0;
+    int y = 0;
+    size_t x = 0;
+    while (written < raw_size) {
+        size_t size = std::min(STORED_BLOCK, raw_size - written);
+        data.push_back(written + size == raw_size ? 1 : 0);
+        data.push_back((unsigned char)size);
+        data.push_back((unsigned char)(size >> 8));
+        data.push_back((unsigned char)~size);
+        data.push_back((unsigned char)(~size >> 8));
+
+        size_t left = size;
+        while (left > 0) {
+            // x == 0 is the filter byte in front of the row, 1..row are its pixels
+            size_t take = x == 0 ? 1 : std::min(left, row + 1 - x);
+            const unsigned char* source = x == 0 ? nullptr : &pixels[y * row + x - 1];
+            size_t start = data.size();
+            if (source) {
+                data.insert(data.end(), source, source + take);
+            } else {
+                data.push_back(0);
+            }
+
+            // Adler-32 with the modulo deferred as long as the sums cannot overflow
+            for (size_t k = start; k < data.size(); k += 5552) {
+                size_t end = std::min(data.size(), k + 5552);
+                for (size_t i = k; i < end; ++i) {
+                    a += data[i];
+                    b += a;
+                }
+                a %= 65521;
+                b %= 65521;
+            }
+
+            x += take;
+            if (x == row + 1) {
+                x = 0;
+                y++;
+            }
+            left -= take;
+        }
+        written += size;
+    }
+    put_u32(data, b << 16 | a);
+    put_chunk(file, "IDAT", data);
+    put_chunk(file, "IEND", {});
+
+    return file.good();
+}
+}
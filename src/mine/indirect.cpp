@@ -0,0 +1,96 @@
+#include <mine/indirect.hpp>
+
+#include <algorithm>
+
+namespace mine {
+namespace {
+// bindings shared with shaders/cull.glsl and shaders/vertex.glsl
+constexpr GLuint PARAMETER_BINDING = 4;
+constexpr GLuint SOURCE_BINDING = 5;
+constexpr GLuint COMMAND_BINDING = 6;
+}
+
+draw_list::draw_list() :
+    parameter_buffer{}, source_buffer{}, command_buffer{}, cull_program{}, view_location{-1}, count_location{-1},
+    capacity{}, count{}, commands{}, parameters{}
+{}
+
+void draw_list::create() {
+    glGenBuffers(1, &parameter_buffer);
+    glGenBuffers(1, &source_buffer);
+    glGenBuffers(1, &command_buffer);
+}
+
+void draw_list::destroy() {
+    glDeleteBuffers(1, &parameter_buffer);
+    glDeleteBuffers(1, &source_buffer);
+    glDeleteBuffers(1, &command_buffer);
+    parameter_buffer = 0;
+    source_buffer = 0;
+    command_buffer = 0;
+    set_program(0);
+    capacity = 0;
+    count = 0;
+}
+
+void draw_list::upload() {
+    count = (int)std::min(commands.size(), parameters.size());
+    if (count == 0) {
+        return;
+    }
+
+    // the buffers only grow, so adding a function is a sub-data update unless it outgrows them
+    if (count > capacity) {
+        capacity = std::max(count, 2 * capacity);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, parameter_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(draw_parameters), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, source_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(draw_command), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, command_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(draw_command), nullptr, GL_DYNAMIC_COPY);
+    }
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, parameter_buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(draw_parameters), parameters.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, source_buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(draw_command), commands.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, command_buffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, count * sizeof(draw_command), commands.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void draw_list::set_program(GLuint program) {
+    cull_program = program;
+    view_location = program ? glGetUniformLocation(program, "u_view_matrix") : -1;
+    count_location = program ? glGetUniformLocation(program, "u_count") : -1;
+}
+
+void draw_list::cull(const float* view) const {
+    if (cull_program == 0 || count == 0) {
+        return;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARAMETER_BINDING, parameter_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SOURCE_BINDING, source_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COMMAND_BINDING, command_buffer);
+
+    glUseProgram(cull_program);
+    glUniformMatrix4fv(view_location, 1, GL_FALSE, view);
+    glUniform1i(count_location, count);
+    glDispatchCompute((count + 63) / 64, 1, 1);
+    // the commands are read by the indirect draw, not by another shader
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+    glUseProgram(0);
+}
+
+void draw_list::draw() const {
+    if (count == 0) {
+        return;
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARAMETER_BINDING, parameter_buffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, count, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+}
@@ -0,0 +1,100 @@
+#include <mine/mapping.hpp>
+
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mine {
+mapped_file::mapped_file() :
+    data{}, size{}
+#ifdef _WIN32
+    , file_handle{}, mapping_handle{}
+#endif
+{}
+
+mapped_file::~mapped_file() {
+    close();
+}
+
+bool mapped_file::open(const std::string& path, bool sequential) {
+    close();
+
+#ifdef _WIN32
+    (void)sequential;
+    file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER file_size{};
+    if (file_handle == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+        std::cerr << "Error: Failed to open " << path << std::endl;
+        file_handle = nullptr;
+        close();
+        return false;
+    }
+    size = (size_t)file_size.QuadPart;
+    mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    data = mapping_handle ? (const char*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    struct stat status{};
+    if (descriptor < 0 || fstat(descriptor, &status) != 0 || status.st_size == 0) {
+        std::cerr << "Error: Failed to open " << path << std::endl;
+        if (descriptor >= 0) {
+            ::close(descriptor);
+        }
+        return false;
+    }
+    size = (size_t)status.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    // the mapping holds its own reference to the file
+    ::close(descriptor);
+    data = mapping == MAP_FAILED ? nullptr : (const char*)mapping;
+    if (data && sequential) {
+        posix_madvise(mapping, size, POSIX_MADV_SEQUENTIAL);
+    }
+#endif
+    if (!data) {
+        std::cerr << "Error: Failed to map " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void mapped_file::close() {
+#ifdef _WIN32
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping_handle) {
+        CloseHandle(mapping_handle);
+    }
+    if (file_handle) {
+        CloseHandle(file_handle);
+    }
+    file_handle = nullptr;
+    mapping_handle = nullptr;
+#else
+    if (data) {
+        munmap((void*)data, size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+const char* mapped_file::get_data() const {
+    return data;
+}
+
+size_t mapped_file::get_size() const {
+    return size;
+}
+}
@@ -0,0 +1,98 @@
+#include <mine/normals.hpp>
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MINE_NORMALS_SSE
+#endif
+
+namespace mine {
+namespace {
+constexpr GLuint LIT = 1u << 30;
+
+void scalar_normal(vertex* grid, int rows, int columns, int i, int j) {
+    const vertex& up = grid[(i + 1 < rows ? i + 1 : i) * columns + j];
+    const vertex& down = grid[(i > 0 ? i - 1 : i) * columns + j];
+    const vertex& right = grid[i * columns + (j + 1 < columns ? j + 1 : j)];
+    const vertex& left = grid[i * columns + (j > 0 ? j - 1 : j)];
+
+    float ux = up.x - down.x, uy = up.y - down.y, uz = up.z - down.z;
+    float vx = right.x - left.x, vy = right.y - left.y, vz = right.z - left.z;
+
+    grid[i * columns + j].normal = pack_normal(
+        vy * uz - vz * uy,
+        vz * ux - vx * uz,
+        vx * uy - vy * ux
+    );
+}
+}
+
+GLuint pack_normal(float x, float y, float z) {
+    float length = std::sqrt(x * x + y * y + z * z);
+    if (!(length > 1e-20f)) {
+        return 0;
+    }
+
+    int nx = (int)std::lround(x / length * 511.0f);
+    int ny = (int)std::lround(y / length * 511.0f);
+    int nz = (int)std::lround(z / length * 511.0f);
+
+    return ((GLuint)nx & 1023u) | (((GLuint)ny & 1023u) << 10) | (((GLuint)nz & 1023u) << 20) | LIT;
+}
+
+void compute_normals(vertex* grid, int rows, int columns) {
+    for (int i = 0; i < rows; ++i) {
+        int j = 0;
+
+#ifdef MINE_NORMALS_SSE
+        if (i > 0 && i + 1 < rows) {
+            scalar_normal(grid, rows, columns, i, 0);
+            j = 1;
+
+            // four interior columns per step, transposing the interleaved vertices into x/y/z lanes
+            const __m128 scale = _mm_set1_ps(511.0f);
+            const __m128 tiny = _mm_set1_ps(1e-20f);
+            const __m128i mask = _mm_set1_epi32(1023);
+            for (; j + 4 < columns; j += 4) {
+                const vertex* u = &grid[(i + 1) * columns + j];
+                const vertex* d = &grid[(i - 1) * columns + j];
+                const vertex* r = &grid[i * columns + j + 1];
+                const vertex* l = &grid[i * columns + j - 1];
+
+                __m128 ux = _mm_sub_ps(_mm_setr_ps(u[0].x, u[1].x, u[2].x, u[3].x), _mm_setr_ps(d[0].x, d[1].x, d[2].x, d[3].x));
+                __m128 uy = _mm_sub_ps(_mm_setr_ps(u[0].y, u[1].y, u[2].y, u[3].y), _mm_setr_ps(d[0].y, d[1].y, d[2].y, d[3].y));
+                __m128 uz = _mm_sub_ps(_mm_setr_ps(u[0].z, u[1].z, u[2].z, u[3].z), _mm_setr_ps(d[0].z, d[1].z, d[2].z, d[3].z));
+                __m128 vx = _mm_sub_ps(_mm_setr_ps(r[0].x, r[1].x, r[2].x, r[3].x), _mm_setr_ps(l[0].x, l[1].x, l[2].x, l[3].x));
+                __m128 vy = _mm_sub_ps(_mm_setr_ps(r[0].y, r[1].y, r[2].y, r[3].y), _mm_setr_ps(l[0].y, l[1].y, l[2].y, l[3].y));
+                __m128 vz = _mm_sub_ps(_mm_setr_ps(r[0].z, r[1].z, r[2].z, r[3].z), _mm_setr_ps(l[0].z, l[1].z, l[2].z, l[3].z));
+
+                __m128 nx = _mm_sub_ps(_mm_mul_ps(vy, uz), _mm_mul_ps(vz, uy));
+                __m128 ny = _mm_sub_ps(_mm_mul_ps(vz, ux), _mm_mul_ps(vx, uz));
+                __m128 nz = _mm_sub_ps(_mm_mul_ps(vx, uy), _mm_mul_ps(vy, ux));
+
+                __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+                __m128 valid = _mm_cmpgt_ps(length2, tiny);
+                __m128 inverse = _mm_and_ps(_mm_div_ps(scale, _mm_sqrt_ps(length2)), valid);
+
+                __m128i px = _mm_and_si128(_mm_cvtps_epi32(_mm_mul_ps(nx, inverse)), mask);
+                __m128i py = _mm_and_si128(_mm_cvtps_epi32(_mm_mul_ps(ny, inverse)), mask);
+                __m128i pz = _mm_and_si128(_mm_cvtps_epi32(_mm_mul_ps(nz, inverse)), mask);
+                __m128i packed = _mm_or_si128(px, _mm_or_si128(_mm_slli_epi32(py, 10), _mm_slli_epi32(pz, 20)));
+                packed = _mm_or_si128(packed, _mm_and_si128(_mm_castps_si128(valid), _mm_set1_epi32((int)LIT)));
+
+                alignas(16) GLuint out[4];
+                _mm_store_si128((__m128i*)out, packed);
+                for (int k = 0; k < 4; ++k) {
+                    grid[i * columns + j + k].normal = out[k];
+                }
+            }
+        }
+#endif
+
+        for (; j < columns; ++j) {
+            scalar_normal(grid, rows, columns, i, j);
+        }
+    }
+}
+}
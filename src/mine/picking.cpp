@@ -0,0 +1,233 @@
+#include <mine/picking.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include <mine/parallel.hpp>
+
+namespace mine {
+namespace {
+constexpr float INF = std::numeric_limits<float>::infinity();
+constexpr std::array<float, 6> EMPTY{{ INF, INF, INF, -INF, -INF, -INF }};
+
+void grow(std::array<float, 6>& box, const std::array<float, 6>& other) {
+    for (int a = 0; a < 3; ++a) {
+        box[a] = std::min(box[a], other[a]);
+        box[a + 3] = std::max(box[a + 3], other[a + 3]);
+    }
+}
+
+// entry distance of the ray into box, clipped to [0, limit]; fmin/fmax drop the NaN of 0 * inf on a box face
+bool slab(const std::array<float, 6>& box, const glm::vec3& origin, const glm::vec3& inverse, float limit, float& t) {
+    if (box[0] > box[3]) {
+        return false;
+    }
+    float front = 0.0f;
+    float back = limit;
+    for (int a = 0; a < 3; ++a) {
+        float t1 = (box[a] - origin[a]) * inverse[a];
+        float t2 = (box[a + 3] - origin[a]) * inverse[a];
+        front = std::fmax(front, std::fmin(t1, t2));
+        back = std::fmin(back, std::fmax(t1, t2));
+    }
+    t = front;
+    return front <= back;
+}
+
+// two-sided Moller-Trumbore
+bool triangle(const vertex& a, const vertex& b, const vertex& c, const glm::vec3& origin, const glm::vec3& direction, float& t) {
+    if (!std::isfinite(a.y) || !std::isfinite(b.y) || !std::isfinite(c.y)) {
+        return false;
+    }
+    glm::vec3 p0{a.x, a.y, a.z};
+    glm::vec3 e1 = glm::vec3(b.x, b.y, b.z) - p0;
+    glm::vec3 e2 = glm::vec3(c.x, c.y, c.z) - p0;
+    glm::vec3 p = glm::cross(direction, e2);
+    float det = glm::dot(e1, p);
+    if (std::abs(det) < 1e-12f) {
+        return false;
+    }
+    float inverse = 1.0f / det;
+    glm::vec3 s = origin - p0;
+    float u = glm::dot(s, p) * inverse;
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+    glm::vec3 q = glm::cross(s, e1);
+    float v = glm::dot(direction, q) * inverse;
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+    t = glm::dot(e2, q) * inverse;
+    return t > 0.0f;
+}
+}
+
+pyramid::pyramid() : levels{}, valid{}, rows{}, columns{} {}
+
+void pyramid::build(const vertex* grid, int rows, int columns, const std::vector<unsigned char>& valid) {
+    this->valid = valid;
+    if (rows == this->rows && columns == this->columns && !levels.empty()) {
+        refit(grid);
+        return;
+    }
+    this->rows = rows;
+    this->columns = columns;
+    levels.clear();
+    if (rows < 2 || columns < 2) {
+        return;
+    }
+
+    int block_rows = rows / 2;
+    int block_columns = columns / 2;
+    while (true) {
+        levels.push_back({block_rows, block_columns, std::vector<std::array<float, 6>>((size_t)block_rows * block_columns, EMPTY)});
+        if (block_rows == 1 && block_columns == 1) {
+            break;
+        }
+        block_rows = (block_rows + 1) / 2;
+        block_columns = (block_columns + 1) / 2;
+    }
+
+    refit(grid);
+}
+
+void pyramid::refit(const vertex* grid) {
+
+    auto kept = [&](int i, int j) { return valid.empty() || valid[(size_t)i * (columns - 1) + j]; };
+    level& base = levels[0];
+    parallel_for(0, base.rows, [&](int first_block, int last_block, int) {
+        for (int bi = first_block; bi < last_block; ++bi) {
+            for (int bj = 0; bj < base.columns; ++bj) {
+                std::array<float, 6> box = EMPTY;
+                auto add = [&](int i, int j) {
+                    const vertex& v = grid[i * columns + j];
+                    if (std::isfinite(v.y)) {
+                        grow(box, {{ v.x, v.y, v.z, v.x, v.y, v.z }});
+                    }
+                };
+                // a block with every cell kept is boxed by its vertices, one with flagged cells by its kept cells' corners
+                bool whole = true;
+                for (int ci = 2 * bi; ci < std::min(2 * bi + 2, rows - 1); ++ci) {
+                    for (int cj = 2 * bj; cj < std::min(2 * bj + 2, columns - 1); ++cj) {
+                        whole = whole && kept(ci, cj);
+                    }
+                }
+                if (whole) {
+                    for (int i = 2 * bi; i <= std::min(2 * bi + 2, rows - 1); ++i) {
+                        for (int j = 2 * bj; j <= std::min(2 * bj + 2, columns - 1); ++j) {
+                            add(i, j);
+                        }
+                    }
+                }
+                for (int ci = 2 * bi; ci < std::min(2 * bi + 2, rows - 1) && !whole; ++ci) {
+                    for (int cj = 2 * bj; cj < std::min(2 * bj + 2, columns - 1); ++cj) {
+                        if (kept(ci, cj)) {
+                            add(ci, cj);
+                            add(ci, cj + 1);
+                            add(ci + 1, cj);
+                            add(ci + 1, cj + 1);
+                        }
+                    }
+                }
+                base.boxes[bi * base.columns + bj] = box;
+            }
+        }
+    });
+
+    for (size_t l = 1; l < levels.size(); ++l) {
+        const level& child = levels[l - 1];
+        level& parent = levels[l];
+        for (int i = 0; i < parent.rows; ++i) {
+            for (int j = 0; j < parent.columns; ++j) {
+                std::array<float, 6> box = EMPTY;
+                for (int ci = 2 * i; ci < std::min(2 * i + 2, child.rows); ++ci) {
+                    for (int cj = 2 * j; cj < std::min(2 * j + 2, child.columns); ++cj) {
+                        grow(box, child.boxes[ci * child.columns + cj]);
+                    }
+                }
+                parent.boxes[i * parent.columns + j] = box;
+            }
+        }
+    }
+}
+
+std::array<float, 6> pyramid::get_box() const {
+    return levels.empty() ? EMPTY : levels.back().boxes[0];
+}
+
+bool pyramid::intersect(const vertex* grid, const glm::vec3& origin, const glm::vec3& direction, hit& out) const {
+    if (levels.empty()) {
+        return false;
+    }
+
+    struct entry {
+        int level;
+        int i;
+        int j;
+        float t;
+    };
+
+    glm::vec3 inverse{1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+    // every level pushes at most four children, so the stack never holds more than four per level
+    std::vector<entry> stack{};
+    stack.reserve(4 * levels.size());
+
+    float t = 0.0f;
+    if (slab(levels.back().boxes[0], origin, inverse, out.t, t)) {
+        stack.push_back({(int)levels.size() - 1, 0, 0, t});
+    }
+
+    bool found = false;
+    while (!stack.empty()) {
+        entry top = stack.back();
+        stack.pop_back();
+        if (top.t >= out.t) {
+            continue;
+        }
+
+        if (top.level == 0) {
+            for (int i = 2 * top.i; i < std::min(2 * top.i + 2, rows - 1); ++i) {
+                for (int j = 2 * top.j; j < std::min(2 * top.j + 2, columns - 1); ++j) {
+                    if (!valid.empty() && !valid[(size_t)i * (columns - 1) + j]) {
+                        continue;
+                    }
+                    const vertex& a = grid[i * columns + j];
+                    const vertex& b = grid[i * columns + j + 1];
+                    const vertex& c = grid[(i + 1) * columns + j + 1];
+                    const vertex& d = grid[(i + 1) * columns + j];
+                    for (int k = 0; k < 2; ++k) {
+                        if (triangle(k == 0 ? a : c, k == 0 ? b : d, k == 0 ? c : a, origin, direction, t) && t < out.t) {
+                            out.t = t;
+                            found = true;
+                        }
+                    }
+                }
+            }
+            continue;
+        }
+
+        // children go on the stack far to near so the nearest is popped first
+        const level& child = levels[top.level - 1];
+        std::array<entry, 4> children{};
+        int count = 0;
+        for (int ci = 2 * top.i; ci < std::min(2 * top.i + 2, child.rows); ++ci) {
+            for (int cj = 2 * top.j; cj < std::min(2 * top.j + 2, child.columns); ++cj) {
+                if (slab(child.boxes[ci * child.columns + cj], origin, inverse, out.t, t)) {
+                    children[count++] = {top.level - 1, ci, cj, t};
+                }
+            }
+        }
+        std::sort(children.begin(), children.begin() + count, [](const entry& a, const entry& b) { return a.t > b.t; });
+        stack.insert(stack.end(), children.begin(), children.begin() + count);
+    }
+
+    if (found) {
+        out.x = origin.x + out.t * direction.x;
+        out.y = origin.y + out.t * direction.y;
+        out.z = origin.z + out.t * direction.z;
+    }
+    return found;
+}
+}
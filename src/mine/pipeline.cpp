@@ -3,27 +3,47 @@
 #include <fstream>
 #include <vector>
 
+#include <mine/enums.hpp>
+#include <mine/expression.hpp>
+
 namespace mine {
 pipeline::pipeline() : program{} {}
 
-compute_pipeline::compute_pipeline() : pipeline(), functions{} {}
+compute_pipeline::compute_pipeline() : pipeline(), functions{}, kinds{} {}
 
-graphics_pipeline::graphics_pipeline() : pipeline(), view_matrix_location{} {}
+graphics_pipeline::graphics_pipeline() : pipeline(), view_matrix_location{}, camera_position_location{} {}
 
 GLuint pipeline::get_program() const {
     return program;
 }
 
 const char* compute_pipeline::get_function(int index) const {
-    return functions[index].c_str();
+    return (size_t)index < functions.size() ? functions[index].c_str() : "";
+}
+
+int compute_pipeline::get_kind(int index) const {
+    return (size_t)index < kinds.size() ? kinds[index] : HEIGHT;
+}
+
+void compute_pipeline::set_function(const std::string& function, int kind, int index) {
+    if ((size_t)index >= functions.size()) {
+        functions.resize(index + 1);
+        kinds.resize(index + 1, HEIGHT);
+    }
+    functions[index] = function;
+    kinds[index] = kind;
 }
 
 GLint graphics_pipeline::get_view_matrix_location() const {
     return view_matrix_location;
 }
 
-bool compute_pipeline::set_program(const std::string& compute_source_location, const std::string& function, int index) {
-    GLuint temp_program = create_program(load_shader(compute_source_location, function));
+GLint graphics_pipeline::get_camera_position_location() const {
+    return camera_position_location;
+}
+
+bool compute_pipeline::set_program(const std::string& compute_source_location) {
+    GLuint temp_program = create_program(load_shader(compute_source_location, "", HEIGHT));
 
     if (temp_program == program) {
         return false;
@@ -32,18 +52,37 @@ bool compute_pipeline::set_program(const std::string& compute_source_location, c
     glDeleteProgram(program);
 
     program = temp_program;
-    functions[index] = function;
 
     return true;
 }
 
-void graphics_pipeline::set_program(const std::string& vertex_source_location, const std::string& fragment_source_location, const std::string& view_matrix_name) {
+bool compute_pipeline::set_program(const std::string& compute_source_location, const std::string& function, int kind, int index) {
+    GLuint temp_program = create_program(load_shader(compute_source_location, function, kind));
+
+    if (temp_program == program) {
+        return false;
+    }
+
+    glDeleteProgram(program);
+
+    program = temp_program;
+    set_function(function, kind, index);
+
+    return true;
+}
+
+void graphics_pipeline::set_program(const std::string& vertex_source_location, const std::string& fragment_source_location, const std::string& view_matrix_name, const std::string& camera_position_name) {
     program = create_program(load_shader(vertex_source_location), load_shader(fragment_source_location));
     view_matrix_location = glGetUniformLocation(program, view_matrix_name.c_str());
     if (view_matrix_location < 0) {
         std::cout << "Error: " << view_matrix_name << " not found in GPU memory" << std::endl;
         exit(2);
     }
+    camera_position_location = glGetUniformLocation(program, camera_position_name.c_str());
+    if (camera_position_location < 0) {
+        std::cout << "Error: " << camera_position_name << " not found in GPU memory" << std::endl;
+        exit(2);
+    }
 }
 
 GLuint pipeline::compile_shader(GLuint type, const std::string& source) {
@@ -88,16 +127,36 @@ GLuint pipeline::compile_shader(GLuint type, const std::string& source) {
     return shader_object;
 }
 
-std::string compute_pipeline::load_shader(const std::string& source_location, const std::string& function) {
+std::string compute_pipeline::load_shader(const std::string& source_location, const std::string& function, int kind) {
     std::string source = "";
     std::string line = "";
 
+    // surfaces and curves are typed as "x; y; z", height fields as a single expression
+    std::vector<std::string> pieces{};
+    size_t begin = 0;
+    for (size_t end = kind == HEIGHT ? std::string::npos : function.find(';'); ; end = function.find(';', begin)) {
+        pieces.push_back(function.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+        if (end == std::string::npos) {
+            break;
+        }
+        begin = end + 1;
+    }
+
+    // every piece the CPU parser understands is spliced in optimized, anything else goes in verbatim
+    std::string statements = "";
+    std::string components = kind == HEIGHT ? "x, y" : "";
+    for (size_t k = 0; k < pieces.size() && !function.empty(); ++k) {
+        expression parsed{};
+        std::string piece = parsed.parse(pieces[k]) ? parsed.glsl("c" + std::to_string(k) + "_", statements) : pieces[k];
+        components += (components.empty() ? "" : ", ") + piece;
+    }
+
     std::ifstream file(source_location.c_str());
 
     if (file.is_open()) {
         while (std::getline(file, line)) {
-            if (line == "    float z = ") {
-                line += function + ';';
+            if (line == "    return ") {
+                line = statements + line + "vec3(" + components + ");";
             }
             source += line + '\n';
         }
@@ -2,105 +2,162 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <iostream>
+#include <numeric>
 
+#include <mine/compaction.hpp>
 #include <mine/enums.hpp>
 
 namespace mine {
 plot::plot() {
-    functions.resize(1);
+    visible.resize(1);
+    valid.resize(1);
+    clouds.resize(1);
+    bounds.push_back(INITIAL_BOUNDS[0]);
+    kinds.push_back(HEIGHT);
 }
 
-void plot::add_function() {
-    functions.resize(functions.size() + 1);
-    
-    size_t k = functions.size() - 1;
+size_t plot::function_count() const {
+    return kinds.size();
+}
 
-    float x_ref = (float)(bounds[k][POS_X_BOUND] - bounds[k][NEG_X_BOUND]) / X_RECTS;
-    float z_ref = (float)(bounds[k][POS_Z_BOUND] - bounds[k][NEG_Z_BOUND]) / Z_RECTS;
-    for (unsigned int i = 0, g = 0; i <= X_RECTS; ++i) {
-        for (unsigned int j = 0; j <= Z_RECTS; ++j, ++g) {
-            float x_offset = i * x_ref;
-            float z_offset = j * z_ref;
-            float x = bounds[k][NEG_X_BOUND] + x_offset;
-            float z = bounds[k][NEG_Z_BOUND] + z_offset;
-            float y = 0.0f;
-            vertices.push_back({x, y, z, 0.0f, 0.0f, 0.0f});
-            functions[k][g] = {x, y, z, 0.0f, 0.0f, 0.0f};
-        }
-    }
+void plot::add_function() {
+    size_t k = kinds.size();
+    visible.resize(k + 1);
+    valid.resize(k + 1);
+    clouds.resize(k + 1);
+    bounds.push_back(INITIAL_BOUNDS[k % INITIAL_BOUNDS.size()]);
+    parameters.push_back({(float)bounds[k][0], (float)bounds[k][1], (float)bounds[k][2], (float)bounds[k][3]});
+    kinds.push_back(HEIGHT);
 
-    for (size_t i = base_vertice_count + k * ((X_RECTS + 1) * (Z_RECTS + 1)); i < base_vertice_count + (k + 1) * ((X_RECTS + 1) * (Z_RECTS + 1)); ++i) {
-        if (vertices[i].z == (float)bounds[k][POS_Z_BOUND]) {
-            continue;
-        } else if (vertices[i].x == (float)bounds[k][POS_X_BOUND]) {
-            continue;
-        }
-        indices.push_back(i);
-        indices.push_back(i + 1);
-        indices.push_back(i + 2 + Z_RECTS);
-        indices.push_back(i + 2 + Z_RECTS);
-        indices.push_back(i + 1 + Z_RECTS);
-        indices.push_back(i);
-    }
+    vertices.resize(base_vertice_count + (k + 1) * FUNCTION_VERTICE_COUNT);
 
+    update_clouds();
+    update_indices();
     update_bounds(k, bounds[k]);
 }
 
 void plot::remove_function() {
-    functions.pop_back();
+    visible.pop_back();
+    valid.pop_back();
+    clouds.pop_back();
+    bounds.pop_back();
+    parameters.pop_back();
+    kinds.pop_back();
+
+    vertices.resize(base_vertice_count + kinds.size() * FUNCTION_VERTICE_COUNT);
+
+    update_clouds();
+    update_indices();
+}
+
+void plot::set_overlay(const std::vector<vertex>& lines) {
+    overlay = lines;
+
+    update_overlay();
+}
+
+void plot::set_trajectories(const std::vector<vertex>& lines) {
+    trajectories = lines;
+
+    update_spans();
+    vertices.resize(first_trajectory);
+    vertices.insert(vertices.end(), trajectories.begin(), trajectories.end());
+}
 
-    for (int i = 0; i < (X_RECTS + 1) * (Z_RECTS + 1); ++i) {
-        vertices.pop_back();
+void plot::set_visible(int i, const std::vector<unsigned char>& cells) {
+    if (visible[i].empty() && cells.empty()) {
+        return;
     }
+    visible[i] = cells;
+    stale = true;
+}
+
+void plot::set_valid(int i, const std::vector<unsigned char>& cells) {
+    if (valid[i].empty() && cells.empty()) {
+        return;
+    }
+    valid[i] = cells;
+    stale = true;
+}
 
-    for (int i = 0; i < 6 * (X_RECTS * Z_RECTS); ++i) {
-        indices.pop_back();
+void plot::set_cloud(int i, const std::vector<vertex>& points) {
+    if (clouds[i].empty() && points.empty()) {
+        return;
     }
+    clouds[i] = points;
+
+    update_clouds();
 }
 
 void plot::set_vertices() {
+    std::vector<vertex> base = base_vertices();
+    vertices.reserve(vertices.size() + base.size() + kinds.size() * FUNCTION_VERTICE_COUNT + overlay_size());
+    vertices.insert(vertices.end(), base.begin(), base.end());
+
+    // function
+    vertices.resize(base_vertice_count + kinds.size() * FUNCTION_VERTICE_COUNT);
+    for (size_t k = 0; k < kinds.size(); ++k) {
+        fill_grid(k);
+    }
+
+    // data points, then contours and other overlay lines, then the seeded trajectories
+    for (const std::vector<vertex>& cloud : clouds) {
+        vertices.insert(vertices.end(), cloud.begin(), cloud.end());
+    }
+    vertices.insert(vertices.end(), overlay.begin(), overlay.end());
+    vertices.insert(vertices.end(), trajectories.begin(), trajectories.end());
+
+    update_indices();
+}
+
+// the axes, the bounding box and the floor grid, base_vertice_count of them
+std::vector<vertex> plot::base_vertices() const {
+    std::vector<vertex> base{};
+    base.reserve(base_vertice_count);
+
     // x axis
-    vertices.push_back({(float)axes[NEG_X_AXIS], 0.0f, 0.0f, 0.2f, 0.1f, 0.1f});
-    vertices.push_back({(float)axes[POS_X_AXIS], 0.0f, 0.0f, 0.8f, 0.1f, 0.1f});
+    base.push_back({(float)axes[NEG_X_AXIS], 0.0f, 0.0f, pack_color(0.2f, 0.1f, 0.1f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], 0.0f, 0.0f, pack_color(0.8f, 0.1f, 0.1f), 0});
 
     // x axis-parallel bounds
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
 
     // z axis
-    vertices.push_back({0.0f, 0.0f, (float)axes[NEG_Z_AXIS], 0.1f, 0.2f, 0.1f});
-    vertices.push_back({0.0f, 0.0f, (float)axes[POS_Z_AXIS], 0.1f, 0.8f, 0.1f});
+    base.push_back({0.0f, 0.0f, (float)axes[NEG_Z_AXIS], pack_color(0.1f, 0.2f, 0.1f), 0});
+    base.push_back({0.0f, 0.0f, (float)axes[POS_Z_AXIS], pack_color(0.1f, 0.8f, 0.1f), 0});
 
     // z axis-parallel bounds
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
 
     // y axis
-    vertices.push_back({0.0f, (float)axes[NEG_Y_AXIS], 0.0f, 0.1f, 0.1f, 0.2f});
-    vertices.push_back({0.0f, (float)axes[POS_Y_AXIS], 0.0f, 0.1f, 0.1f, 0.8f});
+    base.push_back({0.0f, (float)axes[NEG_Y_AXIS], 0.0f, pack_color(0.1f, 0.1f, 0.2f), 0});
+    base.push_back({0.0f, (float)axes[POS_Y_AXIS], 0.0f, pack_color(0.1f, 0.1f, 0.8f), 0});
 
     // y axis-parallel bounds
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
-    vertices.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], 0.0f, 0.0f, 0.0f});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[NEG_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[POS_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[POS_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
+    base.push_back({(float)axes[POS_X_AXIS], (float)axes[NEG_Y_AXIS], (float)axes[NEG_Z_AXIS], pack_color(0.0f, 0.0f, 0.0f), 0});
 
     auto xColor = [=](int i) {
         return 0.2f + (0.6f) * (i - axes[NEG_X_AXIS]) / (axes[POS_X_AXIS] - axes[NEG_X_AXIS]);
@@ -109,8 +166,8 @@ void plot::set_vertices() {
     // x grid
     for (int i = axes[NEG_X_AXIS]; i <= axes[POS_X_AXIS]; ++i) {
         if (i == 0) { continue; }
-        vertices.push_back({(float)i, 0.0f, (float)axes[NEG_Z_AXIS], xColor(i), 0.1f, 0.1f});
-        vertices.push_back({(float)i, 0.0f, (float)axes[POS_Z_AXIS], xColor(i), 0.1f, 0.1f});
+        base.push_back({(float)i, 0.0f, (float)axes[NEG_Z_AXIS], pack_color(xColor(i), 0.1f, 0.1f), 0});
+        base.push_back({(float)i, 0.0f, (float)axes[POS_Z_AXIS], pack_color(xColor(i), 0.1f, 0.1f), 0});
     }
 
     auto zColor = [=](int i) {
@@ -120,49 +177,34 @@ void plot::set_vertices() {
     // z grid
     for (int i = axes[NEG_Z_AXIS]; i <= axes[POS_Z_AXIS]; ++i) {
         if (i == 0) { continue; }
-        vertices.push_back({(float)axes[NEG_X_AXIS], 0.0f, (float)i, 0.1f, zColor(i), 0.1f});
-        vertices.push_back({(float)axes[POS_X_AXIS], 0.0f, (float)i, 0.1f, zColor(i), 0.1f});
+        base.push_back({(float)axes[NEG_X_AXIS], 0.0f, (float)i, pack_color(0.1f, zColor(i), 0.1f), 0});
+        base.push_back({(float)axes[POS_X_AXIS], 0.0f, (float)i, pack_color(0.1f, zColor(i), 0.1f), 0});
     }
-    
-    // function
-    for (size_t k = 0; k < functions.size(); ++k) {
-        float x_ref = (float)(bounds[k][POS_X_BOUND] - bounds[k][NEG_X_BOUND]) / X_RECTS;
-        float z_ref = (float)(bounds[k][POS_Z_BOUND] - bounds[k][NEG_Z_BOUND]) / Z_RECTS;
-        for (unsigned int i = 0, g = 0; i <= X_RECTS; ++i) {
-            for (unsigned int j = 0; j <= Z_RECTS; ++j, ++g) {
-                float x_offset = i * x_ref;
-                float z_offset = j * z_ref;
-                float x = bounds[k][NEG_X_BOUND] + x_offset;
-                float z = bounds[k][NEG_Z_BOUND] + z_offset;
-                float y = 0.0f;
-                vertices.push_back({x, y, z, 0.0f, 0.0f, 0.0f});
-                functions[k][g] = {x, y, z, 0.0f, 0.0f, 0.0f};
-            }
-        }
+
+    return base;
+}
+
+void plot::refresh_indices() {
+    if (stale) {
+        update_indices();
     }
-    
+}
+
+void plot::update_indices() {
+    indices.clear();
+    stale = false;
+
     // grid and axes rectangles
     for (int i = 0; i < base_vertice_count; i += 2) {
         indices.push_back(i);
         indices.push_back(i + 1);
     }
 
-    // function triangles
-    for (size_t k = 0; k < functions.size(); ++k) {
-        for (size_t i = base_vertice_count + k * ((X_RECTS + 1) * (Z_RECTS + 1)); i < base_vertice_count + (k + 1) * ((X_RECTS + 1) * (Z_RECTS + 1)); ++i) {
-            if (vertices[i].z == (float)bounds[k][POS_Z_BOUND]) {
-                continue;
-            } else if (vertices[i].x == (float)bounds[k][POS_X_BOUND]) {
-                continue;
-            }
-            indices.push_back(i);
-            indices.push_back(i + 1);
-            indices.push_back(i + 2 + Z_RECTS);
-            indices.push_back(i + 2 + Z_RECTS);
-            indices.push_back(i + 1 + Z_RECTS);
-            indices.push_back(i);
-        }
-    }
+    line_count = base_vertice_count;
+    update_spans();
+
+    // function triangles, skipping cells the evaluator culled and cells flagged as not worth drawing
+    compact_cells(visible, valid, X_RECTS + 1, Z_RECTS + 1, base_vertice_count, indices, ranges);
 }
 
 void plot::update_vertices() {
@@ -172,6 +214,47 @@ void plot::update_vertices() {
     set_vertices();
 }
 
+// every cloud's points, the overlay lines and the trajectories, which follow the function grids in vertices
+size_t plot::overlay_size() const {
+    size_t count = overlay.size() + trajectories.size();
+    for (const std::vector<vertex>& cloud : clouds) {
+        count += cloud.size();
+    }
+    return count;
+}
+
+// points and overlay lines are drawn straight from the vertex buffer and need no indices
+void plot::update_spans() {
+    first_point = base_vertice_count + kinds.size() * FUNCTION_VERTICE_COUNT;
+    point_count = 0;
+    for (const std::vector<vertex>& cloud : clouds) {
+        point_count += (int)cloud.size();
+    }
+    first_overlay = first_point + point_count;
+    first_trajectory = first_overlay + (int)overlay.size();
+    overlay_count = (int)(overlay.size() + trajectories.size());
+}
+
+void plot::update_clouds() {
+    vertices.resize(base_vertice_count + kinds.size() * FUNCTION_VERTICE_COUNT);
+    vertices.reserve(vertices.size() + overlay_size());
+    for (const std::vector<vertex>& cloud : clouds) {
+        vertices.insert(vertices.end(), cloud.begin(), cloud.end());
+    }
+    vertices.insert(vertices.end(), overlay.begin(), overlay.end());
+    vertices.insert(vertices.end(), trajectories.begin(), trajectories.end());
+
+    update_spans();
+}
+
+// the overlay is last but for the trajectories, so replacing it leaves the grids and clouds where they are
+void plot::update_overlay() {
+    update_spans();
+    vertices.resize(first_overlay);
+    vertices.insert(vertices.end(), overlay.begin(), overlay.end());
+    vertices.insert(vertices.end(), trajectories.begin(), trajectories.end());
+}
+
 void plot::update_axes(std::array<int, 6>& axes) {
     if      (axes[NEG_X_AXIS] < -1000) { axes[NEG_X_AXIS] = -1000; }
     else if (axes[NEG_X_AXIS] >     0) { axes[NEG_X_AXIS] =     0; }
@@ -192,18 +275,84 @@ void plot::update_axes(std::array<int, 6>& axes) {
     this->axes[POS_Z_AXIS] = axes[POS_Z_AXIS];
     this->axes[NEG_Y_AXIS] = axes[NEG_Y_AXIS];
     this->axes[POS_Y_AXIS] = axes[POS_Y_AXIS];
+    int old_base = base_vertice_count;
     base_vertice_count = 30 + 2 * (this->axes[POS_X_AXIS] - this->axes[NEG_X_AXIS] + this->axes[POS_Z_AXIS] - this->axes[NEG_Z_AXIS]);
 
-    update_vertices();
-
-    for (size_t i = 0; i < functions.size(); ++i) {
-        update_bounds(i, bounds[i]);
+    for (size_t i = 0; i < kinds.size(); ++i) {
+        set_bounds(i, bounds[i]);
     }
+    if (vertices.size() < (size_t)old_base + kinds.size() * FUNCTION_VERTICE_COUNT) {
+        update_vertices();
+        return;
+    }
+
+    // the grids move along with the base instead of being laid out again, so each one keeps its last evaluation
+    // on screen until the next one replaces it
+    std::vector<vertex> base = base_vertices();
+    vertices.erase(vertices.begin(), vertices.begin() + old_base);
+    vertices.insert(vertices.begin(), base.begin(), base.end());
+
+    update_indices();
+}
+
+void plot::update_height_axis(int low, int high) {
+    axes[NEG_Y_AXIS] = std::min(0, std::max(-1000, low));
+    axes[POS_Y_AXIS] = std::max(0, std::min(1000, high));
 
-    update_vertices();
+    // the line count only depends on the x and z axes, so the evaluated grids after the base stay where they are
+    std::vector<vertex> base = base_vertices();
+    std::copy(base.begin(), base.end(), vertices.begin());
 }
 
 void plot::update_bounds(int i, std::array<int, 4>& bounds) {
+    set_bounds(i, bounds);
+    fill_grid(i);
+}
+
+bool plot::shift_bounds(int i, std::array<int, 4>& bounds, std::array<int, 2>& shift) {
+    std::array<int, 4> old = this->bounds[i];
+    set_bounds(i, bounds);
+    const std::array<int, 4>& now = this->bounds[i];
+
+    // the lattice only lines up when the spacing is unchanged and the move is a whole number of samples
+    int width = old[POS_X_BOUND] - old[NEG_X_BOUND];
+    int depth = old[POS_Z_BOUND] - old[NEG_Z_BOUND];
+    int dx = now[NEG_X_BOUND] - old[NEG_X_BOUND];
+    int dz = now[NEG_Z_BOUND] - old[NEG_Z_BOUND];
+    bool aligned = width > 0 && depth > 0 &&
+        now[POS_X_BOUND] - now[NEG_X_BOUND] == width && now[POS_Z_BOUND] - now[NEG_Z_BOUND] == depth &&
+        dx * X_RECTS % width == 0 && dz * Z_RECTS % depth == 0;
+    shift = aligned ? std::array<int, 2>{dx * X_RECTS / width, dz * Z_RECTS / depth} : std::array<int, 2>{0, 0};
+    if (!aligned || std::abs(shift[0]) > X_RECTS || std::abs(shift[1]) > Z_RECTS) {
+        shift = {0, 0};
+        return false;
+    }
+
+    // rows are walked in the direction of the move, so every row is read before it is overwritten
+    int columns = Z_RECTS + 1;
+    int kept = columns - std::abs(shift[1]);
+    vertex* grid = &vertices[base_vertice_count + i * FUNCTION_VERTICE_COUNT];
+    for (int n = 0; n <= X_RECTS - std::abs(shift[0]); ++n) {
+        int row = shift[0] >= 0 ? n : X_RECTS - n;
+        std::memmove(
+            grid + row * columns + std::max(0, -shift[1]),
+            grid + (row + shift[0]) * columns + std::max(0, shift[1]),
+            kept * sizeof(vertex)
+        );
+    }
+    return true;
+}
+
+std::array<int, 2> plot::pan_steps(int i) const {
+    int width = bounds[i][POS_X_BOUND] - bounds[i][NEG_X_BOUND];
+    int depth = bounds[i][POS_Z_BOUND] - bounds[i][NEG_Z_BOUND];
+    return {
+        width > 0 ? width / std::gcd(width, X_RECTS) : 0,
+        depth > 0 ? depth / std::gcd(depth, Z_RECTS) : 0
+    };
+}
+
+void plot::set_bounds(int i, std::array<int, 4>& bounds) {
     if (bounds[POS_X_BOUND] > axes[POS_X_AXIS]) {
         bounds[POS_X_BOUND] = axes[POS_X_AXIS];
     } else if (bounds[POS_X_BOUND] < axes[NEG_X_AXIS]) {
@@ -229,19 +378,21 @@ void plot::update_bounds(int i, std::array<int, 4>& bounds) {
         bounds[NEG_Z_BOUND] = this->bounds[i][POS_Z_BOUND];
     }
     this->bounds[i][NEG_Z_BOUND] = bounds[NEG_Z_BOUND];
+}
 
-    float x_ref = (float)(this->bounds[i][POS_X_BOUND] - this->bounds[i][NEG_X_BOUND]) / X_RECTS;
-    float z_ref = (float)(this->bounds[i][POS_Z_BOUND] - this->bounds[i][NEG_Z_BOUND]) / Z_RECTS;
-    for (unsigned int j = 0, g = 0; j <= X_RECTS; ++j) {
-        for (unsigned int k = 0; k <= Z_RECTS; ++k, ++g) {
-            float x_offset = j * x_ref;
-            float z_offset = k * z_ref;
-            float x = this->bounds[i][NEG_X_BOUND] + x_offset;
-            float z = this->bounds[i][NEG_Z_BOUND] + z_offset;
-            float y = 0.0f;
-            vertices[i * (X_RECTS + 1) * (Z_RECTS + 1) + base_vertice_count + g] = {x, y, z, 0.0f, 0.0f, 0.0f};
-            functions[i][g] = {x, y, z, 0.0f, 0.0f, 0.0f};
+void plot::fill_grid(size_t k) {
+    float x_ref = (float)(bounds[k][POS_X_BOUND] - bounds[k][NEG_X_BOUND]) / X_RECTS;
+    float z_ref = (float)(bounds[k][POS_Z_BOUND] - bounds[k][NEG_Z_BOUND]) / Z_RECTS;
+    vertex* grid = &vertices[base_vertice_count + k * FUNCTION_VERTICE_COUNT];
+    // one row at a time with nothing carried between columns, so the inner loop vectorizes
+    float x0 = (float)bounds[k][NEG_X_BOUND];
+    float z0 = (float)bounds[k][NEG_Z_BOUND];
+    for (int i = 0; i <= X_RECTS; ++i) {
+        float x = x0 + i * x_ref;
+        vertex* row = grid + i * (Z_RECTS + 1);
+        for (int j = 0; j <= Z_RECTS; ++j) {
+            row[j] = {x, 0.0f, z0 + j * z_ref, 0, 0};
         }
     }
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,274 @@
+#include <mine/points.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include <mine/evaluator.hpp>
+#include <mine/mapping.hpp>
+#include <mine/normals.hpp>
+#include <mine/parallel.hpp>
+
+namespace mine {
+namespace {
+constexpr std::array<double, 23> POWERS{{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+}};
+// below these a mantissa can take eight more digits, or one more, without overflowing a uint64
+constexpr uint64_t ROOM_FOR_EIGHT = 100000000000ull;
+constexpr uint64_t ROOM_FOR_ONE = 1000000000000000000ull;
+
+// SWAR: all eight bytes are ASCII digits when none has a high nibble other than 3 and none passes '9' after adding 6
+bool eight_digits(uint64_t v) {
+    return ((v & 0xF0F0F0F0F0F0F0F0ull) | (((v + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+// eight digits, first one in the lowest byte, combined pairwise in three multiplies
+uint32_t eight_value(uint64_t v) {
+    v -= 0x3030303030303030ull;
+    v = v * 10 + (v >> 8);
+    v = ((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32)) + ((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32))) >> 32;
+    return (uint32_t)v;
+}
+
+// digits at p into mantissa, eight at a time while they fit, counting those kept and those past uint64 precision;
+// leading zeros keep the mantissa at 0, so they never use up precision. returns how many digits were read
+int digits(const char*& p, const char* end, uint64_t& mantissa, int& kept, int& dropped) {
+    const char* start = p;
+    uint64_t v = 0;
+    while (end - p >= 8 && mantissa < ROOM_FOR_EIGHT && (std::memcpy(&v, p, 8), eight_digits(v))) {
+        mantissa = mantissa * 100000000ull + eight_value(v);
+        kept += 8;
+        p += 8;
+    }
+    for (; p < end && (unsigned)(*p - '0') < 10; ++p) {
+        if (mantissa < ROOM_FOR_ONE) {
+            mantissa = mantissa * 10 + (unsigned)(*p - '0');
+            kept++;
+        } else {
+            dropped++;
+        }
+    }
+    return (int)(p - start);
+}
+
+// [sign] digits [. digits] [e [sign] digits]; leaves p alone when there is no number at it
+bool parse_number(const char*& p, const char* end, double& out) {
+    const char* s = p;
+    bool negative = s < end && *s == '-';
+    if (s < end && (*s == '-' || *s == '+')) {
+        ++s;
+    }
+
+    uint64_t mantissa = 0;
+    int kept = 0;
+    int dropped = 0;
+    int count = digits(s, end, mantissa, kept, dropped);
+    int exponent = dropped;
+    if (s < end && *s == '.') {
+        ++s;
+        kept = 0;
+        count += digits(s, end, mantissa, kept, dropped);
+        exponent -= kept;
+    }
+    if (count == 0) {
+        return false;
+    }
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        const char* e = s + 1;
+        bool negative_exponent = e < end && *e == '-';
+        if (e < end && (*e == '-' || *e == '+')) {
+            ++e;
+        }
+        int value = 0;
+        const char* first = e;
+        for (; e < end && (unsigned)(*e - '0') < 10; ++e) {
+            value = std::min(value * 10 + (*e - '0'), 9999);
+        }
+        if (e > first) {
+            exponent += negative_exponent ? -value : value;
+            s = e;
+        }
+    }
+
+    // exact for mantissas up to 2^53 with small exponents, which covers ordinary measured data
+    double value = (double)mantissa;
+    if (exponent >= 0 && exponent < (int)POWERS.size()) {
+        value *= POWERS[exponent];
+    } else if (exponent < 0 && -exponent < (int)POWERS.size()) {
+        value /= POWERS[-exponent];
+    } else {
+        value *= std::pow(10.0, exponent);
+    }
+    out = negative ? -value : value;
+    p = s;
+    return true;
+}
+
+bool separator(char c) {
+    return c == ' ' || c == '\t' || c == ',' || c == ';' || c == '\r';
+}
+
+struct accumulator {
+    std::vector<double> sums;
+    std::vector<uint32_t> counts;
+    std::vector<vertex> sample;
+    size_t capacity;
+    size_t seen;
+    size_t binned;
+    uint64_t random;
+};
+}
+
+bool load_points(const std::string& path, const std::array<int, 4>& bounds, float index, vertex* grid, int rows, int columns, size_t sample_size, point_set& out) {
+    mapped_file file{};
+    if (!file.open(path, true)) {
+        return false;
+    }
+    const char* data = file.get_data();
+    size_t size = file.get_size();
+    bool binary = path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+
+    // chunks of whole points: text chunks start just after a newline, binary chunks on a triple
+    int threads = thread_count();
+    std::vector<size_t> starts(threads + 1, size);
+    starts[0] = 0;
+    for (int t = 1; t < threads; ++t) {
+        size_t start = size / threads * t;
+        if (binary) {
+            start -= start % (3 * sizeof(float));
+        } else {
+            const void* newline = std::memchr(data + start, '\n', size - start);
+            start = newline ? (const char*)newline - data + 1 : size;
+        }
+        starts[t] = std::max(start, starts[t - 1]);
+    }
+    if (binary) {
+        starts[threads] = size - size % (3 * sizeof(float));
+    }
+
+    double x0 = bounds[NEG_X_BOUND];
+    double z0 = bounds[NEG_Z_BOUND];
+    double x_step = (double)(bounds[POS_X_BOUND] - bounds[NEG_X_BOUND]) / (rows - 1);
+    double z_step = (double)(bounds[POS_Z_BOUND] - bounds[NEG_Z_BOUND]) / (columns - 1);
+
+    std::vector<accumulator> accumulators(threads);
+    parallel_for(0, threads, [&](int first, int last, int) {
+        for (int t = first; t < last; ++t) {
+            accumulator& a = accumulators[t];
+            a.sums.assign((size_t)rows * columns, 0.0);
+            a.counts.assign((size_t)rows * columns, 0);
+            a.capacity = sample_size / threads + (t == 0 ? sample_size % threads : 0);
+            a.sample.reserve(a.capacity);
+            a.random = 0x9E3779B97F4A7C15ull * (t + 1);
+
+            // file (x, y, z) is world (x, z, y), the same as a height field's domain and value
+            auto add = [&](double x, double y, double z) {
+                if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z)) {
+                    return;
+                }
+                a.seen++;
+
+                // reservoir sampling keeps every point seen so far equally likely to be in the sample
+                size_t slot = a.sample.size();
+                if (slot >= a.capacity) {
+                    a.random ^= a.random << 13;
+                    a.random ^= a.random >> 7;
+                    a.random ^= a.random << 17;
+                    slot = a.random % a.seen;
+                }
+                if (slot < a.capacity) {
+                    vertex point{(float)x, (float)z, (float)y, 0, 0};
+                    height_color(point.y, index, point, 0.5f);
+                    if (slot == a.sample.size()) {
+                        a.sample.push_back(point);
+                    } else {
+                        a.sample[slot] = point;
+                    }
+                }
+
+                double i = std::round((x - x0) / x_step);
+                double j = std::round((y - z0) / z_step);
+                if (i >= 0 && i < rows && j >= 0 && j < columns) {
+                    size_t g = (size_t)i * columns + (size_t)j;
+                    a.sums[g] += z;
+                    a.counts[g]++;
+                    a.binned++;
+                }
+            };
+
+            const char* p = data + starts[t];
+            const char* end = data + starts[t + 1];
+            if (binary) {
+                for (; p + 3 * sizeof(float) <= end; p += 3 * sizeof(float)) {
+                    std::array<float, 3> xyz{};
+                    std::memcpy(xyz.data(), p, sizeof(xyz));
+                    add(xyz[0], xyz[1], xyz[2]);
+                }
+                continue;
+            }
+
+            while (p < end) {
+                std::array<double, 3> xyz{};
+                int n = 0;
+                for (; n < 3; ++n) {
+                    while (p < end && separator(*p)) {
+                        ++p;
+                    }
+                    if (!parse_number(p, end, xyz[n])) {
+                        break;
+                    }
+                }
+                if (n == 3) {
+                    add(xyz[0], xyz[1], xyz[2]);
+                }
+                // whatever is left of the line, including anything that stopped the parse
+                const void* newline = std::memchr(p, '\n', end - p);
+                p = newline ? (const char*)newline + 1 : end;
+            }
+        }
+    });
+
+    out.count = 0;
+    out.binned = 0;
+    out.cloud.clear();
+    for (accumulator& a : accumulators) {
+        out.count += a.seen;
+        out.binned += a.binned;
+        out.cloud.insert(out.cloud.end(), a.sample.begin(), a.sample.end());
+    }
+
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < columns; ++j) {
+            size_t g = (size_t)i * columns + j;
+            double sum = 0.0;
+            uint32_t count = 0;
+            for (const accumulator& a : accumulators) {
+                sum += a.sums[g];
+                count += a.counts[g];
+            }
+            vertex& v = grid[g];
+            v.x = (float)(x0 + i * x_step);
+            v.z = (float)(z0 + j * z_step);
+            v.y = count > 0 ? (float)(sum / count) : std::numeric_limits<float>::quiet_NaN();
+            height_color(v.y, index, v);
+        }
+    }
+    compute_normals(grid, rows, columns);
+
+    int cells = columns - 1;
+    out.visible.assign((size_t)(rows - 1) * cells, 0);
+    for (int i = 0; i + 1 < rows; ++i) {
+        for (int j = 0; j < cells; ++j) {
+            const vertex* corner = &grid[i * columns + j];
+            out.visible[i * cells + j] = std::isfinite(corner[0].y) && std::isfinite(corner[1].y)
+                && std::isfinite(corner[columns].y) && std::isfinite(corner[columns + 1].y);
+        }
+    }
+    return true;
+}
+}
@@ -0,0 +1,297 @@
+#include <mine/quadrature.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <vector>
+
+#include <mine/enums.hpp>
+#include <mine/parallel.hpp>
+
+namespace mine {
+namespace {
+constexpr int MAX_ORDER = 32;
+constexpr double PI = 3.14159265358979323846;
+
+// the positive Kronrod nodes with their weights, and the Gauss weights of the odd ones, as in QUADPACK's qk15
+constexpr std::array<double, 8> KRONROD_NODES{{
+    0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+    0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+    0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+    0.207784955007898467600689403773245, 0.000000000000000000000000000000000
+}};
+constexpr std::array<double, 8> KRONROD_WEIGHTS{{
+    0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+    0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+    0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+    0.204432940075298892414161999234649, 0.209482141084727828012999174891714
+}};
+constexpr std::array<double, 4> GAUSS_WEIGHTS{{
+    0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+    0.381830050505118944950369775488975, 0.417959183673469387755102040816327
+}};
+constexpr int KRONROD_POINTS = 15;
+
+struct rule {
+    std::vector<double> nodes;
+    std::vector<double> weights;
+};
+
+// Legendre roots by Newton's method from the usual cosine guesses, on [-1, 1]
+rule legendre(int order) {
+    rule out{std::vector<double>(order), std::vector<double>(order)};
+    for (int i = 0; i < order; ++i) {
+        double x = std::cos(PI * (i + 0.75) / (order + 0.5));
+        double derivative = 1.0;
+        for (int iteration = 0; iteration < 100; ++iteration) {
+            double p0 = 1.0;
+            double p1 = x;
+            for (int k = 2; k <= order; ++k) {
+                double p2 = ((2 * k - 1) * x * p1 - (k - 1) * p0) / k;
+                p0 = p1;
+                p1 = p2;
+            }
+            derivative = order * (x * p1 - p0) / (x * x - 1.0);
+            double step = p1 / derivative;
+            x -= step;
+            if (std::abs(step) < 1e-16) {
+                break;
+            }
+        }
+        out.nodes[i] = x;
+        out.weights[i] = 2.0 / ((1.0 - x * x) * derivative * derivative);
+    }
+    return out;
+}
+
+struct region {
+    double x0;
+    double x1;
+    double y0;
+    double y1;
+    double value;
+    double error;
+
+    bool operator<(const region& other) const {
+        return error < other.error;
+    }
+};
+
+rule kronrod() {
+    rule out{std::vector<double>(KRONROD_POINTS), std::vector<double>(KRONROD_POINTS)};
+    for (int i = 0; i < 8; ++i) {
+        out.nodes[i] = -KRONROD_NODES[i];
+        out.nodes[KRONROD_POINTS - 1 - i] = KRONROD_NODES[i];
+        out.weights[i] = out.weights[KRONROD_POINTS - 1 - i] = KRONROD_WEIGHTS[i];
+    }
+    return out;
+}
+
+// the Gauss weight of Kronrod point i, which is zero on the points only Kronrod uses
+double gauss_weight(int i) {
+    int mirrored = std::min(i, KRONROD_POINTS - 1 - i);
+    return mirrored % 2 == 1 ? GAUSS_WEIGHTS[mirrored / 2] : 0.0;
+}
+
+// fills in a region's value and error from one 15 x 15 batch of evaluations
+void evaluate_region(const expression& function, const rule& k, region& r, std::vector<double>& x, std::vector<double>& y, std::vector<double>& f) {
+    double cx = (r.x0 + r.x1) / 2;
+    double hx = (r.x1 - r.x0) / 2;
+    double cy = (r.y0 + r.y1) / 2;
+    double hy = (r.y1 - r.y0) / 2;
+    for (int i = 0; i < KRONROD_POINTS; ++i) {
+        for (int j = 0; j < KRONROD_POINTS; ++j) {
+            x[i * KRONROD_POINTS + j] = cx + hx * k.nodes[i];
+            y[i * KRONROD_POINTS + j] = cy + hy * k.nodes[j];
+        }
+    }
+    function.evaluate(x.data(), y.data(), f.data(), KRONROD_POINTS * KRONROD_POINTS);
+
+    double kronrod_sum = 0.0;
+    double gauss_sum = 0.0;
+    for (int i = 0; i < KRONROD_POINTS; ++i) {
+        double kronrod_row = 0.0;
+        double gauss_row = 0.0;
+        for (int j = 0; j < KRONROD_POINTS; ++j) {
+            double value = f[i * KRONROD_POINTS + j];
+            kronrod_row += k.weights[j] * value;
+            gauss_row += gauss_weight(j) * value;
+        }
+        kronrod_sum += k.weights[i] * kronrod_row;
+        gauss_sum += gauss_weight(i) * gauss_row;
+    }
+
+    r.value = kronrod_sum * hx * hy;
+    r.error = std::abs(kronrod_sum - gauss_sum) * hx * hy;
+    if (!std::isfinite(r.value) || !std::isfinite(r.error)) {
+        r.error = std::numeric_limits<double>::infinity();
+    }
+}
+}
+
+integral integrate_simpson(const expression& function, const std::array<int, 4>& bounds, int panels) {
+    panels = std::max(4, (panels + 3) / 4 * 4);
+    double x0 = bounds[NEG_X_BOUND];
+    double y0 = bounds[NEG_Z_BOUND];
+    double hx = (bounds[POS_X_BOUND] - x0) / panels;
+    double hy = (bounds[POS_Z_BOUND] - y0) / panels;
+
+    // the fine rule's weights, and the coarse rule's on the even points (zero on the odd ones)
+    auto fine = [panels](int i) { return (i == 0 || i == panels) ? 1.0 : (i % 2 ? 4.0 : 2.0); };
+    auto coarse = [panels](int i) { return i % 2 ? 0.0 : (i == 0 || i == panels) ? 1.0 : (i % 4 ? 4.0 : 2.0); };
+
+    std::vector<double> y(panels + 1);
+    for (int j = 0; j <= panels; ++j) {
+        y[j] = y0 + j * hy;
+    }
+
+    std::vector<std::array<double, 2>> partial(thread_count(), {0.0, 0.0});
+    parallel_for(0, panels + 1, [&](int first, int last, int thread) {
+        std::vector<double> f(panels + 1);
+        for (int i = first; i < last; ++i) {
+            function.evaluate_row(x0 + i * hx, y.data(), f.data(), panels + 1);
+            double fine_row = 0.0;
+            double coarse_row = 0.0;
+            for (int j = 0; j <= panels; ++j) {
+                fine_row += fine(j) * f[j];
+                coarse_row += coarse(j) * f[j];
+            }
+            partial[thread][0] += fine(i) * fine_row;
+            partial[thread][1] += coarse(i) * coarse_row;
+        }
+    });
+
+    double fine_sum = 0.0;
+    double coarse_sum = 0.0;
+    for (const std::array<double, 2>& sums : partial) {
+        fine_sum += sums[0];
+        coarse_sum += sums[1];
+    }
+    double value = fine_sum * hx * hy / 9.0;
+    double coarse_value = coarse_sum * 4.0 * hx * hy / 9.0;
+    double error = std::abs(value - coarse_value) / 15.0;
+    return {value, error, (long long)(panels + 1) * (panels + 1), 1, std::isfinite(value)};
+}
+
+integral integrate_gauss(const expression& function, const std::array<int, 4>& bounds, int cells, int order) {
+    cells = std::max(1, cells);
+    order = std::max(2, std::min(MAX_ORDER, order));
+    double x0 = bounds[NEG_X_BOUND];
+    double y0 = bounds[NEG_Z_BOUND];
+    double hx = (double)(bounds[POS_X_BOUND] - x0) / cells;
+    double hy = (double)(bounds[POS_Z_BOUND] - y0) / cells;
+
+    std::array<rule, 2> rules{legendre(order), legendre(order - 1)};
+    std::array<std::vector<double>, 2> y{};
+    for (int r = 0; r < 2; ++r) {
+        for (int j = 0; j < cells; ++j) {
+            for (double node : rules[r].nodes) {
+                y[r].push_back(y0 + (j + 0.5 + 0.5 * node) * hy);
+            }
+        }
+    }
+
+    // one x per row, so a row of every cell along y is a single batch
+    std::vector<std::array<double, 2>> partial(thread_count(), {0.0, 0.0});
+    parallel_for(0, cells * (2 * order - 1), [&](int first, int last, int thread) {
+        std::vector<double> f(cells * order);
+        for (int row = first; row < last; ++row) {
+            int r = row < cells * order ? 0 : 1;
+            int local = r == 0 ? row : row - cells * order;
+            int size = (int)rules[r].nodes.size();
+            int cell = local / size;
+            int node = local % size;
+            function.evaluate_row(x0 + (cell + 0.5 + 0.5 * rules[r].nodes[node]) * hx, y[r].data(), f.data(), (int)y[r].size());
+            double sum = 0.0;
+            for (size_t j = 0; j < y[r].size(); ++j) {
+                sum += rules[r].weights[j % size] * f[j];
+            }
+            partial[thread][r] += rules[r].weights[node] * sum;
+        }
+    });
+
+    double value = 0.0;
+    double lower = 0.0;
+    for (const std::array<double, 2>& sums : partial) {
+        value += sums[0];
+        lower += sums[1];
+    }
+    value *= hx * hy / 4.0;
+    lower *= hx * hy / 4.0;
+    long long evaluations = (long long)cells * cells * (order * order + (order - 1) * (order - 1));
+    return {value, std::abs(value - lower), evaluations, cells * cells, std::isfinite(value)};
+}
+
+integral integrate_adaptive(const expression& function, const std::array<int, 4>& bounds, double tolerance, int max_regions) {
+    const rule k = kronrod();
+    const int threads = thread_count();
+    const int points = KRONROD_POINTS * KRONROD_POINTS;
+    std::vector<std::vector<double>> x(threads, std::vector<double>(points));
+    std::vector<std::vector<double>> y(threads, std::vector<double>(points));
+    std::vector<std::vector<double>> f(threads, std::vector<double>(points));
+
+    region whole{(double)bounds[NEG_X_BOUND], (double)bounds[POS_X_BOUND], (double)bounds[NEG_Z_BOUND], (double)bounds[POS_Z_BOUND], 0.0, 0.0};
+    evaluate_region(function, k, whole, x[0], y[0], f[0]);
+    long long evaluations = points;
+
+    // running totals over the queue; regions whose error is not finite are only counted, so one singular region
+    // cannot turn the sums into NaN and stop the loop early
+    double value = 0.0;
+    double error = 0.0;
+    int infinite = 0;
+    auto add = [&](const region& r, int sign) {
+        if (std::isinf(r.error)) {
+            infinite += sign;
+        } else {
+            value += sign * r.value;
+            error += sign * r.error;
+        }
+    };
+
+    std::priority_queue<region> queue{};
+    queue.push(whole);
+    add(whole, 1);
+
+    // enough regions per round to keep every thread busy, few enough that good regions are rarely split
+    std::vector<region> children{};
+    while ((infinite > 0 || error > std::max(tolerance, tolerance * std::abs(value))) && (int)queue.size() + 3 <= max_regions) {
+        children.clear();
+        while (!queue.empty() && (int)children.size() < 4 * threads && (int)(queue.size() + children.size()) + 3 <= max_regions) {
+            region r = queue.top();
+            queue.pop();
+            add(r, -1);
+            double xm = (r.x0 + r.x1) / 2;
+            double ym = (r.y0 + r.y1) / 2;
+            children.push_back({r.x0, xm, r.y0, ym, 0.0, 0.0});
+            children.push_back({xm, r.x1, r.y0, ym, 0.0, 0.0});
+            children.push_back({r.x0, xm, ym, r.y1, 0.0, 0.0});
+            children.push_back({xm, r.x1, ym, r.y1, 0.0, 0.0});
+        }
+
+        parallel_for(0, (int)children.size(), [&](int first, int last, int thread) {
+            for (int c = first; c < last; ++c) {
+                evaluate_region(function, k, children[c], x[thread], y[thread], f[thread]);
+            }
+        });
+        evaluations += (long long)children.size() * points;
+
+        for (const region& child : children) {
+            queue.push(child);
+            add(child, 1);
+        }
+    }
+
+    // exact totals over whatever is left in the queue
+    value = 0.0;
+    error = 0.0;
+    int regions = (int)queue.size();
+    while (!queue.empty()) {
+        value += queue.top().value;
+        error += queue.top().error;
+        queue.pop();
+    }
+    bool converged = std::isfinite(value) && error <= std::max(tolerance, tolerance * std::abs(value));
+    return {value, error, evaluations, regions, converged};
+}
+}
@@ -0,0 +1,110 @@
+#include <mine/quality.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace mine {
+namespace {
+constexpr float MIN_SCALE = 0.25f;
+// frames to ignore after a change, while the new target size works its way through the queries
+constexpr int SETTLE_FRAMES = 8;
+// frames comfortably under target before quality is raised again
+constexpr int CALM_FRAMES = 60;
+constexpr double HEADROOM = 0.7;
+}
+
+quality::quality() :
+    queries{}, issued{}, collected{}, timing{}, average{}, settle{}, calm{},
+    automatic{true}, target{16.6f}, scale{1.0f}, samples{8}, max_samples{8}
+{}
+
+void quality::create() {
+    glGenQueries((GLsizei)queries.size(), queries.data());
+
+    GLint limit = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &limit);
+    max_samples = std::max(1, std::min(max_samples, (int)limit));
+    samples = std::min(samples, max_samples);
+}
+
+void quality::destroy() {
+    glDeleteQueries((GLsizei)queries.size(), queries.data());
+    queries = {};
+}
+
+void quality::begin() {
+    // a query still in flight holds its slot, so that frame simply goes untimed
+    timing = queries[0] != 0 && issued - collected < (int)queries.size();
+    if (timing) {
+        glBeginQuery(GL_TIME_ELAPSED, queries[issued % queries.size()]);
+    }
+}
+
+void quality::end() {
+    if (timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+        issued++;
+        timing = false;
+    }
+}
+
+bool quality::update() {
+    bool changed = false;
+    while (collected < issued) {
+        GLuint query = queries[collected % queries.size()];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        collected++;
+        changed |= add_frame(elapsed / 1e6);
+    }
+    return changed;
+}
+
+bool quality::add_frame(double milliseconds) {
+    if (settle > 0) {
+        settle--;
+        return false;
+    }
+    average = average == 0.0 ? milliseconds : 0.9 * average + 0.1 * milliseconds;
+    if (!automatic) {
+        return false;
+    }
+
+    float old_scale = scale;
+    int old_samples = samples;
+
+    if (average > target) {
+        calm = 0;
+        if (samples > 1) {
+            samples /= 2;
+        } else {
+            // pixel cost goes with area, so the side shrinks by the square root of the overshoot
+            scale = std::max(MIN_SCALE, scale * std::max(0.5f, (float)std::sqrt(target / average)));
+        }
+    } else if (average < HEADROOM * target && ++calm >= CALM_FRAMES) {
+        calm = 0;
+        if (scale < 1.0f) {
+            scale = std::min(1.0f, scale * std::min(1.25f, (float)std::sqrt(HEADROOM * target / average)));
+        } else if (samples < max_samples) {
+            samples *= 2;
+        }
+    }
+
+    if (scale == old_scale && samples == old_samples) {
+        return false;
+    }
+    // the average so far timed the old setting; the first frame after settling starts it again
+    settle = SETTLE_FRAMES;
+    average = 0.0;
+    return true;
+}
+
+double quality::get_frame_time() const {
+    return average;
+}
+}
@@ -0,0 +1,209 @@
+#include <mine/recording.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace mine {
+namespace {
+constexpr char MAGIC[4] = {'M', 'R', 'E', 'C'};
+// 2 stored the parameter ranges of FUNCTION and PUSH; a version 1 recording takes them from the bounds
+constexpr uint32_t VERSION = 2;
+
+// fields go out in host byte order; recordings compare builds on one machine, not across them
+template <typename T>
+void put(std::vector<char>& out, T value) {
+    const char* bytes = (const char*)&value;
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void put_string(std::vector<char>& out, const std::string& text) {
+    uint16_t size = (uint16_t)std::min(text.size(), (size_t)UINT16_MAX);
+    put(out, size);
+    out.insert(out.end(), text.begin(), text.begin() + size);
+}
+
+struct reader {
+    const std::vector<char>& data;
+    size_t offset;
+    bool good;
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (offset + sizeof(T) > data.size()) {
+            good = false;
+            return value;
+        }
+        std::memcpy(&value, &data[offset], sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    std::string get_string() {
+        uint16_t size = get<uint16_t>();
+        if (!good || offset + size > data.size()) {
+            good = false;
+            return {};
+        }
+        std::string text(&data[offset], size);
+        offset += size;
+        return text;
+    }
+};
+
+// how many integers each kind stores; FUNCTION and PUSH carry one source, AXES one per function
+constexpr int INTEGER_COUNTS[] = { 0, 2, 0, 0, 6, 5, 0, 6, 0 };
+constexpr int VALUE_COUNTS[] = { 2, 0, 3, 2, 4, 4, 0, 0, 2 };
+constexpr int VERSION_1_VALUE_COUNTS[] = { 2, 0, 3, 2, 0, 0, 0, 0, 2 };
+}
+
+recording::recording() : records{}, cursor{}, frame{}, elapsed{}, start{}, active{} {}
+
+void recording::begin() {
+    records.clear();
+    cursor = 0;
+    frame = 0;
+    elapsed = 0;
+    start = std::chrono::steady_clock::now();
+    active = true;
+}
+
+void recording::add(record r) {
+    if (!active) {
+        return;
+    }
+    auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    r.frame = frame;
+    r.time = (uint32_t)std::min<long long>(microseconds, UINT32_MAX);
+    records.push_back(std::move(r));
+}
+
+void recording::next_frame() {
+    if (active) {
+        frame++;
+    }
+}
+
+bool recording::save(const std::string& path) const {
+    uint32_t duration = elapsed;
+    if (active) {
+        auto microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        duration = (uint32_t)std::min<long long>(microseconds, UINT32_MAX);
+    }
+
+    // edits made after the last drawn frame still need a frame of their own
+    uint32_t frames = records.empty() ? frame : std::max(frame, records.back().frame + 1);
+
+    std::vector<char> out{};
+    out.insert(out.end(), MAGIC, MAGIC + 4);
+    put(out, VERSION);
+    put(out, frames);
+    put(out, duration);
+    put(out, (uint32_t)records.size());
+
+    for (const record& r : records) {
+        put(out, r.frame);
+        put(out, r.time);
+        put(out, (uint8_t)r.kind);
+        for (int v = 0; v < VALUE_COUNTS[r.kind]; ++v) {
+            put(out, r.values[v]);
+        }
+        for (int n = 0; n < INTEGER_COUNTS[r.kind]; ++n) {
+            put(out, (int32_t)r.integers[n]);
+        }
+        if (r.kind == RECORD_FUNCTION || r.kind == RECORD_PUSH || r.kind == RECORD_AXES) {
+            put(out, (uint16_t)r.functions.size());
+            for (const std::string& function : r.functions) {
+                put_string(out, function);
+            }
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(out.data(), out.size());
+    if (!file) {
+        std::cerr << "Error: Failed to write recording " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool recording::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: Failed to open recording " << path << std::endl;
+        return false;
+    }
+    std::vector<char> data{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+
+    reader in{data, 4, data.size() >= 4 && std::memcmp(data.data(), MAGIC, 4) == 0};
+    uint32_t version = in.get<uint32_t>();
+    if (!in.good || version < 1 || version > VERSION) {
+        std::cerr << "Error: " << path << " is not a version 1 to " << VERSION << " recording" << std::endl;
+        return false;
+    }
+    const int* value_counts = version == 1 ? VERSION_1_VALUE_COUNTS : VALUE_COUNTS;
+    frame = in.get<uint32_t>();
+    elapsed = in.get<uint32_t>();
+    uint32_t count = in.get<uint32_t>();
+
+    records.clear();
+    for (uint32_t i = 0; i < count && in.good; ++i) {
+        record r{};
+        r.frame = in.get<uint32_t>();
+        r.time = in.get<uint32_t>();
+        r.kind = in.get<uint8_t>();
+        if (r.kind > RECORD_PAN || r.frame >= frame) {
+            in.good = false;
+            break;
+        }
+        for (int v = 0; v < value_counts[r.kind]; ++v) {
+            r.values[v] = in.get<float>();
+        }
+        for (int n = 0; n < INTEGER_COUNTS[r.kind]; ++n) {
+            r.integers[n] = in.get<int32_t>();
+        }
+        if (version == 1 && (r.kind == RECORD_FUNCTION || r.kind == RECORD_PUSH)) {
+            int first = r.kind == RECORD_FUNCTION ? 2 : 1;
+            for (int v = 0; v < 4; ++v) {
+                r.values[v] = (float)r.integers[first + v];
+            }
+        }
+        if (r.kind == RECORD_FUNCTION || r.kind == RECORD_PUSH || r.kind == RECORD_AXES) {
+            r.functions.resize(in.get<uint16_t>());
+            for (std::string& function : r.functions) {
+                function = in.get_string();
+            }
+        }
+        records.push_back(std::move(r));
+    }
+
+    if (!in.good) {
+        std::cerr << "Error: Recording " << path << " is truncated or corrupt" << std::endl;
+        records.clear();
+        return false;
+    }
+    cursor = 0;
+    active = false;
+    return true;
+}
+
+bool recording::next(uint32_t frame, record& out) {
+    if (cursor >= records.size() || records[cursor].frame > frame) {
+        return false;
+    }
+    out = records[cursor++];
+    return true;
+}
+
+uint32_t recording::get_frames() const {
+    return frame;
+}
+
+double recording::get_seconds() const {
+    return elapsed * 1e-6;
+}
+}
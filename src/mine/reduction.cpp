@@ -0,0 +1,89 @@
+#include <mine/reduction.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include <mine/parallel.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MINE_REDUCTION_SSE
+#endif
+
+namespace mine {
+namespace {
+// heights gathered out of the interleaved vertices per accumulate() call
+constexpr int GATHER = 256;
+// set bits of a four lane movemask
+constexpr int LANES_SET[16] = {0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+}
+
+void accumulate(height_range& range, const float* heights, int count) {
+    int i = 0;
+
+#ifdef MINE_REDUCTION_SSE
+    if (count >= 4) {
+        const __m128 largest = _mm_set1_ps(std::numeric_limits<float>::max());
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        __m128 low = _mm_set1_ps(range.low);
+        __m128 high = _mm_set1_ps(range.high);
+        int non_finite = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 h = _mm_loadu_ps(heights + i);
+            // |h| <= FLT_MAX is false for NaN as well as for both infinities
+            __m128 finite = _mm_cmple_ps(_mm_andnot_ps(sign, h), largest);
+            low = _mm_min_ps(low, _mm_or_ps(_mm_and_ps(finite, h), _mm_andnot_ps(finite, low)));
+            high = _mm_max_ps(high, _mm_or_ps(_mm_and_ps(finite, h), _mm_andnot_ps(finite, high)));
+            non_finite += 4 - LANES_SET[_mm_movemask_ps(finite)];
+        }
+
+        std::array<float, 4> lows{};
+        std::array<float, 4> highs{};
+        _mm_storeu_ps(lows.data(), low);
+        _mm_storeu_ps(highs.data(), high);
+        range.low = std::min({lows[0], lows[1], lows[2], lows[3]});
+        range.high = std::max({highs[0], highs[1], highs[2], highs[3]});
+        range.non_finite += non_finite;
+    }
+#endif
+
+    for (; i < count; ++i) {
+        float h = heights[i];
+        if (std::isfinite(h)) {
+            range.low = std::min(range.low, h);
+            range.high = std::max(range.high, h);
+        } else {
+            range.non_finite++;
+        }
+    }
+}
+
+void merge(height_range& into, const height_range& other) {
+    into.low = std::min(into.low, other.low);
+    into.high = std::max(into.high, other.high);
+    into.non_finite += other.non_finite;
+}
+
+height_range reduce_heights(const vertex* grid, int count) {
+    std::vector<height_range> partial(thread_count());
+    parallel_for(0, (count + GATHER - 1) / GATHER, [&](int first, int last, int thread) {
+        std::array<float, GATHER> heights{};
+        for (int block = first; block < last; ++block) {
+            int begin = block * GATHER;
+            int size = std::min(GATHER, count - begin);
+            for (int i = 0; i < size; ++i) {
+                heights[i] = grid[begin + i].y;
+            }
+            accumulate(partial[thread], heights.data(), size);
+        }
+    });
+
+    height_range range{};
+    for (const height_range& part : partial) {
+        merge(range, part);
+    }
+    return range;
+}
+}
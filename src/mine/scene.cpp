@@ -0,0 +1,190 @@
+#include <mine/scene.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace mine {
+namespace {
+constexpr char MAGIC[4] = {'M', 'S', 'C', 'N'};
+// 2 packed the vertex color into one GLuint, 3 added the parameter ranges; a version 2 scene takes them from the bounds
+constexpr uint32_t VERSION = 3;
+// vertex data starts on a cache line so it can be handed to glBufferData as it sits in the mapping
+constexpr size_t VERTEX_ALIGNMENT = 64;
+
+template <typename T>
+void put(std::vector<char>& out, T value) {
+    const char* bytes = (const char*)&value;
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+struct reader {
+    const char* data;
+    size_t size;
+    size_t offset;
+    bool good;
+
+    template <typename T>
+    T get() {
+        T value{};
+        if (offset + sizeof(T) > size) {
+            good = false;
+            return value;
+        }
+        std::memcpy(&value, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    void get_bytes(void* out, size_t count) {
+        if (count == 0) {
+            return;
+        }
+        if (offset + count > size) {
+            good = false;
+            return;
+        }
+        std::memcpy(out, data + offset, count);
+        offset += count;
+    }
+};
+}
+
+scene::scene() :
+    file{}, axes{}, view{}, functions{}, base_vertice_count{}, vertices{}, vertex_count{}
+{}
+
+scene::~scene() {
+    close();
+}
+
+bool scene::save(const std::string& path, const vertex* vertices, size_t vertex_count) const {
+    std::vector<char> out{};
+    out.insert(out.end(), MAGIC, MAGIC + 4);
+    put(out, VERSION);
+    put(out, (uint32_t)functions.size());
+    for (int axis : axes) {
+        put(out, (int32_t)axis);
+    }
+    for (float value : view) {
+        put(out, value);
+    }
+    put(out, (uint32_t)base_vertice_count);
+    put(out, (uint64_t)(vertices ? vertex_count : 0));
+
+    for (const scene_function& function : functions) {
+        put(out, (uint8_t)function.kind);
+        for (int bound : function.bounds) {
+            put(out, (int32_t)bound);
+        }
+        for (float parameter : function.parameters) {
+            put(out, parameter);
+        }
+        put(out, (uint32_t)function.source.size());
+        out.insert(out.end(), function.source.begin(), function.source.end());
+        put(out, (uint32_t)function.visible.size());
+        out.insert(out.end(), function.visible.begin(), function.visible.end());
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (vertices) {
+        out.resize((out.size() + VERTEX_ALIGNMENT - 1) / VERTEX_ALIGNMENT * VERTEX_ALIGNMENT, 0);
+        file.write(out.data(), out.size());
+        file.write((const char*)vertices, vertex_count * sizeof(vertex));
+    } else {
+        file.write(out.data(), out.size());
+    }
+    if (!file) {
+        std::cerr << "Error: Failed to write scene " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool scene::open(const std::string& path) {
+    close();
+    if (!file.open(path)) {
+        return false;
+    }
+    const char* mapping = file.get_data();
+    size_t mapping_size = file.get_size();
+
+    reader in{mapping, mapping_size, 4, mapping_size >= 4 && std::memcmp(mapping, MAGIC, 4) == 0};
+    uint32_t version = in.get<uint32_t>();
+    if (!in.good || version < 2 || version > VERSION) {
+        std::cerr << "Error: " << path << " is not a version 2 or " << VERSION << " scene" << std::endl;
+        close();
+        return false;
+    }
+
+    uint32_t function_count = in.get<uint32_t>();
+    for (int& axis : axes) {
+        axis = in.get<int32_t>();
+    }
+    for (float& value : view) {
+        value = in.get<float>();
+        in.good = in.good && std::isfinite(value);
+    }
+    base_vertice_count = (int)in.get<uint32_t>();
+    uint64_t stored_vertices = in.get<uint64_t>();
+
+    for (uint32_t i = 0; i < function_count && in.good; ++i) {
+        scene_function function{};
+        function.kind = in.get<uint8_t>();
+        if (function.kind > COMPLEX) {
+            in.good = false;
+            break;
+        }
+        for (int& bound : function.bounds) {
+            bound = in.get<int32_t>();
+        }
+        for (size_t p = 0; p < function.parameters.size(); ++p) {
+            function.parameters[p] = version == 2 ? (float)function.bounds[p] : in.get<float>();
+            in.good = in.good && std::isfinite(function.parameters[p]);
+        }
+        // lengths are checked against what is left before anything is allocated for them
+        uint32_t length = in.get<uint32_t>();
+        if (length > mapping_size - in.offset) {
+            in.good = false;
+            break;
+        }
+        function.source.resize(length);
+        in.get_bytes(&function.source[0], length);
+        // a visibility mask covers every cell of the grid or is left out
+        length = in.get<uint32_t>();
+        if (length > mapping_size - in.offset || (length != 0 && length != (uint32_t)(X_RECTS * Z_RECTS))) {
+            in.good = false;
+            break;
+        }
+        function.visible.resize(length);
+        in.get_bytes(function.visible.data(), length);
+        functions.push_back(std::move(function));
+    }
+
+    if (in.good && stored_vertices > 0) {
+        size_t offset = (in.offset + VERTEX_ALIGNMENT - 1) / VERTEX_ALIGNMENT * VERTEX_ALIGNMENT;
+        if (stored_vertices <= mapping_size / sizeof(vertex) && offset + stored_vertices * sizeof(vertex) == mapping_size) {
+            vertices = (const vertex*)(mapping + offset);
+            vertex_count = (size_t)stored_vertices;
+        } else {
+            in.good = false;
+        }
+    }
+
+    if (!in.good) {
+        std::cerr << "Error: Scene " << path << " is truncated or corrupt" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void scene::close() {
+    file.close();
+    functions.clear();
+    vertices = nullptr;
+    vertex_count = 0;
+}
+}
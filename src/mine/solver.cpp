@@ -0,0 +1,264 @@
+#include <mine/solver.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+
+#include <mine/parallel.hpp>
+
+namespace mine {
+namespace {
+constexpr int MAX_ITERATIONS = 40;
+constexpr double GRADIENT_TOLERANCE = 1e-10;
+constexpr double STEP_TOLERANCE = 1e-12;
+
+constexpr std::array<std::array<float, 3>, 5> MARKER_COLORS{{
+    { 0.1f, 0.3f, 0.9f },
+    { 0.9f, 0.2f, 0.1f },
+    { 0.9f, 0.8f, 0.1f },
+    { 0.6f, 0.6f, 0.6f },
+    { 1.0f, 1.0f, 1.0f }
+}};
+
+struct lanes {
+    std::array<double, BATCH> x;
+    std::array<double, BATCH> y;
+    std::array<double, BATCH> f;
+    std::array<double, BATCH> fx;
+    std::array<double, BATCH> fy;
+};
+
+int64_t cell_key(int64_t i, int64_t j) {
+    return (int64_t)(((uint64_t)i << 32) ^ ((uint64_t)j & 0xffffffffu));
+}
+}
+
+solver::solver() : partials{} {}
+
+void solver::find_critical_points(const expression& function, const std::array<int, 4>& bounds, int seeds) {
+    solve(function, bounds, seeds, false);
+}
+
+void solver::find_zeros(const expression& function, const std::array<int, 4>& bounds, int seeds) {
+    solve(function, bounds, seeds, true);
+}
+
+void solver::clear() {
+    points.clear();
+}
+
+void solver::solve(const expression& function, const std::array<int, 4>& bounds, int seeds, bool zeros) {
+    points.clear();
+    if (function.empty() || seeds < 1) {
+        return;
+    }
+
+    double x0 = bounds[NEG_X_BOUND];
+    double y0 = bounds[NEG_Z_BOUND];
+    double width = bounds[POS_X_BOUND] - bounds[NEG_X_BOUND];
+    double depth = bounds[POS_Z_BOUND] - bounds[NEG_Z_BOUND];
+    double scale = std::max(std::max(width, depth), 1e-6);
+    double h = 1e-5 * scale;
+    double slack = 1e-9 * scale;
+
+    partials.resize(thread_count());
+    for (std::vector<critical_point>& partial : partials) {
+        partial.clear();
+    }
+
+    int total = seeds * seeds;
+    int batches = (total + BATCH - 1) / BATCH;
+
+    parallel_for(0, batches, [&](int first, int last, int thread) {
+        lanes p{};
+        lanes q{};
+        lanes probe{};
+        std::array<double, BATCH> hxx{};
+        std::array<double, BATCH> hxy{};
+        std::array<double, BATCH> hyy{};
+        std::array<double, BATCH> damping{};
+        std::array<double, BATCH> step{};
+
+        // one central difference of the AD gradient per axis gives the Hessian without second-order duals
+        auto hessian = [&](int count) {
+            for (int axis = 0; axis < 2; ++axis) {
+                for (int sign = -1; sign <= 1; sign += 2) {
+                    for (int l = 0; l < count; ++l) {
+                        probe.x[l] = p.x[l] + (axis == 0 ? sign * h : 0.0);
+                        probe.y[l] = p.y[l] + (axis == 1 ? sign * h : 0.0);
+                    }
+                    function.evaluate_dual(probe.x.data(), probe.y.data(), probe.f.data(), probe.fx.data(), probe.fy.data(), count);
+                    for (int l = 0; l < count; ++l) {
+                        if (axis == 0) {
+                            hxx[l] += sign * probe.fx[l] / (2.0 * h);
+                            hxy[l] += sign * probe.fy[l] / (4.0 * h);
+                        } else {
+                            hyy[l] += sign * probe.fy[l] / (2.0 * h);
+                            hxy[l] += sign * probe.fx[l] / (4.0 * h);
+                        }
+                    }
+                }
+            }
+        };
+
+        for (int batch = first; batch < last; ++batch) {
+            int count = std::min(BATCH, total - batch * BATCH);
+
+            for (int l = 0; l < count; ++l) {
+                int seed = batch * BATCH + l;
+                p.x[l] = x0 + (seed / seeds + 0.5) * width / seeds;
+                p.y[l] = y0 + (seed % seeds + 0.5) * depth / seeds;
+                damping[l] = 1e-3;
+                step[l] = 1.0;
+            }
+            function.evaluate_dual(p.x.data(), p.y.data(), p.f.data(), p.fx.data(), p.fy.data(), count);
+
+            for (int iteration = 0; iteration < MAX_ITERATIONS; ++iteration) {
+                if (!zeros) {
+                    hxx.fill(0.0);
+                    hxy.fill(0.0);
+                    hyy.fill(0.0);
+                    hessian(count);
+                }
+
+                for (int l = 0; l < count; ++l) {
+                    double dx = 0.0;
+                    double dy = 0.0;
+                    if (zeros) {
+                        // Gauss-Newton projection onto f = 0 along the gradient
+                        double norm = p.fx[l] * p.fx[l] + p.fy[l] * p.fy[l] + damping[l] * 1e-12;
+                        dx = -p.f[l] * p.fx[l] / norm;
+                        dy = -p.f[l] * p.fy[l] / norm;
+                    } else {
+                        // LM on the residual grad f = 0 with Jacobian H: (H^2 + damping) step = -H grad f,
+                        // so small damping is a Newton step and large damping is descent on |grad f|^2
+                        double a = hxx[l] * hxx[l] + hxy[l] * hxy[l] + damping[l];
+                        double b = hxy[l] * (hxx[l] + hyy[l]);
+                        double d = hxy[l] * hxy[l] + hyy[l] * hyy[l] + damping[l];
+                        double rx = hxx[l] * p.fx[l] + hxy[l] * p.fy[l];
+                        double ry = hxy[l] * p.fx[l] + hyy[l] * p.fy[l];
+                        double det = a * d - b * b;
+                        if (std::abs(det) > 1e-300) {
+                            dx = -(d * rx - b * ry) / det;
+                            dy = -(a * ry - b * rx) / det;
+                        }
+                    }
+                    q.x[l] = p.x[l] + dx;
+                    q.y[l] = p.y[l] + dy;
+                    step[l] = std::abs(dx) + std::abs(dy);
+                }
+
+                function.evaluate_dual(q.x.data(), q.y.data(), q.f.data(), q.fx.data(), q.fy.data(), count);
+
+                bool moving = false;
+                for (int l = 0; l < count; ++l) {
+                    double before = zeros ? p.f[l] * p.f[l] : p.fx[l] * p.fx[l] + p.fy[l] * p.fy[l];
+                    double after = zeros ? q.f[l] * q.f[l] : q.fx[l] * q.fx[l] + q.fy[l] * q.fy[l];
+                    if (std::isfinite(after) && after <= before) {
+                        p.x[l] = q.x[l];
+                        p.y[l] = q.y[l];
+                        p.f[l] = q.f[l];
+                        p.fx[l] = q.fx[l];
+                        p.fy[l] = q.fy[l];
+                        damping[l] = std::max(damping[l] / 3.0, 1e-12);
+                    } else {
+                        damping[l] = std::min(damping[l] * 4.0, 1e12);
+                    }
+                    moving = moving || step[l] > STEP_TOLERANCE * scale;
+                }
+                if (!moving) {
+                    break;
+                }
+            }
+
+            if (!zeros) {
+                hxx.fill(0.0);
+                hxy.fill(0.0);
+                hyy.fill(0.0);
+                hessian(count);
+            }
+
+            for (int l = 0; l < count; ++l) {
+                double residual = zeros ? std::abs(p.f[l]) : std::sqrt(p.fx[l] * p.fx[l] + p.fy[l] * p.fy[l]);
+                bool inside =
+                    p.x[l] >= bounds[NEG_X_BOUND] - slack && p.x[l] <= bounds[POS_X_BOUND] + slack &&
+                    p.y[l] >= bounds[NEG_Z_BOUND] - slack && p.y[l] <= bounds[POS_Z_BOUND] + slack;
+                if (!inside || !std::isfinite(p.f[l]) || residual > std::sqrt(GRADIENT_TOLERANCE) * (1.0 + std::abs(p.f[l]))) {
+                    continue;
+                }
+
+                int kind = ZERO;
+                if (!zeros) {
+                    double det = hxx[l] * hyy[l] - hxy[l] * hxy[l];
+                    double tiny = 1e-9 * (std::abs(hxx[l]) + std::abs(hyy[l]) + std::abs(hxy[l]));
+                    if (det > tiny && hxx[l] > 0.0) {
+                        kind = MINIMUM;
+                    } else if (det > tiny && hxx[l] < 0.0) {
+                        kind = MAXIMUM;
+                    } else if (det < -tiny) {
+                        kind = SADDLE;
+                    } else {
+                        kind = DEGENERATE;
+                    }
+                }
+                partials[thread].push_back({p.x[l], p.y[l], p.f[l], kind});
+            }
+        }
+    });
+
+    // zero sets are curves, so keep them at seed spacing; isolated critical points collapse much tighter
+    merge(zeros ? 0.5 * std::min(width, depth) / seeds : 1e-4 * scale);
+}
+
+void solver::merge(double radius) {
+    radius = std::max(radius, 1e-12);
+    std::unordered_map<int64_t, std::vector<int>> cells{};
+
+    for (const std::vector<critical_point>& partial : partials) {
+        for (const critical_point& candidate : partial) {
+            int64_t i = (int64_t)std::floor(candidate.x / radius);
+            int64_t j = (int64_t)std::floor(candidate.y / radius);
+
+            bool duplicate = false;
+            for (int di = -1; di <= 1 && !duplicate; ++di) {
+                for (int dj = -1; dj <= 1 && !duplicate; ++dj) {
+                    auto cell = cells.find(cell_key(i + di, j + dj));
+                    if (cell == cells.end()) {
+                        continue;
+                    }
+                    for (int index : cell->second) {
+                        double dx = points[index].x - candidate.x;
+                        double dy = points[index].y - candidate.y;
+                        if (dx * dx + dy * dy <= radius * radius) {
+                            duplicate = true;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            if (!duplicate) {
+                cells[cell_key(i, j)].push_back((int)points.size());
+                points.push_back(candidate);
+            }
+        }
+    }
+}
+
+void solver::markers(std::vector<vertex>& lines, float size) const {
+    for (const critical_point& point : points) {
+        const std::array<float, 3>& color = MARKER_COLORS[point.kind];
+        float x = (float)point.x;
+        float y = (float)point.f;
+        float z = (float)point.y;
+
+        lines.push_back({x - size, y, z, pack_color(color[0], color[1], color[2]), 0});
+        lines.push_back({x + size, y, z, pack_color(color[0], color[1], color[2]), 0});
+        lines.push_back({x, y - size, z, pack_color(color[0], color[1], color[2]), 0});
+        lines.push_back({x, y + size, z, pack_color(color[0], color[1], color[2]), 0});
+        lines.push_back({x, y, z - size, pack_color(color[0], color[1], color[2]), 0});
+        lines.push_back({x, y, z + size, pack_color(color[0], color[1], color[2]), 0});
+    }
+}
+}
@@ -0,0 +1,536 @@
+#include <mine/terrain.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include <mine/evaluator.hpp>
+#include <mine/mapping.hpp>
+#include <mine/normals.hpp>
+
+namespace mine {
+namespace {
+constexpr char MAGIC[4] = {'M', 'T', 'I', 'L'};
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 64;
+// samples per tile side, plus one shared with the next tile so a ring never needs two tiles for one cell
+constexpr int TILE = 128;
+constexpr int TILE_SAMPLES = (TILE + 1) * (TILE + 1);
+
+// vertices per ring side; rings snap to even samples so each sits on its coarser neighbour's grid
+constexpr int GRID = 65;
+constexpr int HALF = GRID / 2;
+constexpr int RINGS = 8;
+constexpr int RING_VERTICES = GRID * GRID;
+constexpr int RING_INDICES = (GRID - 1) * (GRID - 1) * 6;
+
+constexpr uint64_t NO_TILE = ~0ull;
+const float NaN = std::numeric_limits<float>::quiet_NaN();
+
+uint64_t make_key(int level, long long tx, long long ty) {
+    return ((uint64_t)level << 56) | ((uint64_t)ty << 28) | (uint64_t)tx;
+}
+
+int key_level(uint64_t key) {
+    return (int)(key >> 56);
+}
+
+long long key_y(uint64_t key) {
+    return (long long)((key >> 28) & ((1u << 28) - 1));
+}
+
+long long key_x(uint64_t key) {
+    return (long long)(key & ((1u << 28) - 1));
+}
+
+// samples along one side at a level, where sample i is raster pixel i << level
+long long level_samples(int size, int level) {
+    return ((long long)(size - 1) >> level) + 1;
+}
+
+long long level_tiles(int size, int level) {
+    return std::max(1ll, (level_samples(size, level) - 1 + TILE - 1) / TILE);
+}
+
+template <typename T>
+void put(std::vector<char>& out, T value) {
+    const char* bytes = (const char*)&value;
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+}
+
+bool build_tiles(const std::string& raster_path, int width, int height, const std::array<float, 4>& extent, const std::string& path) {
+    if (width < 2 || height < 2 || width > (1 << 28) || height > (1 << 28)) {
+        std::cerr << "Error: A raster must be between 2 and 2^28 samples on each side" << std::endl;
+        return false;
+    }
+    mapped_file raster{};
+    if (!raster.open(raster_path)) {
+        return false;
+    }
+    if (raster.get_size() != (size_t)width * height * sizeof(float)) {
+        std::cerr << "Error: " << raster_path << " is not a " << width << "x" << height << " float32 raster" << std::endl;
+        return false;
+    }
+    const char* data = raster.get_data();
+
+    int levels = 1;
+    while (level_tiles(width, levels - 1) > 1 || level_tiles(height, levels - 1) > 1) {
+        ++levels;
+    }
+
+    std::vector<char> header{};
+    header.insert(header.end(), MAGIC, MAGIC + 4);
+    put(header, VERSION);
+    put(header, (uint32_t)width);
+    put(header, (uint32_t)height);
+    put(header, (uint32_t)TILE);
+    put(header, (uint32_t)levels);
+    for (float value : extent) {
+        put(header, value);
+    }
+    header.resize(HEADER_SIZE, 0);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(header.data(), header.size());
+
+    // level by level, row by row; offsets follow from the counts, so the file carries no index
+    std::vector<float> heights(TILE_SAMPLES);
+    for (int level = 0; level < levels && file; ++level) {
+        long long columns = level_samples(width, level);
+        long long rows = level_samples(height, level);
+        for (long long ty = 0; ty < level_tiles(height, level); ++ty) {
+            for (long long tx = 0; tx < level_tiles(width, level); ++tx) {
+                for (int j = 0; j <= TILE; ++j) {
+                    long long v = ty * TILE + j;
+                    for (int i = 0; i <= TILE; ++i) {
+                        long long u = tx * TILE + i;
+                        float& out = heights[j * (TILE + 1) + i];
+                        if (u < columns && v < rows) {
+                            std::memcpy(&out, data + ((v << level) * width + (u << level)) * sizeof(float), sizeof(float));
+                        } else {
+                            out = NaN;
+                        }
+                    }
+                }
+                file.write((const char*)heights.data(), heights.size() * sizeof(float));
+            }
+        }
+    }
+
+    if (!file) {
+        std::cerr << "Error: Failed to write tiles " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+terrain::terrain() :
+    path{}, width{}, height{}, tile_size{}, levels{}, extent{}, tile_counts{}, level_offsets{},
+    budget{}, cache{}, lookup{}, root{NO_TILE, {}},
+    loader{}, mutex{}, wake{}, arrived{}, requests{}, loaded{}, reading{NO_TILE}, stopping{},
+    finest{-1}, origins{}, vertices{}, indices{}, vao{}, vbo{}, ibo{}, index_count{}
+{}
+
+terrain::~terrain() {
+    close();
+}
+
+bool terrain::open(const std::string& path, size_t cache_tiles) {
+    close();
+
+    std::ifstream file(path, std::ios::binary);
+    std::array<char, HEADER_SIZE> header{};
+    file.read(header.data(), header.size());
+    uint32_t fields[5]{};
+    std::memcpy(fields, header.data() + 4, sizeof(fields));
+    if (!file || std::memcmp(header.data(), MAGIC, 4) != 0 || fields[0] != VERSION) {
+        std::cerr << "Error: " << path << " is not a version " << VERSION << " tile file" << std::endl;
+        return false;
+    }
+    width = (int)fields[1];
+    height = (int)fields[2];
+    tile_size = (int)fields[3];
+    levels = (int)fields[4];
+    std::memcpy(extent.data(), header.data() + 4 + sizeof(fields), sizeof(extent));
+    if (tile_size != TILE || width < 2 || height < 2 || levels < 1 || levels > 40) {
+        std::cerr << "Error: Tile file " << path << " is corrupt" << std::endl;
+        return false;
+    }
+
+    uint64_t offset = HEADER_SIZE;
+    for (int level = 0; level < levels; ++level) {
+        tile_counts.push_back({(int)level_tiles(width, level), (int)level_tiles(height, level)});
+        level_offsets.push_back(offset);
+        offset += (uint64_t)tile_counts.back()[0] * tile_counts.back()[1] * TILE_SAMPLES * sizeof(float);
+    }
+    file.seekg(0, std::ios::end);
+    if ((uint64_t)file.tellg() != offset || tile_counts.back()[0] != 1 || tile_counts.back()[1] != 1) {
+        std::cerr << "Error: Tile file " << path << " is truncated or corrupt" << std::endl;
+        tile_counts.clear();
+        level_offsets.clear();
+        return false;
+    }
+
+    // the coarsest tile covers everything, so it is read now and never evicted
+    root = {make_key(levels - 1, 0, 0), std::vector<float>(TILE_SAMPLES)};
+    file.seekg(tile_offset(root.key));
+    file.read((char*)root.heights.data(), TILE_SAMPLES * sizeof(float));
+
+    this->path = path;
+    budget = std::max(cache_tiles, (size_t)RINGS * 4);
+    stopping = false;
+    loader = std::thread(&terrain::run, this);
+
+    // fixed size buffers: whatever is in view, the clipmap never needs more than this
+    windows.resize(levels);
+    vertices.resize(RINGS * RING_VERTICES);
+    indices.reserve(RINGS * RING_INDICES);
+
+    GLint previous_array = 0;
+    GLint previous_vao = 0;
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previous_array);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vao);
+
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, RINGS * RING_VERTICES * sizeof(vertex), nullptr, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, RINGS * RING_INDICES * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vertex), (GLvoid*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(vertex), (GLvoid*)offsetof(vertex, color));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(vertex), (GLvoid*)offsetof(vertex, normal));
+
+    glBindVertexArray(previous_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, previous_array);
+
+    if (!file) {
+        std::cerr << "Error: Failed to read tiles " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void terrain::close() {
+    if (loader.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        loader.join();
+    }
+    requests.clear();
+    loaded.clear();
+    reading = NO_TILE;
+    cache.clear();
+    lookup.clear();
+    root = {NO_TILE, {}};
+    tile_counts.clear();
+    level_offsets.clear();
+    path.clear();
+    finest = -1;
+    origins.clear();
+    windows.clear();
+    vertices.clear();
+    indices.clear();
+    index_count = 0;
+
+    if (vao) {
+        glDeleteBuffers(1, &vbo);
+        glDeleteBuffers(1, &ibo);
+        glDeleteVertexArrays(1, &vao);
+        vao = vbo = ibo = 0;
+    }
+}
+
+bool terrain::is_open() const {
+    return !path.empty();
+}
+
+bool terrain::update(const glm::vec3& center, float distance, bool wait) {
+    if (!is_open()) {
+        return false;
+    }
+
+    // the finest ring is picked so that it reaches about half the camera distance out
+    double spacing = std::max(
+        (double)(extent[2] - extent[0]) / (width - 1),
+        (double)(extent[3] - extent[1]) / (height - 1)
+    );
+    int level = 0;
+    while (level + 1 < levels && HALF * spacing * ((long long)1 << level) < 0.5 * distance) {
+        ++level;
+    }
+    int rings = std::min(RINGS, levels - level);
+
+    // on the stack, and copied into origins' existing capacity, so a frame where nothing moves never allocates
+    std::array<std::array<long long, 2>, RINGS> placed{};
+    for (int k = 0; k < rings; ++k) {
+        double scale = (double)((long long)1 << (level + k));
+        double u = (center.x - extent[0]) / ((double)(extent[2] - extent[0]) / (width - 1)) / scale;
+        double v = (center.z - extent[1]) / ((double)(extent[3] - extent[1]) / (height - 1)) / scale;
+        placed[k] = {2 * (long long)std::floor(u / 2) - HALF, 2 * (long long)std::floor(v / 2) - HALF};
+    }
+    bool moved = level != finest || origins.size() != (size_t)rings || !std::equal(origins.begin(), origins.end(), placed.begin());
+    finest = level;
+    origins.assign(placed.begin(), placed.begin() + rings);
+
+    // coarse tiles first, so the fallback under a fine ring fills in before its own tiles
+    std::vector<uint64_t> needed{};
+    for (int k = rings - 1; k >= 0; --k) {
+        const std::array<int, 2>& count = tile_counts[finest + k];
+        long long low_x = std::max(0ll, origins[k][0] / TILE);
+        long long low_y = std::max(0ll, origins[k][1] / TILE);
+        long long high_x = std::min((long long)count[0] - 1, (origins[k][0] + GRID - 1) / TILE);
+        long long high_y = std::min((long long)count[1] - 1, (origins[k][1] + GRID - 1) / TILE);
+        for (long long ty = low_y; ty <= high_y; ++ty) {
+            for (long long tx = low_x; tx <= high_x; ++tx) {
+                uint64_t key = make_key(finest + k, tx, ty);
+                if (!find(key)) {
+                    needed.push_back(key);
+                }
+            }
+        }
+    }
+
+    std::vector<tile> arrivals{};
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        // the queue only ever holds what the current view wants; tiles the camera left behind are dropped
+        requests.clear();
+        for (uint64_t key : needed) {
+            bool pending = key == reading || std::any_of(loaded.begin(), loaded.end(), [key](const tile& t) { return t.key == key; });
+            if (!pending) {
+                requests.push_back(key);
+            }
+        }
+        if (!requests.empty()) {
+            wake.notify_one();
+        }
+        if (wait) {
+            arrived.wait(lock, [this]() { return requests.empty() && reading == NO_TILE; });
+        }
+        arrivals.swap(loaded);
+    }
+
+    for (tile& arrival : arrivals) {
+        if (lookup.count(arrival.key)) {
+            continue;
+        }
+        cache.push_front(std::move(arrival));
+        lookup[cache.front().key] = cache.begin();
+        while (cache.size() > budget) {
+            lookup.erase(cache.back().key);
+            cache.pop_back();
+        }
+    }
+
+    if (!moved && arrivals.empty()) {
+        return false;
+    }
+    build_mesh();
+    return true;
+}
+
+void terrain::draw() const {
+    if (index_count == 0) {
+        return;
+    }
+    GLint previous_vao = 0;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vao);
+    glBindVertexArray(vao);
+    glDrawElements(GL_TRIANGLES, index_count, GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(previous_vao);
+}
+
+void terrain::run() {
+    std::ifstream file(path, std::ios::binary);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this]() { return stopping || !requests.empty(); });
+        if (stopping) {
+            return;
+        }
+        uint64_t key = requests.front();
+        requests.pop_front();
+        reading = key;
+        lock.unlock();
+
+        tile read{key, std::vector<float>(TILE_SAMPLES)};
+        file.seekg(tile_offset(key));
+        file.read((char*)read.heights.data(), TILE_SAMPLES * sizeof(float));
+        if (!file) {
+            // a tile that cannot be read is kept as a hole rather than asked for again every frame
+            std::cerr << "Error: Failed to read a tile from " << path << std::endl;
+            file.clear();
+            std::fill(read.heights.begin(), read.heights.end(), NaN);
+        }
+
+        lock.lock();
+        loaded.push_back(std::move(read));
+        reading = NO_TILE;
+        arrived.notify_all();
+    }
+}
+
+uint64_t terrain::tile_offset(uint64_t key) const {
+    int level = key_level(key);
+    uint64_t index = (uint64_t)key_y(key) * tile_counts[level][0] + key_x(key);
+    return level_offsets[level] + index * TILE_SAMPLES * sizeof(float);
+}
+
+const std::vector<float>* terrain::find(uint64_t key) {
+    if (key == root.key) {
+        return &root.heights;
+    }
+    auto found = lookup.find(key);
+    if (found == lookup.end()) {
+        return nullptr;
+    }
+    cache.splice(cache.begin(), cache, found->second);
+    return &found->second->heights;
+}
+
+void terrain::resolve(int level, const std::array<long long, 2>& first) {
+    // a ring is narrower than a tile, so at any level it spans at most two tiles each way
+    for (int k = level; k < levels; ++k) {
+        int shift = k - level;
+        long long low_x = std::min((long long)tile_counts[k][0] - 1, std::max(0ll, first[0]) / ((long long)TILE << shift));
+        long long low_y = std::min((long long)tile_counts[k][1] - 1, std::max(0ll, first[1]) / ((long long)TILE << shift));
+        window& w = windows[k];
+        w = {low_x, low_y, {}};
+        for (int t = 0; t < 4; ++t) {
+            long long tx = low_x + t % 2;
+            long long ty = low_y + t / 2;
+            if (tx < tile_counts[k][0] && ty < tile_counts[k][1]) {
+                w.tiles[t] = find(make_key(k, tx, ty));
+            }
+        }
+    }
+}
+
+// the height at sample (u, v) of a level, read from the finest resident tile that covers it; a coarser tile
+// is interpolated bilinearly between its samples. only reads the tiles resolve picked
+float terrain::sample(int level, long long u, long long v) const {
+    if (u < 0 || v < 0 || u >= level_samples(width, level) || v >= level_samples(height, level)) {
+        return NaN;
+    }
+    for (int k = level; k < levels; ++k) {
+        double scale = 1.0 / (double)((long long)1 << (k - level));
+        double x = u * scale;
+        double y = v * scale;
+        long long tx = std::min((long long)tile_counts[k][0] - 1, (long long)x / TILE);
+        long long ty = std::min((long long)tile_counts[k][1] - 1, (long long)y / TILE);
+        const window& w = windows[k];
+        const std::vector<float>* heights = w.tiles[(ty - w.y) * 2 + (tx - w.x)];
+        if (!heights) {
+            continue;
+        }
+        x -= tx * TILE;
+        y -= ty * TILE;
+        int i = std::min(TILE - 1, (int)x);
+        int j = std::min(TILE - 1, (int)y);
+        float fx = (float)(x - i);
+        float fy = (float)(y - j);
+        const float* row = heights->data() + j * (TILE + 1) + i;
+        if (fx == 0.0f && fy == 0.0f) {
+            return row[0];
+        }
+        float top = row[0] + (row[1] - row[0]) * fx;
+        float bottom = row[TILE + 1] + (row[TILE + 2] - row[TILE + 1]) * fx;
+        return top + (bottom - top) * fy;
+    }
+    return NaN;
+}
+
+void terrain::build_mesh() {
+    int rings = (int)origins.size();
+    double step_x = (double)(extent[2] - extent[0]) / (width - 1);
+    double step_z = (double)(extent[3] - extent[1]) / (height - 1);
+
+    for (int k = 0; k < rings; ++k) {
+        int level = finest + k;
+        double scale = (double)((long long)1 << level);
+        vertex* ring = &vertices[k * RING_VERTICES];
+        resolve(level, origins[k]);
+        for (int j = 0; j < GRID; ++j) {
+            for (int i = 0; i < GRID; ++i) {
+                long long u = origins[k][0] + i;
+                long long v = origins[k][1] + j;
+                vertex& out = ring[j * GRID + i];
+                out.x = (float)(extent[0] + u * scale * step_x);
+                out.z = (float)(extent[1] + v * scale * step_z);
+                out.y = sample(level, u, v);
+            }
+        }
+
+        // where a coarser ring takes over, every other border vertex would sit off its edge; pulling it onto
+        // the line between its neighbours closes the crack
+        if (k + 1 < rings) {
+            for (int i = 1; i < GRID; i += 2) {
+                ring[i].y = (ring[i - 1].y + ring[i + 1].y) / 2;
+                ring[(GRID - 1) * GRID + i].y = (ring[(GRID - 1) * GRID + i - 1].y + ring[(GRID - 1) * GRID + i + 1].y) / 2;
+                ring[i * GRID].y = (ring[(i - 1) * GRID].y + ring[(i + 1) * GRID].y) / 2;
+                ring[i * GRID + GRID - 1].y = (ring[(i - 1) * GRID + GRID - 1].y + ring[(i + 1) * GRID + GRID - 1].y) / 2;
+            }
+        }
+
+        for (int i = 0; i < RING_VERTICES; ++i) {
+            height_color(ring[i].y, 0.0f, ring[i]);
+        }
+        compute_normals(ring, GRID, GRID);
+    }
+
+    indices.clear();
+    for (int k = 0; k < rings; ++k) {
+        // the cells the finer ring already covers, in this ring's samples
+        long long hole_x = k > 0 ? origins[k - 1][0] / 2 - origins[k][0] : GRID;
+        long long hole_y = k > 0 ? origins[k - 1][1] / 2 - origins[k][1] : GRID;
+        GLuint first = k * RING_VERTICES;
+        const vertex* ring = &vertices[first];
+        for (int j = 0; j + 1 < GRID; ++j) {
+            for (int i = 0; i + 1 < GRID; ++i) {
+                if (i >= hole_x && i < hole_x + HALF && j >= hole_y && j < hole_y + HALF) {
+                    continue;
+                }
+                GLuint corner = j * GRID + i;
+                if (std::isnan(ring[corner].y) || std::isnan(ring[corner + 1].y) ||
+                    std::isnan(ring[corner + GRID].y) || std::isnan(ring[corner + GRID + 1].y)) {
+                    continue;
+                }
+                indices.insert(indices.end(), {
+                    first + corner, first + corner + 1, first + corner + GRID,
+                    first + corner + 1, first + corner + GRID + 1, first + corner + GRID
+                });
+            }
+        }
+    }
+    index_count = (GLsizei)indices.size();
+
+    GLint previous_array = 0;
+    GLint previous_vao = 0;
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &previous_array);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previous_vao);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, rings * RING_VERTICES * sizeof(vertex), vertices.data());
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
+    glBindVertexArray(previous_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, previous_array);
+}
+}
@@ -0,0 +1,198 @@
+#include <mine/worker.hpp>
+
+#include <algorithm>
+
+namespace mine {
+evaluation_worker::evaluation_worker() : versions{}, flags{}, spare{}, outstanding{0}, rows{0}, columns{0}, thread{}, stopping{false} {}
+
+evaluation_worker::~evaluation_worker() {
+    stop();
+}
+
+void evaluation_worker::start(int rows, int columns) {
+    stop();
+    this->rows = rows;
+    this->columns = columns;
+    spare.clear();
+    stopping = false;
+    thread = std::thread(&evaluation_worker::run, this);
+}
+
+void evaluation_worker::stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+
+    // both rings are only touched from this thread now
+    evaluation_job job{};
+    while (jobs.pop(job)) {}
+    evaluation_result result{};
+    while (results.pop(result)) {}
+    for (std::shared_ptr<std::atomic<bool>>& flag : flags) {
+        flag.reset();
+    }
+    outstanding = 0;
+}
+
+bool evaluation_worker::running() const {
+    return thread.joinable();
+}
+
+bool evaluation_worker::submit(int index, const expression& function, const std::array<int, 4>& bounds, const culling* view) {
+    evaluation_job job{
+        index,
+        0,
+        HEIGHT,
+        false,
+        function,
+        bounds,
+        view ? view->low : 0.0,
+        view ? view->high : 0.0,
+        view != nullptr,
+        view && view->clip,
+        {},
+        {},
+        nullptr
+    };
+    if (view && view->clip) {
+        std::copy(view->clip, view->clip + 16, job.view.begin());
+    }
+    return push(std::move(job));
+}
+
+bool evaluation_worker::submit_complex(int index, const expression& function, const std::array<int, 4>& bounds, bool relief) {
+    return push({index, 0, COMPLEX, relief, function, bounds, 0.0, 0.0, false, false, {}, {}, nullptr});
+}
+
+bool evaluation_worker::push(evaluation_job&& job) {
+    int index = job.index;
+    if ((size_t)index >= versions.size()) {
+        versions.resize(index + 1, 0);
+        flags.resize(index + 1);
+    }
+
+    if (!spare.empty()) {
+        job.grid = std::move(spare.back());
+        spare.pop_back();
+    }
+    job.grid.resize((size_t)rows * columns);
+    job.version = versions[index] + 1;
+    job.cancelled = std::make_shared<std::atomic<bool>>(false);
+
+    std::shared_ptr<std::atomic<bool>> flag = job.cancelled;
+    if (!jobs.push(std::move(job))) {
+        spare.push_back(std::move(job.grid));
+        return false;
+    }
+
+    if (flags[index]) {
+        flags[index]->store(true, std::memory_order_relaxed);
+    }
+    versions[index]++;
+    flags[index] = flag;
+    outstanding++;
+
+    // taking the lock between the push and the notify means the worker either sees the job or is already waiting
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+    }
+    wake.notify_one();
+    return true;
+}
+
+void evaluation_worker::cancel(int index) {
+    if ((size_t)index >= versions.size()) {
+        return;
+    }
+    versions[index]++;
+    if (flags[index]) {
+        flags[index]->store(true, std::memory_order_relaxed);
+        flags[index].reset();
+    }
+}
+
+bool evaluation_worker::pending(int index) const {
+    return (size_t)index < flags.size() && flags[index] != nullptr;
+}
+
+bool evaluation_worker::collect(evaluation_result& result) {
+    while (results.pop(result)) {
+        outstanding--;
+        if (result.completed && result.version == versions[result.index]) {
+            flags[result.index].reset();
+            return true;
+        }
+        recycle(std::move(result.grid));
+    }
+    return false;
+}
+
+void evaluation_worker::recycle(std::vector<vertex>&& grid) {
+    if (spare.size() < CAPACITY) {
+        spare.push_back(std::move(grid));
+    }
+}
+
+bool evaluation_worker::busy() const {
+    return outstanding > 0;
+}
+
+void evaluation_worker::run() {
+    evaluation_job job{};
+    while (true) {
+        if (!jobs.pop(job)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping.load() || !jobs.empty(); });
+            if (stopping) {
+                return;
+            }
+            continue;
+        }
+
+        evaluation_result result{job.index, job.version, job.kind, std::move(job.function), std::move(job.grid), {}, {}, false};
+        if (job.kind == COMPLEX && !job.cancelled->load(std::memory_order_relaxed)) {
+            result.completed = evaluate_complex_field(
+                result.function,
+                job.bounds,
+                result.grid.data(),
+                rows,
+                columns,
+                job.relief,
+                &result.heights,
+                job.cancelled.get()
+            );
+        } else if (!job.cancelled->load(std::memory_order_relaxed)) {
+            if (job.cull) {
+                culling view{job.low, job.high, job.clip ? job.view.data() : nullptr};
+                cull_cells(result.function, job.bounds, rows, columns, view, result.visible);
+            }
+            result.completed = evaluate_height_field(
+                result.function,
+                job.bounds,
+                (float)job.index,
+                result.grid.data(),
+                rows,
+                columns,
+                result.visible.empty() ? nullptr : &result.visible,
+                &result.heights,
+                job.cancelled.get()
+            );
+        }
+        job.cancelled.reset();
+
+        // the render thread drains the results every frame, so a full ring waits at most a frame
+        while (!results.push(std::move(result))) {
+            if (stopping) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+    }
+}
+}
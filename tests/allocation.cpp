@@ -0,0 +1,70 @@
+// the counters and the frame arena behind --check-allocations, checked without a window so every build runs them
+#include <iostream>
+#include <memory>
+
+#include <mine/allocation.hpp>
+
+namespace {
+int failures = 0;
+
+void expect(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "Error: " << what << std::endl;
+        failures++;
+    }
+}
+
+long long allocations_during(void (*work)(mine::frame_arena&), mine::frame_arena& arena) {
+    long long before = mine::thread_allocations().count;
+    work(arena);
+    return mine::thread_allocations().count - before;
+}
+
+// what a frame of GUI labels asks of the arena
+void labels(mine::frame_arena& arena) {
+    arena.reset();
+    for (int i = 0; i < 64; ++i) {
+        arena.format("##intInput%d%d", i, i + 1);
+    }
+}
+}
+
+int main() {
+    // every operator new is counted, on the thread and into the innermost scope only
+    mine::allocation_stats outer{};
+    mine::allocation_stats inner{};
+    long long before = mine::thread_allocations().count;
+    {
+        mine::allocation_scope outer_scope(outer);
+        std::unique_ptr<int> first(new int(1));
+        {
+            mine::allocation_scope inner_scope(inner);
+            std::unique_ptr<int[]> second(new int[4]);
+        }
+        std::unique_ptr<double> third(new double(3.0));
+    }
+    expect(mine::thread_allocations().count - before == 3, "the thread did not count every new");
+    expect(outer.count == 2, "the outer scope did not count exactly its own allocations");
+    expect(inner.count == 1 && inner.bytes >= (long long)(4 * sizeof(int)), "the inner scope did not count its allocation");
+
+    void* counted = mine::counted_allocate(16);
+    expect(mine::thread_allocations().count - before == 4, "counted_allocate was not counted");
+    mine::counted_free(counted);
+
+    // a frame that fits never allocates; one that spills does, and once the reset grew the block it fits again
+    mine::frame_arena roomy(1 << 14);
+    allocations_during(labels, roomy);
+    expect(allocations_during(labels, roomy) == 0, "a frame within the arena allocated");
+
+    mine::frame_arena small(64);
+    expect(allocations_during(labels, small) > 0, "a frame past the arena did not spill");
+    allocations_during(labels, small);
+    expect(allocations_during(labels, small) == 0, "the arena did not grow to fit a steady frame");
+
+    mine::frame_arena aligned(256);
+    aligned.allocate(3, 1);
+    void* pointer = aligned.allocate(8, 64);
+    expect((reinterpret_cast<size_t>(pointer) % 64) == 0, "an arena allocation ignored its alignment");
+
+    return failures == 0 ? 0 : 1;
+}
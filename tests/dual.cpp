@@ -0,0 +1,98 @@
+// checks evaluate_dual's derivatives against central differences of the plain evaluation, then prints what a
+// dual sweep costs against a plain one on a sin/exp-heavy expression; the timing is reported, never checked
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+#include <mine/expression.hpp>
+
+namespace {
+int failures = 0;
+
+// every point stays clear of the kinks of abs, min, max and mod and of the poles of tan and log
+constexpr const char* EXPRESSIONS[] = {
+    "x*x - y*y",
+    "sin(x + y) + 3",
+    "exp(x - y)",
+    "sin(x)*cos(y) + x/y",
+    "pow(x, 3) - pow(y, 2.5)",
+    "pow(2, x*y)",
+    "log(x*x + y) + sqrt(x + y)",
+    "tan(x*0.3) + atan(y) + asin(x*0.2) + acos(y*0.3)",
+    "sinh(x) - cosh(y) + tanh(x*y)",
+    "abs(x - 3) + min(x, y - 5) + max(x, y + 5) + mod(x, 7)"
+};
+
+double tolerance(double value) {
+    return 1e-5 * std::max(1.0, std::abs(value));
+}
+}
+
+int main() {
+    std::vector<double> x{}, y{};
+    for (int i = 0; i < 7; ++i) {
+        for (int j = 0; j < 9; ++j) {
+            x.push_back(0.35 + 0.21 * i);
+            y.push_back(0.4 + 0.17 * j);
+        }
+    }
+    int count = (int)x.size();
+    std::vector<double> f(count), dfdx(count), dfdy(count), row_f(count), row_dfdx(count), row_dfdy(count);
+
+    for (const char* text : EXPRESSIONS) {
+        mine::expression function{};
+        if (!function.parse(text)) {
+            std::cerr << "Error: " << text << " did not parse: " << function.get_error() << std::endl;
+            failures++;
+            continue;
+        }
+        function.evaluate_dual(x.data(), y.data(), f.data(), dfdx.data(), dfdy.data(), count);
+        for (int k = 0; k < count; ++k) {
+            double h = 1e-6;
+            double fx = (function.evaluate(x[k] + h, y[k]) - function.evaluate(x[k] - h, y[k])) / (2 * h);
+            double fy = (function.evaluate(x[k], y[k] + h) - function.evaluate(x[k], y[k] - h)) / (2 * h);
+            if (std::abs(f[k] - function.evaluate(x[k], y[k])) > tolerance(f[k]) ||
+                std::abs(dfdx[k] - fx) > tolerance(fx) || std::abs(dfdy[k] - fy) > tolerance(fy)) {
+                std::cerr << "Error: " << text << " at (" << x[k] << ", " << y[k] << ") gives " << f[k] << ", "
+                          << dfdx[k] << ", " << dfdy[k] << " where differences give " << fx << ", " << fy << std::endl;
+                failures++;
+                break;
+            }
+        }
+
+        // a row shares one x, and has to agree with the general sweep exactly
+        function.evaluate_dual_row(x[0], y.data(), row_f.data(), row_dfdx.data(), row_dfdy.data(), count);
+        std::vector<double> same_x(count, x[0]);
+        function.evaluate_dual(same_x.data(), y.data(), f.data(), dfdx.data(), dfdy.data(), count);
+        if (row_f != f || row_dfdx != dfdx || row_dfdy != dfdy) {
+            std::cerr << "Error: " << text << " differs between evaluate_dual_row and evaluate_dual" << std::endl;
+            failures++;
+        }
+    }
+
+    mine::expression heavy{};
+    heavy.parse("sin(x)*exp(y) + cos(x*y) + exp(sin(x + y))");
+    constexpr int SAMPLES = 1 << 16;
+    std::vector<double> bx(SAMPLES), by(SAMPLES), bf(SAMPLES), bdx(SAMPLES), bdy(SAMPLES);
+    for (int k = 0; k < SAMPLES; ++k) {
+        bx[k] = -2.0 + 4.0 * (k % 256) / 255.0;
+        by[k] = -2.0 + 4.0 * (k / 256) / 255.0;
+    }
+    auto best = [](auto&& work) {
+        double fastest = 1e30;
+        for (int run = 0; run < 15; ++run) {
+            auto start = std::chrono::steady_clock::now();
+            work();
+            fastest = std::min(fastest, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        return fastest;
+    };
+    double plain = best([&]() { heavy.evaluate(bx.data(), by.data(), bf.data(), SAMPLES); });
+    double dual = best([&]() { heavy.evaluate_dual(bx.data(), by.data(), bf.data(), bdx.data(), bdy.data(), SAMPLES); });
+    std::printf("%d samples: plain %.3f ms, dual %.3f ms, %.2fx\n", SAMPLES, plain, dual, dual / plain);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+// feeds made-up frame times to the quality controller, which needs no GL context for that
+#include <iostream>
+
+#include <mine/quality.hpp>
+
+namespace {
+int failures = 0;
+
+void expect(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "Error: " << what << std::endl;
+        failures++;
+    }
+}
+
+void feed(mine::quality& controller, double milliseconds, int frames) {
+    for (int i = 0; i < frames; ++i) {
+        controller.add_frame(milliseconds);
+    }
+}
+}
+
+int main() {
+    mine::quality controller{};
+    controller.target = 16.0f;
+
+    // one frame over target halves the samples, and the settling frames after it are not counted
+    expect(controller.add_frame(30.0), "a frame over target changed nothing");
+    expect(controller.samples == 4, "the first cut did not halve the samples");
+    feed(controller, 30.0, 8);
+    expect(controller.samples == 4, "a settling frame was measured");
+
+    // once settled the new setting is under target, and the old frame times must not cut it again
+    feed(controller, 12.0, 20);
+    expect(controller.samples == 4, "the samples were cut on frame times from the old setting");
+    expect(controller.scale == 1.0f, "the scale was cut on frame times from the old setting");
+    expect(controller.get_frame_time() < 12.5, "the average still holds the old setting");
+
+    // well under target for long enough, the samples come back
+    feed(controller, 8.0, 80);
+    expect(controller.samples == 8, "the samples did not come back under target");
+
+    // with no samples left to drop, the scale shrinks by the overshoot measured at the new setting only
+    mine::quality single{};
+    single.target = 16.0f;
+    single.samples = 1;
+    single.max_samples = 1;
+    feed(single, 64.0, 1);
+    expect(single.scale == 0.5f, "the scale did not shrink by the square root of the overshoot");
+    feed(single, 64.0, 8);
+    feed(single, 10.0, 1);
+    expect(single.scale == 0.5f, "the scale was cut again before the new one was measured");
+
+    controller.automatic = false;
+    expect(!controller.add_frame(100.0), "a fixed quality changed");
+
+    return failures == 0 ? 0 : 1;
+}